@@ -1,6 +1,9 @@
-# Run with: python3 build.py
+# Run with: python3 build.py (or python3 build.py release for an optimized build)
 import os
 import platform
+import sys
+
+import embed_assets
 
 # (1)==================== COMMON CONFIGURATION OPTIONS ======================= #
 COMPILER="g++ -std=c++17"   # The compiler we want to use 
@@ -18,7 +21,7 @@ LIBRARIES=""            # What libraries do we want to include
 if platform.system()=="Linux":
     ARGUMENTS="-D LINUX" # -D is a #define sent to preprocessor
     INCLUDE_DIR="-I ./include/ -I ./../common/thirdparty/glm/"
-    LIBRARIES="-lSDL2 -ldl -L./include/freetype -lfreetype"
+    LIBRARIES="-lSDL2 -ldl -pthread -lEGL -L./include/freetype -lfreetype"
 elif platform.system()=="Darwin":
     ARGUMENTS="-D MAC" # -D is a #define sent to the preprocessor.
     INCLUDE_DIR="-I ./include/ -I./../common/thirdparty/old/glm"
@@ -31,7 +34,14 @@ elif platform.system()=="Windows":
     LIBRARIES="-lmingw32 -lSDL2main -lSDL2 -mwindows -L./include/freetype -lfreetype"
 # (2)=================== Platform specific configuration ===================== #
 
+# A release build is optimized and defines NDEBUG
+if "release" in sys.argv[1:]:
+    ARGUMENTS+=" -O2 -D NDEBUG"
+
 # (3)====================== Building the Executable ========================== #
+# Compile the assets into a generated source file first, so it is part of SOURCE
+embed_assets.generate()
+
 # Build a string of our compile commands that we run in the terminal
 compileString=COMPILER+" "+ARGUMENTS+" -o "+EXECUTABLE+" "+" "+INCLUDE_DIR+" "+SOURCE+" "+LIBRARIES
 # Print out the compile string
@@ -0,0 +1,85 @@
+# Run with: python3 embed_assets.py (build.py runs it before compiling)
+#
+# Compiles the game's assets into the executable: every file in the asset
+# directories becomes a constexpr byte array, and every level file is also
+# parsed into a table of tile codes, all written to one generated source file
+# (see include/embedded_assets.hpp). The generated file is not checked in.
+import os
+import sys
+
+ASSET_DIRS=["shaders", "fonts", "textures", "levels"]   # Directories whose files are embedded
+LEVEL_EXTENSION=".lvl"                                   # Files that are also pre-parsed as levels
+SKIP_EXTENSIONS=[".btex"]                                # Files left on disk (baked textures are mapped from there)
+OUTPUT="./src/embedded_asset_data.cpp"                   # The generated source file
+
+HEADER="""/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+// generated by embed_assets.py from the asset directories, do not edit
+#include "embedded_assets.hpp"
+"""
+
+# the bytes as the body of a C array, 16 per line
+def byteArray(data):
+    lines=[]
+    for start in range(0, len(data), 16):
+        lines.append("    "+", ".join("0x%02x" % byte for byte in data[start:start+16])+",")
+    return "\n".join(lines)
+
+# a level file's tile codes, one row per non-empty line. Every row must be as wide as the first
+def parseLevel(path, text):
+    rows=[[int(word) for word in line.split()] for line in text.splitlines() if line.strip()]
+    for row in rows:
+        if len(row)!=len(rows[0]):
+            sys.exit("embed_assets.py: "+path+" has rows of different widths")
+        for tile in row:
+            if tile<0 or tile>255:
+                sys.exit("embed_assets.py: "+path+" has a tile code out of range: "+str(tile))
+    return rows
+
+def generate():
+    files=[]
+    for directory in ASSET_DIRS:
+        for name in sorted(os.listdir(directory)):
+            path=directory+"/"+name
+            if os.path.isfile(path) and os.path.splitext(name)[1] not in SKIP_EXTENSIONS:
+                with open(path, "rb") as f:
+                    files.append((path, f.read()))
+
+    source=[HEADER]
+    fileEntries=[]
+    levelEntries=[]
+    for index, (path, data) in enumerate(files):
+        source.append("// "+path)
+        source.append("constexpr unsigned char FILE_"+str(index)+"[] = {\n"+byteArray(data)+"\n    0x00};\n")
+        fileEntries.append('    {"'+path+'", FILE_'+str(index)+", "+str(len(data))+"},")
+        if path.endswith(LEVEL_EXTENSION):
+            rows=parseLevel(path, data.decode("ascii"))
+            tiles=bytes(tile for row in rows for tile in row)
+            width=len(rows[0]) if rows else 0
+            source.append("constexpr unsigned char LEVEL_"+str(index)+"[] = {\n"+byteArray(tiles)+"\n    0x00};\n")
+            levelEntries.append('    {"'+path+'", '+str(width)+", "+str(len(rows))+", LEVEL_"+str(index)+"},")
+
+    # (the tables always have at least one entry, so they are valid C++ even with nothing embedded)
+    source.append("extern const EmbeddedFile EMBEDDED_FILES[] = {\n"+"\n".join(fileEntries+['    {"", nullptr, 0}'])+"\n};")
+    source.append("extern const unsigned int EMBEDDED_FILE_COUNT = "+str(len(fileEntries))+";\n")
+    source.append("extern const EmbeddedLevel EMBEDDED_LEVELS[] = {\n"+"\n".join(levelEntries+['    {"", 0, 0, nullptr}'])+"\n};")
+    source.append("extern const unsigned int EMBEDDED_LEVEL_COUNT = "+str(len(levelEntries))+";\n")
+    generated="\n".join(source)
+
+    # only rewrite the file when an asset changed
+    if os.path.isfile(OUTPUT):
+        with open(OUTPUT, "r") as f:
+            if f.read()==generated:
+                return
+    with open(OUTPUT, "w") as f:
+        f.write(generated)
+    print("Embedded "+str(len(fileEntries))+" asset files ("+str(len(levelEntries))+" levels) into "+OUTPUT)
+
+if __name__=="__main__":
+    generate()
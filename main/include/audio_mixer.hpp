@@ -0,0 +1,112 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+#include <atomic>
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+#include "game.hpp"
+#include "spsc_queue.hpp"
+
+// AudioMixer plays the game's sounds on an SDL audio device. The sounds are
+// synthesized into PCM buffers at the device's rate when it is opened, and
+// mixed on SDL's audio callback thread, so neither the simulation nor the
+// render thread ever waits on audio: the simulation thread posts the sounds
+// of each tick through a lock-free queue (one push, which never blocks), and
+// the callback starts a voice for each from a fixed pool, stealing the
+// oldest when all are playing. Nothing on the callback thread allocates or
+// takes a lock. Runs without a sound card on SDL's dummy driver
+// (SDL_AUDIODRIVER=dummy), which still calls the callback in real time.
+class AudioMixer
+{
+public:
+    // sounds playing at once, and the sample rate asked of the device (it may pick another)
+    static const unsigned int VOICE_COUNT = 16;
+    static const int SAMPLE_RATE = 48000;
+
+    // constructor/destructor (closing the device)
+    AudioMixer();
+    ~AudioMixer();
+
+    // owns a device and a callback pointing at it, so it can not be copied
+    AudioMixer(const AudioMixer &) = delete;
+    AudioMixer &operator=(const AudioMixer &) = delete;
+
+    // opens the default audio device, synthesizes the sounds and starts playing at a volume from 0 to 1.
+    // Returns false (and the game stays silent) if there is no device
+    bool Open(float volume);
+
+    // stops playing and closes the device
+    void Close();
+
+    // whether the device is open
+    bool IsOpen() const { return this->device != 0; }
+
+    // producer (one thread only): plays the sounds, one bit per SoundEffect. Never blocks or allocates, sounds
+    // are dropped when the callback has fallen a whole queue behind
+    void Post(unsigned int sounds);
+
+    // consumer (the audio callback): mixes the next frames of every playing voice into mono 16 bit samples
+    void Mix(short *out, unsigned int frames);
+
+    // synthesizes the sounds at a sample rate (done by Open, and for mixing without a device)
+    void Synthesize(int rate);
+
+    // the device's sample rate (0 while closed), and counters of the sounds started, those dropped because the
+    // queue was full and those cut short to free a voice
+    int GetRate() const { return this->rate; }
+    unsigned int GetPlayed() const { return this->played.load(std::memory_order_relaxed); }
+    unsigned int GetDropped() const { return this->dropped.load(std::memory_order_relaxed); }
+    unsigned int GetStolen() const { return this->stolen.load(std::memory_order_relaxed); }
+
+private:
+    // a sound being played
+    struct Voice
+    {
+        const short *Samples;
+        unsigned int Length;
+        unsigned int Position;
+        // when the voice started, in voices started so far (the oldest is stolen first)
+        unsigned int Started;
+    };
+
+    // frames mixed at a time into the accumulator
+    static const unsigned int MIX_FRAMES = 256;
+
+    SDL_AudioDeviceID device;
+    int rate;
+    // the master volume, in 1/256ths
+    int gain;
+
+    // the samples of each sound, only written while no device is open
+    std::vector<short> sounds[SOUND_COUNT];
+
+    // sounds posted and not yet started, as SoundEffect bit masks
+    SpscQueue<unsigned int, 64> posted;
+
+    // the voice pool and the accumulator voices are summed into (both only touched by the callback)
+    Voice voices[VOICE_COUNT];
+    unsigned int started;
+    int accumulator[MIX_FRAMES];
+
+    std::atomic<unsigned int> played;
+    std::atomic<unsigned int> dropped;
+    std::atomic<unsigned int> stolen;
+
+    // starts a voice playing a sound
+    void Start(SoundEffect sound);
+
+    // SDL's audio callback
+    static void Callback(void *mixer, Uint8 *stream, int bytes);
+};
+
+#endif
@@ -0,0 +1,90 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "game.hpp"
+
+// Autopilot plays the game in place of the keyboard, for attract mode and
+// unattended benchmark and soak runs. It steers both paddles through the same
+// input bits a versus game uses (see Game::ProcessVersusInput), moving each
+// one under the point where a ball is predicted to come down to it. A ball's
+// path is traced analytically as straight segments: reflecting off the walls
+// BallObject::Move keeps it within (63 px from each side, and the top), and
+// off the bricks still standing, breaking the breakable ones on the way.
+// Tracing costs one pass over the bricks per bounce, so each prediction is
+// kept until the ball leaves it (it is no longer moving along the segment it
+// was on or the next one, e.g. after hitting a paddle) or a brick is destroyed.
+// Balls are met off center, to send them back towards the bricks left.
+class Autopilot
+{
+public:
+    // constructor
+    Autopilot();
+
+    // the input bits for Player (inputs[0]) and Player2 (inputs[1]) this tick
+    void Think(const Game &game, unsigned char inputs[2]);
+
+    // predictions traced and reused so far
+    unsigned long long Traced() const { return this->traced; }
+    unsigned long long Reused() const { return this->reused; }
+
+private:
+    // the most segments (bounces + 1) a traced path follows before giving up
+    static const unsigned int MAX_SEGMENTS = 64;
+
+    // where one ball will come down, traced from a known position and velocity
+    struct Prediction
+    {
+        bool Valid;
+        // where each segment of the path starts and the velocity along it, and the segment the ball is on now
+        glm::vec2 Starts[MAX_SEGMENTS];
+        glm::vec2 Velocities[MAX_SEGMENTS];
+        unsigned int Segments;
+        unsigned int Current;
+        // the ball center's x when it reaches each paddle's line (and whether it does), and when
+        float LandingX[2];
+        float LandingTime[2];
+        bool Lands[2];
+        // the breakable bricks that were standing when traced
+        unsigned int LiveBreakable;
+    };
+
+    Prediction predictions[2];
+
+    // the state read from the game each tick, and which bricks a trace has broken (both reused)
+    GameSave state;
+    std::vector<bool> broken;
+
+    // the middle of the breakable bricks still standing, which returned balls are aimed at, and the
+    // count of standing bricks it was found for
+    float aimX;
+    unsigned int aimLive;
+
+    // ticks a stuck ball has waited to be launched
+    unsigned int launchDelay;
+
+    unsigned long long traced;
+    unsigned long long reused;
+
+    // whether a ball is predicted to come down to a paddle that can get there in time
+    bool reaches(unsigned int ball, unsigned int paddle) const;
+
+    // whether a ball (by its center) is still on its predicted path
+    bool follows(Prediction &prediction, glm::vec2 center, glm::vec2 velocity);
+
+    // traces a ball's path down to both paddles' lines
+    void trace(const Game &game, unsigned int ball, Prediction &prediction);
+};
+
+#endif
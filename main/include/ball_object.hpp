@@ -27,10 +27,14 @@ public:
     bool Stuck;
     
     // constructor
-    BallObject(glm::vec2 pos, float radius, glm::vec2 velocity, Texture2D sprite);
+    BallObject(glm::vec2 pos, float radius, glm::vec2 velocity, TextureHandle sprite);
+    BallObject(glm::vec2 pos, float radius, glm::vec2 velocity);
     
     // moves the ball, keeping it constrained within the window bounds (except bottom edge); returns new position
     glm::vec2 Move(float dt, unsigned int window_width);
+
+    // the same in fixed point (see fixed_point.hpp), for a step of dt 1/256ths of a millisecond
+    glm::vec2 MoveFixed(int dt, unsigned int window_width);
     
     // resets the ball to original state with given position and velocity
     void Reset(glm::vec2 position, glm::vec2 velocity);
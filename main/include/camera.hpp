@@ -0,0 +1,62 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <chrono>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// The per-frame view state every shader program shares: the projection from
+// game coordinates to clip space, the viewport in pixels and the time since
+// startup. It is kept in a std140 uniform buffer bound to BINDING, which each
+// program's "Frame" block is bound to, so a resize only updates this buffer
+// instead of the projection uniform of every shader.
+class Camera
+{
+public:
+    // uniform buffer binding point the frame data is bound to
+    static const unsigned int BINDING = 0;
+
+    // constructor/destructor, taking the size of the game area in game coordinates
+    Camera(unsigned int width, unsigned int height);
+    ~Camera();
+
+    // sets the size of the game area the projection maps onto the viewport
+    void SetProjection(unsigned int width, unsigned int height);
+
+    // sets the part of the framebuffer, in pixels, that is drawn to
+    void SetViewport(int x, int y, int width, int height);
+
+    // uploads this frame's data, binds it to BINDING and sets the GL viewport. Called once at the start of each frame
+    void Apply();
+
+    // the current viewport as x, y, width, height
+    glm::ivec4 GetViewport() const;
+
+private:
+    // the uniform block, in std140 layout
+    struct Block
+    {
+        glm::mat4 Projection;
+        glm::vec4 Viewport;
+        float Time;
+        float Padding[3];
+    };
+
+    Block block;
+    unsigned int UBO;
+    std::chrono::steady_clock::time_point start;
+
+    Camera(const Camera &) = delete;
+    Camera &operator=(const Camera &) = delete;
+};
+
+#endif
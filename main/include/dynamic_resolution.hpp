@@ -0,0 +1,79 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// DynamicResolution renders frames into an offscreen color buffer at a
+// fraction of the viewport's size, then scales them up into the viewport,
+// adjusting that fraction to keep the GPU time of a frame near a target. The
+// time is measured with timer queries read back a few frames later, so
+// measuring never waits on the GPU. The buffer is allocated at the full
+// viewport size and frames render into its corner, so changing the scale
+// reallocates nothing; only a resize does.
+class DynamicResolution
+{
+public:
+    // the smallest fraction of the viewport's width and height rendered
+    static constexpr float MIN_SCALE = 0.5f;
+
+    // constructor/destructor, holding frames near targetMs of GPU time
+    DynamicResolution(float targetMs);
+    ~DynamicResolution();
+
+    // owns GL objects, so it can not be copied
+    DynamicResolution(const DynamicResolution &) = delete;
+    DynamicResolution &operator=(const DynamicResolution &) = delete;
+
+    // starts a frame that ends up in viewport (x, y, width, height in pixels of the framebuffer bound now):
+    // binds the color buffer and returns the part of it to draw to
+    glm::ivec4 Begin(glm::ivec4 viewport);
+
+    // scales the frame up into the viewport of the framebuffer bound at Begin, and picks the next frame's scale
+    void End();
+
+    // the fraction of the viewport's width and height rendered
+    float GetScale() const { return this->scale; }
+
+    // the smoothed GPU time of a frame in milliseconds (0 until the first measurement arrives)
+    float GetFrameMs() const { return this->frameMs; }
+
+private:
+    // frames in flight before a timer query is read back
+    static const unsigned int QUERY_COUNT = 4;
+
+    float targetMs;
+    float scale;
+    float frameMs;
+
+    // render target, sized to the largest viewport so far
+    unsigned int framebuffer;
+    unsigned int color;
+    glm::ivec2 size;
+
+    // the frame being drawn
+    glm::ivec4 viewport;
+    glm::ivec2 rendered;
+    int target;
+
+    // a timer query per frame in flight, and how many frames have been timed
+    unsigned int queries[QUERY_COUNT];
+    unsigned int frames;
+    // frames since the scale last changed
+    unsigned int settled;
+
+    // grows the render target to hold a width x height frame
+    void reserve(int width, int height);
+    // adjusts the scale from the latest frame time
+    void adjust();
+};
+
+#endif
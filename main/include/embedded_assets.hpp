@@ -0,0 +1,61 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef EMBEDDED_ASSETS_H
+#define EMBEDDED_ASSETS_H
+
+#include <string>
+
+// an asset file compiled into the executable, by its path relative to the game directory
+struct EmbeddedFile
+{
+    const char *Path;
+    const unsigned char *Data;
+    unsigned int Size;
+};
+
+// a level file parsed at build time into a table of tile codes, row by row
+struct EmbeddedLevel
+{
+    const char *Path;
+    unsigned int Width;
+    unsigned int Height;
+    const unsigned char *Tiles;
+};
+
+// EmbeddedAssets looks up the shaders, fonts, textures and levels that
+// embed_assets.py (run by build.py) compiles into the executable, so the
+// game starts without reading any files. Loaders ask for an asset here
+// first and only read it from disk if it was not embedded. Once an asset
+// is edited on disk it is overridden, and from then on is read from disk
+// so hot reload still sees the change. Safe to use from any thread.
+class EmbeddedAssets
+{
+public:
+    // the embedded copy of a file, or nullptr if it was not embedded (or has been overridden)
+    static const EmbeddedFile *Find(const std::string &path);
+    // the pre-parsed tiles of a level file, or nullptr if it was not embedded (or has been overridden)
+    static const EmbeddedLevel *FindLevel(const std::string &path);
+    // reads a whole asset into contents, from its embedded copy if there is one or else from disk
+    static bool Read(const std::string &path, std::string &contents);
+
+    // stops using the embedded copy of a file, once it has been edited on disk
+    static void Override(const std::string &path);
+
+private:
+    // whether a path has been overridden
+    static bool overridden(const std::string &path);
+};
+
+// the tables generated by embed_assets.py
+extern const EmbeddedFile EMBEDDED_FILES[];
+extern const unsigned int EMBEDDED_FILE_COUNT;
+extern const EmbeddedLevel EMBEDDED_LEVELS[];
+extern const unsigned int EMBEDDED_LEVEL_COUNT;
+
+#endif
@@ -0,0 +1,51 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// FileWatcher notices when watched files are rewritten on disk and runs the
+// callbacks registered for them. Uses inotify on Linux (watching each file's
+// directory, since most editors save by replacing the file); on other
+// platforms watching is unavailable and Poll never reports changes.
+// Callbacks run on whichever thread calls Poll.
+class FileWatcher
+{
+public:
+    // constructor/destructor
+    FileWatcher();
+    ~FileWatcher();
+
+    // a watcher owns an inotify descriptor, so it can not be copied
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    // runs onChange (from Poll) whenever the file at path is written or replaced
+    void Watch(const std::string &path, std::function<void()> onChange);
+
+    // runs the callbacks of every watched file changed since the last poll (once per file, however many
+    // times it was written), without blocking. Returns the number of files that changed
+    unsigned int Poll();
+
+private:
+    // the inotify descriptor, or -1 if watching is unavailable
+    int fd;
+
+    // directory of each inotify watch descriptor
+    std::map<int, std::string> directories;
+
+    // callbacks for each watched file, by path
+    std::map<std::string, std::vector<std::function<void()>>> callbacks;
+};
+
+#endif
@@ -0,0 +1,69 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <cmath>
+
+// Fixed-point numbers for the deterministic physics (PHYSICS_FIXED). Integer
+// arithmetic gives the same bits with every compiler, flag and CPU, where
+// float math may be contracted into FMAs, kept at a higher precision or
+// rounded differently by library functions. Positions and sizes are in
+// 1/4096ths of a unit (Q12), velocities in 1/2^20ths of a unit per
+// millisecond (Q20) and step lengths in 1/256ths of a millisecond (Q8).
+//
+// Games keep their state in floats either way: a fixed-point number of at
+// most 24 significant bits (a position within 4096 units, a velocity under 16
+// units per millisecond, or any whole number of units) is exactly a float, so
+// the fixed physics converts on the way in and out without losing anything,
+// and saves, snapshots, replays and rendering are the same for both modes.
+const int FIXED_POSITION_BITS = 12;
+const int FIXED_VELOCITY_BITS = 20;
+const int FIXED_TIME_BITS = 8;
+
+// a float in fixed point with the given fraction bits, rounded to the nearest (exact for floats already on the grid)
+inline int ToFixed(float value, int bits)
+{
+    return static_cast<int>(std::lround(std::ldexp(value, bits)));
+}
+
+// a fixed-point number with the given fraction bits as a float
+inline float FromFixed(int value, int bits)
+{
+    return std::ldexp(static_cast<float>(value), -bits);
+}
+
+// the product of two fixed-point numbers with shift fraction bits dropped, rounded to the nearest (shifting a
+// negative number right is arithmetic on every compiler this builds with)
+inline int FixedMultiply(int a, int b, int shift)
+{
+    return static_cast<int>((static_cast<long long>(a) * b + (1ll << (shift - 1))) >> shift);
+}
+
+// the square root of a 64 bit integer, rounded down (so a fixed-point square gives back its own format)
+inline unsigned long long FixedSqrt(unsigned long long value)
+{
+    unsigned long long root = 0, bit = 1ull << 62;
+    while (bit > value)
+        bit >>= 2;
+    while (bit != 0)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+            root >>= 1;
+        bit >>= 2;
+    }
+    return root;
+}
+
+#endif
@@ -0,0 +1,90 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <SDL2/SDL.h>
+
+// How a frame pacer decides when the next frame starts
+enum PacingMode
+{
+    PACING_VSYNC,          // swap waits for every vertical blank
+    PACING_ADAPTIVE_VSYNC, // like vsync, but late frames swap immediately instead of waiting another blank
+    PACING_CAPPED,         // sleep until a fixed interval has passed since the last frame
+    PACING_UNCAPPED        // never wait
+};
+
+// Pacing error measurements, all in milliseconds
+struct PacingStats
+{
+    double FrameTime;    // time between the last two frames
+    double LastError;    // how far the last frame missed its target (always positive)
+    double AverageError; // running average of the error
+    double MaxError;     // largest error since the stats were last reset
+    unsigned long long Frames;
+};
+
+// FramePacer keeps a loop running at a steady rate using the high resolution
+// performance counter. Capped waits sleep for the bulk of the remaining time
+// and spin for the last moment, since SDL_Delay can oversleep by a millisecond
+// or more. Vsync modes leave the waiting to the buffer swap and only measure.
+class FramePacer
+{
+public:
+    // constructor
+    FramePacer(double intervalMs, PacingMode mode = PACING_CAPPED);
+
+    // switches pacing mode, setting the swap interval for vsync modes (needs a current GL context
+    // unless the mode is capped or uncapped). Returns the mode actually in effect, which falls back
+    // from adaptive vsync to vsync to capped if the driver refuses
+    PacingMode SetMode(PacingMode mode);
+    PacingMode GetMode() const { return this->mode; }
+
+    // (re)starts pacing from now
+    void Start();
+
+    // waits until the next frame should begin (if the mode waits at all), returns the time since the previous frame in milliseconds
+    double Wait();
+
+    // pacing error measured so far
+    const PacingStats &GetStats() const { return this->stats; }
+    void ResetStats();
+
+    // parses a pacing mode name ("vsync", "adaptive", "capped" or "uncapped"), returns false if the name is unknown
+    static bool ParseMode(const char *name, PacingMode &mode);
+    static const char *ModeName(PacingMode mode);
+
+private:
+    // how close to the deadline we stop sleeping and start spinning
+    static const double SPIN_THRESHOLD_MS;
+
+    PacingMode mode;
+    double intervalMs;
+
+    // the display's refresh interval, which vsync modes are measured against
+    double refreshMs;
+
+    // performance counter ticks per millisecond, and the target interval in counter ticks
+    double ticksPerMs;
+    Uint64 intervalTicks;
+
+    // the next deadline and when the previous frame began, in counter ticks
+    Uint64 nextDeadline;
+    Uint64 lastFrame;
+
+    PacingStats stats;
+
+    // records the error of a frame against its target
+    void record(double frameTime, double error);
+
+    // the refresh interval of the display the pacer's window is on, in milliseconds
+    double refreshIntervalMs() const;
+};
+
+#endif
@@ -13,6 +13,14 @@
 
 #include "game_level.hpp"
 #include "ball_object.hpp"
+#include "resource_manager.hpp"
+
+class Palette;
+class Camera;
+class StreamBuffer;
+class TextRenderer;
+class TextObject;
+class DynamicResolution;
 
 // Represents the current state of the game
 enum GameState
@@ -22,14 +30,102 @@ enum GameState
     GAME_WIN
 };
 
+// How a game moves its balls and paddles and resolves their collisions
+enum GamePhysics
+{
+    PHYSICS_FLOAT, // glm float math
+    PHYSICS_FIXED  // integer fixed-point math (see fixed_point.hpp), bit-identical with every compiler and on every machine
+};
+
+// The controls of one player in a versus game, as bits of an input byte
+enum PlayerInput
+{
+    INPUT_LEFT = 1 << 0,
+    INPUT_RIGHT = 1 << 1,
+    INPUT_LAUNCH = 1 << 2,
+    INPUT_START = 1 << 3
+};
+
+// The sounds gameplay makes, as bits of a game's Sounds
+enum SoundEffect
+{
+    SOUND_BRICK,
+    SOUND_SOLID,
+    SOUND_PADDLE,
+    SOUND_WALL,
+    SOUND_LIFE_LOST,
+    SOUND_WIN,
+    SOUND_COUNT
+};
+
+// Everything a game changes while it is played, saved and restored to roll
+// the simulation back (the level layouts and loaded resources never change)
+struct GameSave
+{
+    GameState State;
+    unsigned int Level;
+    unsigned int Lives;
+    int Score;
+
+    // player paddles and balls
+    glm::vec2 PlayerPositions[2];
+    glm::vec2 PlayerSizes[2];
+    glm::vec2 BallPositions[2];
+    glm::vec2 BallVelocities[2];
+    bool BallStuck[2];
+    bool BallDead[2];
+
+    // which bricks of the current level are alive
+    std::vector<bool> BrickAlive;
+
+    // the play counters, so frames simulated again after a rollback are not counted twice
+    unsigned long long BricksBroken;
+    unsigned long long LivesLost;
+};
+
+// An immutable copy of everything needed to draw one frame, published by the
+// simulation thread and consumed by the render thread
+struct RenderSnapshot
+{
+    // game state when the snapshot was taken
+    GameState State;
+    unsigned int Level;
+    unsigned int Lives;
+    int Score;
+
+    // brick draw state of the current level, and which of those bricks are still alive
+    std::shared_ptr<const std::vector<SpriteState>> Bricks;
+    std::vector<bool> BrickAlive;
+
+    // player paddles and balls (the second of each is only drawn in Super Breakout)
+    SpriteState Players[2];
+    SpriteState Balls[2];
+
+    // increases by one with every snapshot taken
+    unsigned long long Sequence;
+};
+
+// The level files, in the order they are selected from the menu
+const char *const LEVEL_FILES[] = {"levels/one.lvl", "levels/two.lvl", "levels/three.lvl", "levels/four.lvl"};
+const unsigned int LEVEL_COUNT = sizeof(LEVEL_FILES) / sizeof(LEVEL_FILES[0]);
+
+// The palette strip the sprite colors are read from
+const char *const PALETTE_FILE = "textures/texture_sampler.png";
+
 // Initial size of the player paddle
 const glm::vec2 PLAYER_SIZE(80.0f, 15.0f);
 // Initial velocity of the player paddle
 const float PLAYER_VELOCITY(0.5f);
+// Initial velocity of the Ball
+const glm::vec2 INITIAL_BALL_VELOCITY(0.25f, -0.25f);
+// Radius of the ball object
+constexpr float BALL_RADIUS = 6;
 
 // Game holds all game-related state and functionality.
 // Combines all game-related data into a single class for
 // easy access to each of the components and manageability.
+// Every game keeps its own state, so any number of them can be
+// simulated side by side (only Init and Render need a GL context).
 class Game
 {
 public:
@@ -43,6 +139,9 @@ public:
     // width and height of window
     unsigned int Width, Height;
 
+    // how the game does its physics (chosen before playing, it is not part of the saved state)
+    GamePhysics Physics;
+
     // all game levels
     std::vector<GameLevel> Levels;
 
@@ -52,27 +151,148 @@ public:
     // lives remaining
     unsigned int Lives;
 
+    // player paddles and balls (the second of each is only in play in Super Breakout)
+    GameObject Player, Player2;
+    BallObject Ball, Ball2;
+
+    // the score of the current game
+    int Score;
+
+    // bricks destroyed and lives lost over every game played so far, for measuring play (never
+    // reset, but part of the saved state so restoring one takes back what the frames since counted)
+    unsigned long long BricksBroken;
+    unsigned long long LivesLost;
+
+    // the sounds made since whoever plays them last took them, one bit per SoundEffect (not part of the
+    // saved state, so restoring a save does not replay them)
+    unsigned int Sounds;
+
+    // draw the memory and GL resource counters over the game (only touched by the render thread)
+    bool ShowMemoryStats;
+
     // constructor/destructor
     Game(unsigned int width, unsigned int height);
     ~Game();
 
+    // owns its renderers and text through raw pointers, so it can not be copied
+    Game(const Game &) = delete;
+    Game &operator=(const Game &) = delete;
+
     // initialize game state (load all shaders/textures/levels)
     void Init();
 
+    // initialize only the simulation, without loading anything that needs GL: every level, or only
+    // the given one (leaving the others empty) for a game that never leaves it
+    void InitSimulation(int level = -1);
+
     // game loop
     void ProcessInput(float dt);
     void Update(float dt);
-    void Render();
+    void Render(const RenderSnapshot &snapshot);
+
+    // note a key being pressed or released
+    void SetKey(int key, bool pressed);
+
+    // copy the state needed to draw the current frame into a snapshot
+    void Snapshot(RenderSnapshot &snapshot);
+
+    // true for states where nothing moves without input (the menu and win screens)
+    static bool IsIdle(GameState state);
     void DoCollisions();
     void ResetLevel();
     void ResetPlayer();
 
+    // start playing a level from its beginning (with a fresh set of lives), as if it was picked on the menu
+    void StartLevel(unsigned int level);
+
+    // start a two player versus game on a Super Breakout level, where each player's paddle is
+    // driven by their own input bits instead of the shared keyboard
+    void StartVersus(unsigned int level);
+
+    // apply one versus frame's input bits, the first for Player and the second for Player2
+    void ProcessVersusInput(float dt, const unsigned char inputs[2]);
+
+    // the keyboard's controls as versus input bits (A/D move, SPACE launches, ENTER restarts)
+    unsigned char SampleInput() const;
+
+    // save or restore everything a game changes while it is played (restoring only within the same level
+    // layout). Saving into a reused save does not allocate
+    void SaveState(GameSave &save) const;
+    void LoadState(const GameSave &save);
+
+    // reload a level's bricks from its file, resetting that level's progress
+    void ReloadLevel(unsigned int level);
+
+    // set a shader's uniforms (again, after the shader has been reloaded)
+    void ConfigureShader(const std::string &name);
+
+    // draw to a framebuffer of a new size (in pixels) from the next frame on. The game area keeps its size in game
+    // units (so levels, physics and text layout are untouched) and is scaled to the largest centered viewport with
+    // its aspect ratio, leaving bars at the sides or top and bottom
+    void Resize(int width, int height);
+
+    // render each frame at a scale of the viewport that keeps its GPU time near targetMs, then scale it up
+    void EnableDynamicResolution(float targetMs);
+    const DynamicResolution *GetDynamicResolution() const { return this->resolution; }
+
+    // reload the sprite colors from the palette file
+    void ReloadPalette();
 private:
-    // check if a box and a ball have collided
-    void CheckBallBrickCollision(BallObject *Ball, GameObject &box);
+    // snapshots save and restore the private simulation state too
+    friend class GameSnapshot;
+
+    // render state, created by Init (null for games that are only simulated)
+    SpriteRenderer *renderer;
+    Palette *colors;
+    Camera *view;
+    // the part of the framebuffer the game area is drawn to, in pixels
+    glm::ivec4 viewport;
+    // renders at a lower resolution to hold a frame time (null unless enabled)
+    DynamicResolution *resolution;
+    ResourceId backgroundTexture;
+    StreamBuffer *stream;
+    TextRenderer *textLives;
+    TextRenderer *textMenu;
+
+    // retained text: the top bar values are only re-laid out when they change, the menu lines never
+    TextObject *livesText;
+    TextObject *scoreText;
+    TextObject *menuText[4];
+    TextObject *winText[2];
+
+    // the top bar values currently held by livesText and scoreText (-1 until first rendered)
+    int shownLives;
+    int shownScore;
+
+    // track if each ball has fallen off the bottom of the screen yet
+    bool ballDead;
+    bool ball2Dead;
+
+    // the number of render snapshots taken so far
+    unsigned long long snapshotSequence;
+
+    // draw the memory and GL resource counters
+    void RenderMemoryStats();
+
+    // take Ball2 and Player2 out of play, for normal Breakout
+    void RemoveSecondPlayer();
+
+    // check if a brick and a ball have collided
+    void CheckBallBrickCollision(BallObject *ball, GameLevel &level, unsigned int brick);
 
     // check if a player and a ball have collided
-    void CheckBallPlayerCollision(BallObject *Ball, GameObject *Player);
+    void CheckBallPlayerCollision(BallObject *ball, GameObject *player);
+
+    // which bricks the fixed physics' sweep found a ball touching (reused, so a step does not allocate)
+    std::vector<unsigned char> brickHits;
+
+    // DoCollisions and its checks in fixed point, resolving each ball against every brick it touches in turn
+    void DoCollisionsFixed();
+    void CheckBallBricksFixed(BallObject *ball, GameLevel &level);
+    void CheckBallPlayerCollisionFixed(BallObject *ball, GameObject *player);
+
+    // how far a paddle moves in a step of dt milliseconds
+    float PaddleStep(float dt) const;
 };
 
 #endif
\ No newline at end of file
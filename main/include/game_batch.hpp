@@ -0,0 +1,115 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef GAME_BATCH_H
+#define GAME_BATCH_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "game.hpp"
+
+// GameBatch steps many independent games of one level at once, for training
+// and evaluating agents. Every step takes two input bytes per game (the
+// PlayerInput bits for Player and Player2, as a versus game uses) and writes
+// packed arrays with one entry per game: OBSERVATION_SIZE floats describing
+// it, the reward (+1 for every brick destroyed, -1 for every life lost) and
+// whether its game ended (won or lost). An ended game starts over straight
+// away, so its observation is already of the next game.
+// The games are split into contiguous chunks, one per thread. Each chunk is
+// allocated and only ever touched by its own thread (the caller's thread
+// works the first one), so a game's memory stays together and local to the
+// core that steps it. Games are only simulated, so no GL context is needed.
+class GameBatch
+{
+public:
+    // floats describing each game: both paddles' x, both balls' x, y, velocity x and y (zero while out of
+    // play) and whether they are stuck to their paddle, the lives left, and the fraction of breakable bricks
+    // still standing. Positions are divided by the screen size, velocities by the initial ball speed
+    static const unsigned int OBSERVATION_SIZE = 14;
+
+    // constructor, for count games of a level (0 to LEVEL_COUNT - 1) each stepped by stepMs milliseconds, on
+    // the given number of threads (0 for one per core)
+    GameBatch(unsigned int count, unsigned int level, unsigned int threads = 0, float stepMs = 15.0f,
+              unsigned int width = 1000, unsigned int height = 750);
+    ~GameBatch();
+
+    GameBatch(const GameBatch &) = delete;
+    GameBatch &operator=(const GameBatch &) = delete;
+
+    // the number of games, and the threads stepping them
+    unsigned int Count() const { return this->count; }
+    unsigned int Threads() const { return static_cast<unsigned int>(this->chunks.size()); }
+
+    // restarts every game, writing count * OBSERVATION_SIZE observations
+    void Reset(float *observations);
+
+    // advances every game by one step with count * 2 input bytes, writing count * OBSERVATION_SIZE
+    // observations, count rewards and count done flags
+    void Step(const unsigned char *actions, float *observations, float *rewards, unsigned char *dones);
+
+    // a game, only to be read between steps (nullptr if there is no such game)
+    const Game *GetGame(unsigned int index) const;
+
+private:
+    // what the threads are asked to do to their chunks
+    enum Job
+    {
+        JOB_CREATE,
+        JOB_RESET,
+        JOB_STEP,
+        JOB_DESTROY
+    };
+
+    // the games one thread owns, the index of the first of them, and the thread (none for the first chunk)
+    struct Chunk
+    {
+        Game *Games;
+        unsigned int First;
+        unsigned int Count;
+        std::thread Thread;
+    };
+
+    unsigned int count;
+    unsigned int level;
+    float stepMs;
+    unsigned int width, height;
+
+    // breakable bricks in the level when it starts
+    unsigned int breakable;
+
+    std::vector<Chunk> chunks;
+
+    // the current job and its arrays
+    Job job;
+    const unsigned char *actions;
+    float *observations;
+    float *rewards;
+    unsigned char *dones;
+
+    // hands out jobs to the threads and waits for them to finish
+    std::mutex mutex;
+    std::condition_variable started;
+    std::condition_variable finished;
+    unsigned long long generation;
+    unsigned int running;
+    bool quitting;
+
+    // runs a job on every chunk, returning once all of them are done
+    void run(Job job);
+    // waits for jobs on one chunk's thread
+    void workerLoop(unsigned int chunk);
+    // does a job on one chunk
+    void work(Chunk &chunk, Job job);
+    // writes one game's observation
+    void observe(const Game &game, float *observation) const;
+};
+
+#endif
@@ -9,6 +9,7 @@
 #ifndef GAMELEVEL_H
 #define GAMELEVEL_H
 #include <vector>
+#include <memory>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -17,6 +18,17 @@
 #include "sprite_renderer.hpp"
 #include "resource_manager.hpp"
 
+// a breakable brick that was destroyed, queued by its level until the game consumes it
+struct BrickEvent
+{
+    // index of the brick in its level's Bricks
+    unsigned int Brick;
+    // where the brick was and what color it was drawn in
+    glm::vec2 Position;
+    glm::vec2 Size;
+    int ColorIndex;
+};
+
 /// GameLevel holds all Tiles as part of a Breakout level and
 /// hosts functionality to Load/render levels from the harddisk.
 class GameLevel
@@ -24,18 +36,45 @@ class GameLevel
 public:
     // level state
     std::vector<GameObject> Bricks;
+    // immutable copy of the bricks' draw state, shared with render snapshots. Replaced (never modified) on Load
+    std::shared_ptr<const std::vector<SpriteState>> Layout;
+    // breakable bricks destroyed since the events were last cleared, oldest first
+    std::vector<BrickEvent> Events;
     // constructor
-    GameLevel() {}
-    // loads level from file
+    GameLevel() : liveBreakable(0) {}
+    // loads level from file, using its tiles parsed at build time if it is embedded
     void Load(const char *file, unsigned int levelWidth, unsigned int levelHeight);
     // render level
     void Draw(SpriteRenderer &renderer);
+    // render a level layout, drawing only the bricks marked alive
+    static void Draw(SpriteRenderer &renderer, const std::vector<SpriteState> &layout, const std::vector<bool> &alive);
+    // destroy a breakable brick, queueing an event for it. Returns false for solid or already destroyed bricks
+    bool DestroyBrick(unsigned int brick);
     // check if the level is completed (all non-solid tiles are destroyed)
-    bool IsCompleted();
+    bool IsCompleted() const { return this->liveBreakable == 0; }
+    // copy out which bricks are alive (resizing alive in place, so a reused mask does not allocate)
+    void GetAlive(std::vector<bool> &alive) const;
+    // restore which bricks are alive from a mask copied out of this level, dropping any queued events
+    void SetAlive(const std::vector<bool> &alive);
+    // mark one breakable brick alive or destroyed without queueing an event (solid bricks are left alone)
+    void SetBrickAlive(unsigned int brick, bool alive);
+    // number of breakable bricks not destroyed yet
+    unsigned int LiveBreakable() const { return this->liveBreakable; }
+    // for the fixed physics: marks hits[i] 1 for every brick from first on whose rectangle a circle (center and
+    // radius in fixed point, see fixed_point.hpp) touches, and 0 for the others, destroyed or not. Branch free over
+    // the bricks' edges laid out side by side, a block of SWEEP_BLOCK bricks at a time, so it compiles to vector
+    // instructions. hits needs SweepSize() entries, and may be written before first (within its block)
+    void SweepFixed(int x, int y, int radius, unsigned int first, unsigned char *hits) const;
+    unsigned int SweepSize() const { return static_cast<unsigned int>(this->fixedLeft.size()); }
+    static const unsigned int SWEEP_BLOCK = 16;
 
 private:
-    // initialize level from tile data
-    void init(std::vector<std::vector<unsigned int>> tileData, unsigned int levelWidth, unsigned int levelHeight);
+    // breakable bricks not destroyed yet, counted on load and decremented by DestroyBrick
+    unsigned int liveBreakable;
+    // the bricks' edges in fixed point, one array per edge, set on load
+    std::vector<int> fixedLeft, fixedTop, fixedRight, fixedBottom;
+    // initialize level from tile data, width * height tile codes row by row
+    void init(const unsigned char *tiles, unsigned int width, unsigned int height, unsigned int levelWidth, unsigned int levelHeight);
 };
 
 #endif
\ No newline at end of file
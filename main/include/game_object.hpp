@@ -9,12 +9,29 @@
 #ifndef GAMEOBJECT_H
 #define GAMEOBJECT_H
 
+#include <type_traits>
+
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
 #include "texture.hpp"
 #include "sprite_renderer.hpp"
 
+// The subset of a game object's state needed to draw it. Copied into
+// render snapshots so the render thread never reads live game objects.
+struct SpriteState
+{
+    glm::vec2 Position, Size;
+    float Rotation;
+    int ColorIndex;
+    TextureHandle Sprite;
+};
+
+// The snapshot triple buffer is a global, constructed before GL is loaded, so the draw state may only refer to
+// textures by handle: anything owning a texture would make GL calls (through a null function pointer) before main
+static_assert(std::is_trivially_copyable<SpriteState>::value && std::is_trivially_default_constructible<TextureHandle>::value,
+              "SpriteState must not own GL objects");
+
 // Container object for holding all state relevant for a single
 // game object entity. Each object in the game likely needs the
 // minimal of state as described within GameObject.
@@ -28,14 +45,18 @@ public:
     bool IsSolid;
     bool Destroyed;
     
-    // render state
-    Texture2D Sprite;
+    // render state (no texture for flat colored objects)
+    TextureHandle Sprite;
     
-    // constructor
-    GameObject(glm::vec2 pos, glm::vec2 size, Texture2D sprite, int colorIndex = 0, glm::vec2 velocity = glm::vec2(0.0f, 0.0f));
+    // constructors, for a textured object and for a flat colored one drawn from the palette
+    GameObject(glm::vec2 pos, glm::vec2 size, TextureHandle sprite, int colorIndex = 0, glm::vec2 velocity = glm::vec2(0.0f, 0.0f));
+    GameObject(glm::vec2 pos, glm::vec2 size, int colorIndex, glm::vec2 velocity = glm::vec2(0.0f, 0.0f));
     
     // draw sprite
     virtual void Draw(SpriteRenderer &renderer);
+
+    // copy out the state needed to draw this object
+    SpriteState GetSpriteState() const;
 };
 
 #endif
\ No newline at end of file
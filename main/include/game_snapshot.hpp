@@ -0,0 +1,51 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef GAME_SNAPSHOT_H
+#define GAME_SNAPSHOT_H
+
+#include "game.hpp"
+
+// GameSnapshot saves everything a game changes while it is played into a
+// compact, fixed layout buffer, and restores a game from one, for
+// checkpoints, save states and rewinding. Neither allocates, so both take
+// microseconds. Snapshots are little endian, the same on every platform:
+//
+//   magic 'B' 'S', version, flags (bit 0: bricks stored as a delta)
+//   state, level, lives (u8 each), ball flags (u8: stuck 0, stuck 1, dead 0, dead 1)
+//   score (i32)
+//   paddle positions and sizes, ball positions and velocities (16 f32)
+//   brick count (u16), then the bricks: one alive bit per brick (least significant
+//   bit first), or as a delta, the number of destroyed bricks (u16) and their indices (u16 each)
+//
+// A delta lists the bricks destroyed since the level was loaded, so it is
+// smallest early on; Save only writes one when asked and it is the smaller.
+// A snapshot only restores into a game whose level has the same brick count.
+class GameSnapshot
+{
+public:
+    // bytes before the bricks
+    static const unsigned int HEADER_SIZE = 4 + 4 + 4 + 16 * 4 + 2;
+
+    // the largest snapshot of a level with this many bricks, in bytes
+    static unsigned int MaxSize(unsigned int bricks);
+
+    // saves a game into out, storing its bricks as a delta against the level's initial layout when asked
+    // (and that is smaller). Returns the snapshot's size, or 0 if it does not fit in capacity
+    static unsigned int Save(const Game &game, unsigned char *out, unsigned int capacity, bool delta = false);
+
+    // restores a game from a snapshot, dropping any queued brick events. Returns false (leaving the game
+    // untouched) if the snapshot is malformed or does not match the game's level
+    static bool Load(Game &game, const unsigned char *data, unsigned int size);
+
+private:
+    // private constructor, snapshots are only saved and loaded through the static functions
+    GameSnapshot() {}
+};
+
+#endif
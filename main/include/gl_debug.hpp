@@ -0,0 +1,115 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef GL_DEBUG_H
+#define GL_DEBUG_H
+
+#include <atomic>
+#include <ostream>
+#include <string>
+
+#include "gl_extensions.hpp"
+
+// The least severe debug messages that are collected
+enum DebugSeverity
+{
+    DEBUG_SEVERITY_NOTIFICATION,
+    DEBUG_SEVERITY_LOW,
+    DEBUG_SEVERITY_MEDIUM,
+    DEBUG_SEVERITY_HIGH
+};
+
+// One message the driver reported
+struct GLDebugMessage
+{
+    GLenum Source;
+    GLenum Type;
+    GLuint ID;
+    DebugSeverity Severity;
+    // the innermost debug scope open when the message arrived (a string literal, or nullptr outside any)
+    const char *Scope;
+    char Text[256];
+};
+
+// GLDebug has the driver report errors and warnings through a KHR_debug (or
+// ARB_debug_output) callback instead of the game polling glGetError after
+// calls, which stalls until the GPU thread catches up. Output is synchronous,
+// so each message arrives from within the call that caused it and is tagged
+// with the scope open there (asynchronous output may come later, from a
+// driver thread, when another scope is open). Messages are copied into a
+// fixed ring buffer without allocating; the main loop prints them once a frame.
+// Objects can be labelled, so the driver names them in its messages, and
+// scopes label the work in progress: both show up as debug groups in
+// RenderDoc or apitrace too. Everything is a no-op until Enable succeeds.
+class GLDebug
+{
+public:
+    // messages held until they are reported, any more are dropped (and counted)
+    static const unsigned int CAPACITY = 256;
+
+    // installs the callback and enables synchronous messages of at least the given severity, call after
+    // GLExtensions::Load. Returns false if the context can not report debug messages
+    static bool Enable(DebugSeverity minimum);
+
+    // whether the callback is installed
+    static bool Enabled() { return enabled.load(std::memory_order_relaxed); }
+
+    // parses a severity name (high, medium, low or notification)
+    static bool ParseSeverity(const std::string &name, DebugSeverity &severity);
+    static const char *SeverityName(DebugSeverity severity);
+
+    // names a GL object (GL_TEXTURE, GL_BUFFER, GL_PROGRAM...) in debug messages and tools
+    static void Label(GLenum identifier, GLuint name, const std::string &label);
+
+    // copies the collected messages out, returning how many (messages dropped since the last call are counted)
+    static unsigned int Drain(GLDebugMessage *out, unsigned int capacity, unsigned int &dropped);
+
+    // writes the collected messages to a stream, one line each, returning how many there were
+    static unsigned int Report(std::ostream &out);
+
+    // the innermost open scope, and opening or closing one (see GLDebugScope)
+    static const char *CurrentScope() { return scope.load(std::memory_order_relaxed); }
+    static const char *PushScope(const char *name);
+    static void PopScope(const char *previous);
+
+private:
+    // private constructor, all members are static
+    GLDebug() {}
+
+    static std::atomic<bool> enabled;
+    static std::atomic<const char *> scope;
+};
+
+// Labels the GL calls from its construction to the end of its scope in debug messages, if debug output is on
+class GLDebugScope
+{
+public:
+    GLDebugScope(const char *name)
+        : active(GLDebug::Enabled()), previous(this->active ? GLDebug::PushScope(name) : nullptr)
+    {
+    }
+    ~GLDebugScope()
+    {
+        if (this->active)
+            GLDebug::PopScope(this->previous);
+    }
+
+private:
+    bool active;
+    const char *previous;
+
+    GLDebugScope(const GLDebugScope &) = delete;
+    GLDebugScope &operator=(const GLDebugScope &) = delete;
+};
+
+// GL_DEBUG_SCOPE("name") labels the rest of the enclosing scope, the name must be a string literal
+#define GL_DEBUG_CONCAT_INNER(a, b) a##b
+#define GL_DEBUG_CONCAT(a, b) GL_DEBUG_CONCAT_INNER(a, b)
+#define GL_DEBUG_SCOPE(name) GLDebugScope GL_DEBUG_CONCAT(glDebugScope, __LINE__)(name)
+
+#endif
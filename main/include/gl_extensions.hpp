@@ -0,0 +1,111 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+// enums from newer GL versions than the loader was generated for
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+// KHR_debug (ARB_debug_output has the same values, without notifications, groups or labels)
+#ifndef GL_DEBUG_OUTPUT
+#define GL_DEBUG_OUTPUT 0x92E0
+#endif
+#ifndef GL_DEBUG_OUTPUT_SYNCHRONOUS
+#define GL_DEBUG_OUTPUT_SYNCHRONOUS 0x8242
+#endif
+#ifndef GL_CONTEXT_FLAG_DEBUG_BIT
+#define GL_CONTEXT_FLAG_DEBUG_BIT 0x00000002
+#endif
+#ifndef GL_DEBUG_SOURCE_API
+#define GL_DEBUG_SOURCE_API 0x8246
+#define GL_DEBUG_SOURCE_WINDOW_SYSTEM 0x8247
+#define GL_DEBUG_SOURCE_SHADER_COMPILER 0x8248
+#define GL_DEBUG_SOURCE_THIRD_PARTY 0x8249
+#define GL_DEBUG_SOURCE_APPLICATION 0x824A
+#define GL_DEBUG_SOURCE_OTHER 0x824B
+#endif
+#ifndef GL_DEBUG_TYPE_ERROR
+#define GL_DEBUG_TYPE_ERROR 0x824C
+#define GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR 0x824D
+#define GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR 0x824E
+#define GL_DEBUG_TYPE_PORTABILITY 0x824F
+#define GL_DEBUG_TYPE_PERFORMANCE 0x8250
+#define GL_DEBUG_TYPE_OTHER 0x8251
+#define GL_DEBUG_TYPE_MARKER 0x8268
+#define GL_DEBUG_TYPE_PUSH_GROUP 0x8269
+#define GL_DEBUG_TYPE_POP_GROUP 0x826A
+#endif
+#ifndef GL_DEBUG_SEVERITY_HIGH
+#define GL_DEBUG_SEVERITY_HIGH 0x9146
+#define GL_DEBUG_SEVERITY_MEDIUM 0x9147
+#define GL_DEBUG_SEVERITY_LOW 0x9148
+#define GL_DEBUG_SEVERITY_NOTIFICATION 0x826B
+#endif
+#ifndef GL_BUFFER
+#define GL_BUFFER 0x82E0
+#define GL_SHADER 0x82E1
+#define GL_PROGRAM 0x82E2
+#endif
+
+typedef void(APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+typedef void(APIENTRYP PFNGLDEBUGMESSAGECALLBACKPROC)(GLDEBUGPROC callback, const void *userParam);
+typedef void(APIENTRYP PFNGLDEBUGMESSAGECONTROLPROC)(GLenum source, GLenum type, GLenum severity, GLsizei count, const GLuint *ids, GLboolean enabled);
+typedef void(APIENTRYP PFNGLOBJECTLABELPROC)(GLenum identifier, GLuint name, GLsizei length, const GLchar *label);
+typedef void(APIENTRYP PFNGLPUSHDEBUGGROUPPROC)(GLenum source, GLuint id, GLsizei length, const GLchar *message);
+typedef void(APIENTRYP PFNGLPOPDEBUGGROUPPROC)();
+
+// Entry points beyond the GL 3.3 core functions glad loads. They are looked
+// up through the same loader glad used, and are null when the context does
+// not provide them, so check the matching Has* function before calling them.
+class GLExtensions
+{
+public:
+    // glBufferStorage (GL 4.4 or ARB_buffer_storage)
+    static PFNGLBUFFERSTORAGEPROC BufferStorage;
+
+    // glDebugMessageCallback and glDebugMessageControl (GL 4.3, KHR_debug or ARB_debug_output)
+    static PFNGLDEBUGMESSAGECALLBACKPROC DebugMessageCallback;
+    static PFNGLDEBUGMESSAGECONTROLPROC DebugMessageControl;
+
+    // glObjectLabel, glPushDebugGroup and glPopDebugGroup (GL 4.3 or KHR_debug only)
+    static PFNGLOBJECTLABELPROC ObjectLabel;
+    static PFNGLPUSHDEBUGGROUPPROC PushDebugGroup;
+    static PFNGLPOPDEBUGGROUPPROC PopDebugGroup;
+
+    // looks up the extension entry points, call right after glad has been loaded for the current context
+    static void Load(GLADloadproc load);
+
+    // true if immutable buffer storage (and with it persistent mapping) is available
+    static bool HasBufferStorage();
+
+    // true if the context can report debug messages through a callback
+    static bool HasDebugOutput();
+
+    // true if objects can be labelled and calls grouped for debug messages (KHR_debug rather than ARB_debug_output)
+    static bool HasDebugLabels();
+
+    // true if the context's version is at least major.minor
+    static bool HasVersion(int major, int minor);
+
+    // true if the context advertises the named extension
+    static bool HasExtension(const char *name);
+
+private:
+    // private constructor, all members are static
+    GLExtensions() {}
+};
+
+#endif
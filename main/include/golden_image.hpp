@@ -0,0 +1,45 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef GOLDEN_IMAGE_H
+#define GOLDEN_IMAGE_H
+
+#include <string>
+#include <vector>
+
+// An RGBA image, rows stored top first
+struct Image
+{
+    unsigned int Width, Height;
+    std::vector<unsigned char> Pixels;
+};
+
+// How much two images differ
+struct ImageDiff
+{
+    bool SameSize;
+    unsigned int MaxChannelError;  // largest difference of any one channel of any pixel
+    unsigned int DifferingPixels;  // pixels with any channel differing by more than the tolerance
+    double DifferingFraction;      // DifferingPixels over the number of pixels
+};
+
+// Utilities for checking rendered frames against stored "golden" PNGs
+namespace GoldenImage
+{
+    // loads a PNG as RGBA, returns false if it can not be read
+    bool Load(const std::string &path, Image &image);
+
+    // writes an image as an RGBA PNG, returns false if the file can not be written
+    bool Save(const std::string &path, const Image &image);
+
+    // compares two images, counting pixels with a channel more than tolerance apart. If diff is not
+    // null it is filled with an image highlighting the differing pixels in red
+    ImageDiff Compare(const Image &expected, const Image &actual, unsigned int tolerance, Image *diff = nullptr);
+}
+
+#endif
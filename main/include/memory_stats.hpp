@@ -0,0 +1,135 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+#include <cstddef>
+#include <string>
+#include <fstream>
+
+// The kinds of GL object whose live count is tracked
+enum GLObjectType
+{
+    GL_OBJECT_TEXTURE,
+    GL_OBJECT_BUFFER,
+    GL_OBJECT_VERTEX_ARRAY,
+    GL_OBJECT_PROGRAM,
+    GL_OBJECT_FRAMEBUFFER,
+    GL_OBJECT_RENDERBUFFER,
+    GL_OBJECT_SYNC,
+    GL_OBJECT_TYPE_COUNT
+};
+
+// The parts of the game host allocations are charged to
+enum MemorySubsystem
+{
+    MEMORY_OTHER,
+    MEMORY_RESOURCES,
+    MEMORY_LEVELS,
+    MEMORY_TEXT,
+    MEMORY_RENDER,
+    MEMORY_SIMULATION,
+    MEMORY_SUBSYSTEM_COUNT
+};
+
+// The counters at one point in time
+struct MemorySample
+{
+    double Time; // seconds since startup
+    long long GLObjects[GL_OBJECT_TYPE_COUNT];
+    long long TextureBytes; // estimated, textures and renderbuffers
+    long long BufferBytes;  // estimated, buffer objects
+    long long HostBytes[MEMORY_SUBSYSTEM_COUNT];
+    long long HostAllocations[MEMORY_SUBSYSTEM_COUNT]; // live allocations
+};
+
+// A static class keeping live counts of GL objects and estimates of the memory
+// behind them, plus the live host (operator new) allocations per subsystem.
+// GL counters are updated by whatever creates and deletes the objects; host
+// allocations are charged to the subsystem of the innermost MemoryScope on the
+// allocating thread and credited back to it when freed. Memory allocated by the
+// C libraries (FreeType, stb_image) with malloc is not seen. All counters are
+// atomic, so they can be updated and sampled from any thread.
+class MemoryStats
+{
+public:
+    // note GL objects being created or deleted
+    static void Created(GLObjectType type, int count = 1);
+    static void Deleted(GLObjectType type, int count = 1);
+
+    // adjust the estimated bytes held by textures (and renderbuffers) or buffer objects
+    static void AddTextureBytes(long long delta);
+    static void AddBufferBytes(long long delta);
+
+    // read every counter
+    static MemorySample Sample();
+
+    // a human readable summary of a sample, one line per group of counters
+    static std::string Report(const MemorySample &sample);
+
+    // display names
+    static const char *TypeName(GLObjectType type);
+    static const char *SubsystemName(MemorySubsystem subsystem);
+
+    // the subsystem host allocations on this thread are currently charged to
+    static MemorySubsystem CurrentSubsystem();
+
+    // used by the global allocation functions
+    static void HostAllocated(MemorySubsystem subsystem, std::size_t bytes);
+    static void HostFreed(MemorySubsystem subsystem, std::size_t bytes);
+
+private:
+    // private constructor, all members are static
+    MemoryStats() {}
+
+    friend class MemoryScope;
+};
+
+// Charges host allocations made on this thread to a subsystem until it goes out of scope
+class MemoryScope
+{
+public:
+    MemoryScope(MemorySubsystem subsystem);
+    ~MemoryScope();
+
+private:
+    MemorySubsystem previous;
+
+    MemoryScope(const MemoryScope &) = delete;
+    MemoryScope &operator=(const MemoryScope &) = delete;
+};
+
+// Appends a memory sample to a CSV file at a fixed interval, for long soak runs,
+// and on closing reports how much each counter grew over the run.
+class SoakLog
+{
+public:
+    SoakLog();
+
+    // starts logging to file every interval seconds; returns false if the file can not be opened
+    bool Open(const std::string &file, double interval);
+
+    // writes a sample if the interval has passed since the last one
+    void Poll();
+
+    // writes a final sample and prints the growth since the first one
+    void Close();
+
+    bool IsOpen() const;
+
+private:
+    std::ofstream out;
+    double interval;
+    double nextSample;
+    MemorySample first;
+
+    void write(const MemorySample &sample);
+};
+
+#endif
@@ -0,0 +1,50 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef OFFSCREEN_CONTEXT_H
+#define OFFSCREEN_CONTEXT_H
+
+#include <vector>
+
+// OffscreenContext creates an OpenGL context with no window, using EGL on a
+// surfaceless display (Mesa's llvmpipe provides one on machines without a
+// GPU or display server), and renders into a framebuffer object that can be
+// read back. Only available on Linux.
+class OffscreenContext
+{
+public:
+    // constructor/destructor
+    OffscreenContext();
+    ~OffscreenContext();
+
+    // an offscreen context owns EGL and GL objects, so it can not be copied
+    OffscreenContext(const OffscreenContext &) = delete;
+    OffscreenContext &operator=(const OffscreenContext &) = delete;
+
+    // creates the context (a debug context if asked), makes it current, loads GL and binds a width x height
+    // framebuffer to draw into. Returns false (after printing why) if any step fails
+    bool Create(unsigned int width, unsigned int height, bool debug = false);
+
+    // reads the framebuffer back as tightly packed RGBA rows, top row first
+    void ReadPixels(std::vector<unsigned char> &pixels);
+
+    // the renderer string of the context (e.g. "llvmpipe ...")
+    const char *Renderer() const;
+
+private:
+    unsigned int width, height;
+
+    // EGL display and context (void pointers so EGL headers are only needed in the source file)
+    void *display;
+    void *context;
+
+    // the framebuffer and its color attachment
+    unsigned int framebuffer, colorBuffer;
+};
+
+#endif
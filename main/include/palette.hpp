@@ -0,0 +1,51 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// The fixed set of flat colors sprites are drawn with, indexed by a game
+// object's color index. The colors are read once from a palette strip image
+// on the CPU and kept in a std140 uniform buffer that the sprite shader's
+// "Palette" block is bound to, so drawing a colored sprite needs no texture.
+class Palette
+{
+public:
+    // number of colors, matching the color indices used by the levels and game objects
+    static const unsigned int SIZE = 11;
+
+    // uniform buffer binding point the palette is bound to
+    static const unsigned int BINDING = 1;
+
+    // the colors, laid out as the shader's std140 vec4 array
+    glm::vec4 Colors[SIZE];
+
+    // constructor/destructor
+    Palette();
+    ~Palette();
+
+    // reads the colors from a palette strip image of equal width bands, where color index i is
+    // band i - 1 and index 0 wraps around to the last band (using the file's embedded copy if it has one).
+    // Returns false, keeping the old colors, if the file can not be read
+    bool Load(const char *file);
+
+    // uploads the colors into the uniform buffer (creating it the first time) and binds it to BINDING
+    void Upload();
+
+private:
+    // the uniform buffer holding the colors
+    unsigned int UBO;
+
+    Palette(const Palette &) = delete;
+    Palette &operator=(const Palette &) = delete;
+};
+
+#endif
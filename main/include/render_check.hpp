@@ -0,0 +1,42 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef RENDER_CHECK_H
+#define RENDER_CHECK_H
+
+#include <string>
+
+#include "game.hpp"
+#include "gl_debug.hpp"
+
+// Options for a headless render check run
+struct RenderCheckOptions
+{
+    std::string GoldenDirectory; // where <scene>.png goldens are read from (and failures written to)
+    bool UpdateGoldens;          // write every scene as its new golden instead of comparing
+    unsigned int Tolerance;      // largest per-channel difference that still counts as matching
+    double MaxDifferingFraction; // fraction of pixels allowed to exceed the tolerance
+    unsigned int BenchmarkFrames; // frames rendered (and timed) per scene
+    bool DebugOutput;            // render in a debug context, reporting GL debug messages after each scene
+    DebugSeverity DebugMinimum;  // the least severe debug messages reported
+};
+
+// RenderCheck renders a fixed set of game scenes without a window, times them
+// and compares the results against golden PNGs, so the renderer can be
+// benchmarked and regression tested on headless machines.
+namespace RenderCheck
+{
+    // default options: goldens/ directory, small tolerance for rasterizer differences
+    RenderCheckOptions DefaultOptions();
+
+    // creates an offscreen context, initializes the game and checks every scene.
+    // Returns 0 if every scene matched (or goldens were updated), 1 on a mismatch and 2 if rendering could not start
+    int Run(Game &game, unsigned int width, unsigned int height, const RenderCheckOptions &options);
+}
+
+#endif
@@ -0,0 +1,157 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "game.hpp"
+
+// What one recorded step does to the game
+enum ReplayKind
+{
+    REPLAY_KEYS,       // apply the keys, then ProcessInput and Update
+    REPLAY_KEYS_IDLE,  // apply the keys, then only ProcessInput (the menu and win screens)
+    REPLAY_VERSUS,     // ProcessVersusInput with the input bits, then Update
+    REPLAY_START_NEXT  // StartLevel on the level after the current one
+};
+
+// One step of a recorded game: everything the simulation loop fed into it
+struct ReplayFrame
+{
+    ReplayKind Kind;
+    // the keys that matter to the game (see REPLAY_KEYS) held during the step, and those released at some point
+    // since the last one (so a key released and pressed again within one step is pressed again)
+    unsigned char Keys;
+    unsigned char Released;
+    // the versus input bits for Player and Player2
+    unsigned char Inputs[2];
+    // the step's length in milliseconds
+    float Dt;
+};
+
+// Replay holds what recording and playing back have in common. The
+// simulation loop runs every step through Apply, recorded or not, so a
+// replay makes exactly the same calls the live game did.
+class Replay
+{
+public:
+    // the keys recorded, by their bit in ReplayFrame::Keys
+    static const int KEYS[6];
+    static const unsigned int KEY_COUNT = 6;
+
+    // the bit of a key in ReplayFrame::Keys, or 0 if it is not recorded
+    static unsigned char KeyBit(int key);
+
+    // the bits of the recorded keys currently held in a game, or already processed
+    static unsigned char HeldKeys(const Game &game);
+    static unsigned char ProcessedKeys(const Game &game);
+
+    // runs one step on a game
+    static void Apply(Game &game, const ReplayFrame &frame);
+
+private:
+    // private constructor, only the static functions are used
+    Replay() {}
+};
+
+// ReplayRecorder writes a game's steps to a replay file as they are played.
+// The file is split into chunks of a fixed number of steps, each starting
+// with a keyframe (a GameSnapshot of the game before its first step, and the
+// key state; the first chunk's is written on opening, so there always is
+// one), and ends with an index of the chunks, so a player can jump to
+// any step. Levels edited while recording are not captured.
+//
+//   header: 'B' 'R' 'P' 'L', version (u32), steps per chunk (u32), GamePhysics (u32)
+//   chunk: first step (u32), held keys, processed keys (u8 each), snapshot size (u16), snapshot,
+//          then one 9 byte step each: kind, keys, released keys, 2 input bytes (u8 each), dt (f32)
+//   index: first step and file offset (u32 each) of every chunk
+//   footer: step count, chunk count, index offset (u32 each), 'B' 'R' 'P' 'X'
+class ReplayRecorder
+{
+public:
+    // constructor/destructor (closing the file)
+    ReplayRecorder();
+    ~ReplayRecorder();
+
+    // starts recording a game to a file, with a keyframe of its state now and then every interval steps
+    bool Open(const std::string &path, const Game &game, unsigned int interval = 600);
+
+    // records a step, before it is applied to the game
+    void Record(const Game &game, const ReplayFrame &frame);
+
+    // writes the index and closes the file
+    void Close();
+
+    bool IsOpen() const { return this->file.is_open(); }
+    unsigned int Steps() const { return this->steps; }
+
+private:
+    std::ofstream file;
+    unsigned int interval;
+    unsigned int steps;
+    // the file offset of every chunk so far
+    std::vector<unsigned int> offsets;
+    unsigned int offset;
+    // reused snapshot buffer
+    std::vector<unsigned char> snapshot;
+
+    // starts a chunk with a keyframe of the game
+    void Keyframe(const Game &game);
+
+    // writes bytes, keeping track of the offset
+    void Write(const unsigned char *data, unsigned int size);
+};
+
+// ReplayPlayer plays a replay file back into a game. Seeking restores the
+// keyframe at or before the step sought and applies only the steps from
+// there (or carries on from the current step, when that is closer), so any
+// step of an hour long recording is reached in milliseconds.
+class ReplayPlayer
+{
+public:
+    // constructor
+    ReplayPlayer();
+
+    // reads a replay file (all of it, it is a few megabytes per hour)
+    bool Open(const std::string &path);
+
+    // the number of recorded steps, and the next one to be applied
+    unsigned int Steps() const { return this->steps; }
+    unsigned int Step() const { return this->step; }
+
+    // puts a game into its state before a step (Steps() for the end of the replay). The game's levels must be
+    // loaded as they were when recording. Returns false if the step's keyframe can not be restored
+    bool Seek(Game &game, unsigned int step);
+
+    // applies the next step to a game sought into, returning false at the end of the replay
+    bool Advance(Game &game);
+
+private:
+    std::vector<unsigned char> data;
+    unsigned int interval;
+    // the physics the recorded game had, which seeking gives the game played into
+    GamePhysics physics;
+    unsigned int steps;
+    // where each chunk starts, and where its steps start
+    std::vector<unsigned int> offsets;
+    std::vector<unsigned int> stepOffsets;
+    unsigned int step;
+    // whether the game is known to be at step (it is only ever changed by the player once it has sought)
+    bool positioned;
+
+    // reads a recorded step
+    ReplayFrame Frame(unsigned int step) const;
+    // restores a chunk's keyframe
+    bool Restore(Game &game, unsigned int chunk);
+};
+
+#endif
@@ -9,37 +9,92 @@
 #ifndef RESOURCE_MANAGER_H
 #define RESOURCE_MANAGER_H
 
-#include <map>
 #include <string>
+#include <vector>
+#include <unordered_map>
 
 #include <glad/glad.h>
 
 #include "texture.hpp"
 #include "shader.hpp"
 
+// Identifies a loaded resource by its slot in the resource manager's storage
+typedef unsigned int ResourceId;
+
 // A static singleton ResourceManager class that hosts several
 // functions to load Textures and Shaders. Each loaded texture
-// and/or shader is also stored for future reference by string
-// handles. All functions and resources are static and no
-// public constructor is defined.
+// and/or shader is stored in a dense array slot; string names
+// are interned into slot IDs once, when loading (or with
+// TextureId/ShaderId), so per-frame lookups are a plain array
+// index. Loading a file that is already loaded (by path or by
+// identical contents) reuses its slot instead of decoding and
+// uploading it again. Files are read from the copies embedded
+// in the executable when there are any (see EmbeddedAssets),
+// and textures are mapped pre-decoded from a container baked
+// from their file when there is an up to date one (see
+// TextureContainer).
+// All functions and resources are static and no public
+// constructor is defined.
 class ResourceManager
 {
 public:
-    // resource storage
-    static std::map<std::string, Shader> Shaders;
-    static std::map<std::string, Texture2D> Textures;
+    // returned by the ID lookups for names that were never loaded
+    static const ResourceId INVALID_ID = ~0u;
+
+    // where a shader's stages were loaded from (Geometry is empty if there is none), and the name it was first loaded as
+    struct ShaderSource
+    {
+        std::string Vertex, Fragment, Geometry;
+        std::string Name;
+        unsigned long long Hash;
+    };
+
+    // where a texture was loaded from, and the name it was first loaded as
+    struct TextureSource
+    {
+        std::string File;
+        bool Alpha;
+        std::string Name;
+        unsigned long long Hash;
+    };
+
+    // resource storage, indexed by ResourceId (the manager owns every loaded texture, everything else holds handles to them)
+    static std::vector<Shader> Shaders;
+    static std::vector<Texture2D> Textures;
+
+    // the files each stored resource was loaded from, so it can be reloaded in place, indexed by ResourceId
+    static std::vector<ShaderSource> ShaderSources;
+    static std::vector<TextureSource> TextureSources;
    
-    // loads (and generates) a shader program from file loading vertex, fragment (and geometry) shader's source code. If gShaderFile is not nullptr, it also loads a geometry shader
-    static Shader LoadShader(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, std::string name);
+    // loads (and generates) a shader program from file loading vertex, fragment (and geometry) shader's source code. If gShaderFile is not nullptr, it also loads a geometry shader.
+    // If the same files (or identical source) are already loaded, name refers to that program instead
+    static ResourceId LoadShader(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, std::string name);
    
-    // retrieves a stored sader
-    static Shader GetShader(std::string name);
+    // retrieves a stored shader
+    static Shader GetShader(ResourceId id);
+    static Shader GetShader(const std::string &name);
+
+    // the ID of a loaded shader, or INVALID_ID
+    static ResourceId ShaderId(const std::string &name);
    
-    // loads (and generates) a texture from file
-    static Texture2D LoadTexture(const char *file, bool alpha, std::string name);
+    // loads (and generates) a texture from file. If the same file (or identical image data) is already loaded, name refers to that texture instead
+    static ResourceId LoadTexture(const char *file, bool alpha, std::string name);
     
-    // retrieves a stored texture
-    static Texture2D GetTexture(std::string name);
+    // retrieves a stored texture (an empty handle if there is none)
+    static TextureHandle GetTexture(ResourceId id);
+    static TextureHandle GetTexture(const std::string &name);
+
+    // the ID of a loaded texture, or INVALID_ID
+    static ResourceId TextureId(const std::string &name);
+
+    // reloads a stored shader from its files into a new program, which replaces the stored one (its uniforms must be
+    // set again afterwards). The program ID changes, so hold shaders by ResourceId and look them up with GetShader:
+    // copies taken before the reload refer to a deleted program. Returns false, keeping the old program, if the
+    // new source does not compile or link
+    static bool ReloadShader(ResourceId id);
+
+    // reloads a stored texture from its file into the same texture ID. Returns false, keeping the old image, if the file can not be read
+    static bool ReloadTexture(ResourceId id);
     
     // properly de-allocates all loaded resources
     static void Clear();
@@ -47,12 +102,22 @@ public:
 private:
     // private constructor, that is we do not want any actual resource manager objects. Its members and functions should be publicly available (static).
     ResourceManager() {}
-    
-    // loads and generates a shader from file
-    static Shader loadShaderFromFile(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile = nullptr);
-    
-    // loads a single texture from file
-    static Texture2D loadTextureFromFile(const char *file, bool alpha);
+
+    // interned names, file paths and content hashes, each mapping to a slot
+    static std::unordered_map<std::string, ResourceId> shaderNames, textureNames;
+    static std::unordered_map<std::string, ResourceId> shaderPaths, texturePaths;
+    static std::unordered_map<unsigned long long, ResourceId> shaderHashes, textureHashes;
+
+    // reads the source code of a shader's stages, from their embedded copies if there are any
+    static void readShaderFiles(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile,
+                                std::string &vertexCode, std::string &fragmentCode, std::string &geometryCode);
+
+    // decodes an image held in memory into a texture
+    static Texture2D loadTextureFromMemory(const std::string &contents, bool alpha);
+
+    // uploads the container baked from a texture's file, if there is one baked from these contents with the
+    // channels the texture wants. Returns false if there is not
+    static bool loadBakedTexture(const std::string &file, const std::string &contents, bool alpha, Texture2D &texture);
 };
 
-#endif
\ No newline at end of file
+#endif
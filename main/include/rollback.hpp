@@ -0,0 +1,132 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef ROLLBACK_H
+#define ROLLBACK_H
+
+#include "game.hpp"
+#include "udp_socket.hpp"
+
+// Rollback measurements since the session started
+struct RollbackStats
+{
+    unsigned long long Frames;      // frames simulated for the first time
+    unsigned long long Rollbacks;   // mispredictions that rolled the game back
+    unsigned long long Resimulated; // frames simulated again after a rollback
+    unsigned int MaxRollback;       // most frames resimulated by one rollback
+    double MaxRollbackMs;           // longest a rollback (restore and resimulate) took
+    unsigned long long Stalls;      // ticks spent waiting for the peer instead of simulating
+    bool Desynced;                  // the peer's state checksum once disagreed with ours
+    bool PhysicsMismatch;           // the peer plays with other physics, so the game never started
+};
+
+// RollbackSession runs one side of a two player versus game over UDP. Every
+// tick the local player's input is sent to the peer and the next frame is
+// simulated straight away, predicting that the peer's input has not changed
+// since the last one received. When the peer's real input for an already
+// simulated frame arrives and differs from the prediction, the game is
+// restored to the state saved at the start of that frame and the frames since
+// are simulated again. A session never runs more than MAX_ROLLBACK frames
+// ahead of the peer's last confirmed input (it stalls instead), and stalls
+// the odd tick when it runs ahead of the peer, so both sides advance at the
+// same pace. Periodic checksums of confirmed frames detect desyncs.
+// Both sides must start from the same state (see Game::StartVersus) and
+// play with the same GamePhysics, which every packet carries: no frame is
+// simulated until a packet from the peer arrives, and none ever is if its
+// physics differs.
+class RollbackSession
+{
+public:
+    // the most frames a single rollback resimulates
+    static const unsigned int MAX_ROLLBACK = 8;
+    // frames of input kept on each side, more than can ever be unconfirmed at once
+    static const unsigned int INPUT_WINDOW = 128;
+    // the longest input delay whose inputs still fit in the window alongside a full rollback
+    static const unsigned int MAX_INPUT_DELAY = INPUT_WINDOW - MAX_ROLLBACK - 1;
+
+    // constructor, player is 0 (drives Player) or 1 (drives Player2). Every frame advances the game by frameMs,
+    // and local input takes effect inputDelay (at most MAX_INPUT_DELAY) frames after it is sampled
+    RollbackSession(Game &game, UdpSocket &socket, unsigned int player, float frameMs, unsigned int inputDelay = 0);
+
+    // receives the peer's inputs (rolling back if a prediction was wrong), then simulates the next frame with
+    // the local input unless it has to wait for the peer (or has not heard from it yet, or the peer plays with
+    // other physics). Returns true if a new frame was simulated
+    bool Tick(unsigned char localInput);
+
+    // the player this side drives, 0 or 1
+    unsigned int Player() const { return this->player; }
+
+    // the next frame to be simulated
+    int Frame() const { return this->frame; }
+
+    // whether anything has been received from a peer with the same physics yet
+    bool Connected() const { return this->peerFrame >= 0; }
+
+    const RollbackStats &GetStats() const { return this->stats; }
+
+private:
+    // saved states kept, one for every frame that can be rolled back to
+    static const unsigned int SAVE_COUNT = MAX_ROLLBACK + 2;
+    // confirmed frames are checksummed at this interval, and this many of our checksums are kept
+    static const unsigned int CHECKSUM_INTERVAL = 30;
+    static const unsigned int CHECKSUM_COUNT = 8;
+    // frames between attempts to slow down when running ahead of the peer
+    static const unsigned int SYNC_INTERVAL = 10;
+    // the most inputs sent in one packet
+    static const unsigned int MAX_PACKET_INPUTS = 64;
+
+    Game &game;
+    UdpSocket &socket;
+    unsigned int player;
+    float frameMs;
+    unsigned int inputDelay;
+
+    // next frame to simulate, and the newest frame up to which every input of the peer has arrived (-1 for none)
+    int frame;
+    int remoteConfirmed;
+    // the newest local frame the peer confirmed having, and the peer's latest frame and frame advantage
+    int localAcked;
+    int peerFrame;
+    int peerAdvantage;
+    // the oldest frame whose prediction turned out wrong, or -1
+    int rollbackTo;
+
+    // inputs by frame modulo INPUT_WINDOW: ours, the peer's (with the frame each slot holds), and the peer
+    // input each simulated frame used
+    unsigned char localInputs[INPUT_WINDOW];
+    unsigned char remoteInputs[INPUT_WINDOW];
+    int remoteFrames[INPUT_WINDOW];
+    unsigned char usedRemote[INPUT_WINDOW];
+
+    // the game state at the start of each recent frame, by frame modulo SAVE_COUNT
+    GameSave saves[SAVE_COUNT];
+
+    // checksums of our confirmed frames (frame -1 for unused slots), the next frame to checksum, and the peer's latest
+    int checksumFrames[CHECKSUM_COUNT];
+    unsigned long long checksums[CHECKSUM_COUNT];
+    int nextChecksum;
+    int peerChecksumFrame;
+    unsigned long long peerChecksum;
+
+    RollbackStats stats;
+
+    // handles every packet waiting from the peer
+    void receive();
+    // sends the local inputs the peer has not confirmed yet
+    void send();
+    // restores the oldest mispredicted frame and simulates every frame since again
+    void rollback();
+    // saves the state and simulates one frame
+    void simulate(int frame);
+    // the peer's input for a frame, predicting the last confirmed one if it has not arrived
+    unsigned char remoteInput(int frame) const;
+    // checksums newly confirmed frames and compares them to the peer's
+    void checkSync();
+};
+
+#endif
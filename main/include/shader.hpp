@@ -32,6 +32,13 @@ public:
    
     // compiles the shader from given source code
     void Compile(const char *vertexSource, const char *fragmentSource, const char *geometrySource = nullptr); // note: geometry source code is optional
+
+    // recompiles the shader from new source code into a new program, which replaces (and deletes) the old one
+    // once it links. If the new source fails to compile or link the old program is kept. Returns true if the
+    // program was replaced: the ID changes then, so copies of this shader refer to a deleted program (keep
+    // the stored one's ResourceId instead, see ResourceManager::ReloadShader), and the new program's uniforms
+    // need to be set
+    bool Relink(const char *vertexSource, const char *fragmentSource, const char *geometrySource = nullptr);
    
     // utility functions
     void SetFloat(const char *name, float value, bool useShader = false);
@@ -44,9 +51,15 @@ public:
     void SetVector4f(const char *name, const glm::vec4 &value, bool useShader = false);
     void SetMatrix4(const char *name, const glm::mat4 &matrix, bool useShader = false);
 
+    // binds one of the shader's uniform blocks to a uniform buffer binding point
+    void SetUniformBlock(const char *name, unsigned int binding);
+
 private:
-    // checks if compilation or linking failed and if so, print the error logs
-    void checkCompileErrors(unsigned int object, std::string type);
+    // checks if compilation or linking failed and if so, print the error logs. Returns true if there were no errors
+    bool checkCompileErrors(unsigned int object, std::string type);
+
+    // compiles a single shader stage, returns 0 (after printing the error log) if it failed to compile
+    unsigned int compileStage(GLenum stage, const char *source, std::string type);
 };
 
 #endif
\ No newline at end of file
@@ -9,32 +9,58 @@
 #ifndef SPRITE_RENDERER_H
 #define SPRITE_RENDERER_H
 
+#include <vector>
+
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "texture.hpp"
 #include "shader.hpp"
+#include "resource_manager.hpp"
+#include "stream_buffer.hpp"
+
+// The per-sprite data the sprite shader reads for each instance of the quad
+struct SpriteInstance
+{
+    glm::vec4 Rect; // position, size
+    float Rotation;
+    int ColorIndex;
+};
 
 class SpriteRenderer
 {
 public:
-    // Constructor (inits shaders/shapes)
-    SpriteRenderer(Shader &shader);
+    // Constructor (inits shapes) drawing with a stored shader, sprite data is streamed through the given buffer
+    SpriteRenderer(ResourceId shader, StreamBuffer &stream);
 
     // Destructor
     ~SpriteRenderer();
 
-    // Renders a defined quad textured with given sprite
-    void DrawSprite(const Texture2D &texture, glm::vec2 position, glm::vec2 size = glm::vec2(10.0f, 10.0f), float rotate = 0.0f, int colorIndex = 0);
+    // Renders a defined quad textured with given sprite, or in the palette color if the sprite has no texture
+    void DrawSprite(TextureHandle texture, glm::vec2 position, glm::vec2 size = glm::vec2(10.0f, 10.0f), float rotate = 0.0f, int colorIndex = 0);
+
+    // Queues a defined quad in a flat palette color, without binding any texture. Queued sprites
+    // are drawn together, in order, by the next Flush (or textured DrawSprite)
+    void DrawSprite(glm::vec2 position, glm::vec2 size, float rotate, int colorIndex);
+
+    // Draws every queued sprite in a single instanced draw call
+    void Flush();
 
 private:
-    // Render state
-    Shader shader;
-    unsigned int quadVAO;
+    // Render state (the shader is looked up on every draw, so reloading it takes effect straight away)
+    ResourceId shader;
+    unsigned int quadVAO, quadVBO;
+    StreamBuffer &stream;
+
+    // Flat colored sprites waiting for the next Flush
+    std::vector<SpriteInstance> batch;
 
     // Initializes and configures the quad's buffer and vertex attributes
     void initRenderData();
+
+    // Streams the sprite instances to the GPU and draws them
+    void drawInstances(const SpriteInstance *instances, unsigned int count);
 };
 
 #endif
\ No newline at end of file
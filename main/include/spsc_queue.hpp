@@ -0,0 +1,57 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+
+// A fixed capacity, lock-free queue with exactly one producer thread and one
+// consumer thread. Capacity must be a power of two. Push fails (instead of
+// allocating or blocking) when the queue is full.
+template <typename T, unsigned int Capacity>
+class SpscQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    // constructor
+    SpscQueue() : head(0), tail(0) {}
+
+    // producer: adds an item to the back of the queue, returns false if the queue is full
+    bool Push(const T &item)
+    {
+        unsigned int tail = this->tail.load(std::memory_order_relaxed);
+        if (tail - this->head.load(std::memory_order_acquire) == Capacity)
+            return false;
+        this->items[tail & (Capacity - 1)] = item;
+        this->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer: removes the item at the front of the queue, returns false if the queue is empty
+    bool Pop(T &item)
+    {
+        unsigned int head = this->head.load(std::memory_order_relaxed);
+        if (head == this->tail.load(std::memory_order_acquire))
+            return false;
+        item = this->items[head & (Capacity - 1)];
+        this->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    // queued items
+    T items[Capacity];
+
+    // read and write positions, kept on separate cache lines
+    alignas(64) std::atomic<unsigned int> head;
+    alignas(64) std::atomic<unsigned int> tail;
+};
+
+#endif
@@ -0,0 +1,74 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <deque>
+
+#include <glad/glad.h>
+
+// A large ring buffer that per-frame geometry is written into. Each write
+// takes the next free region of the ring; regions the GPU may still be
+// reading are guarded by fences, so writing never makes GL wait for a draw
+// to finish (it only waits, rarely, when the ring wraps around onto data from
+// a frame that is still in flight). When the context supports buffer storage
+// the ring is mapped once, persistently; otherwise each write maps just its
+// region unsynchronized.
+//
+// A write is Map, fill in the data, Unmap, then issue the draws that read it
+// before the next Map. Call Fence once per frame after the last draw.
+class StreamBuffer
+{
+public:
+    // default size of the ring in bytes
+    static const GLsizeiptr DEFAULT_SIZE = 1024 * 1024;
+
+    // the buffer object, to point vertex attributes at
+    unsigned int ID;
+
+    // constructor/destructor
+    StreamBuffer(GLsizeiptr size = DEFAULT_SIZE);
+    ~StreamBuffer();
+
+    // reserves size bytes starting at a multiple of alignment, returning where to write them and
+    // their offset in the buffer. Returns nullptr if size is larger than the whole ring
+    void *Map(GLsizeiptr size, GLsizeiptr alignment, GLintptr &offset);
+
+    // finishes the write started by Map, the data can be drawn from afterwards
+    void Unmap();
+
+    // marks everything written since the last fence as in use by the draws issued so far
+    void Fence();
+
+    // true if the ring is persistently mapped
+    bool IsPersistent() const;
+
+private:
+    // a fenced range of the ring
+    struct Region
+    {
+        GLsync Sync;
+        GLintptr Begin, End;
+    };
+
+    GLsizeiptr size;
+    GLintptr head;           // where the next write starts
+    GLintptr unfenced;       // start of the writes not yet covered by a fence
+    unsigned char *mapping;  // the persistent mapping of the whole ring, or nullptr
+    bool mapped;             // a region is mapped in the unsynchronized fallback
+    std::deque<Region> regions;
+
+    // waits until the GPU is done with every fenced region overlapping [begin, end)
+    void waitFor(GLintptr begin, GLintptr end);
+
+    StreamBuffer(const StreamBuffer &) = delete;
+    StreamBuffer &operator=(const StreamBuffer &) = delete;
+};
+
+#endif
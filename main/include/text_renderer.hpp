@@ -10,46 +10,103 @@
 #define TEXT_RENDERER_H
 
 #include <map>
+#include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
 #include "texture.hpp"
 #include "shader.hpp"
+#include "resource_manager.hpp"
+#include "stream_buffer.hpp"
 
 // Holds all state information relevant to a character as loaded using FreeType
 struct Character
 {
-    unsigned int TextureID; // ID handle of the glyph texture
+    unsigned int TextureID; // ID handle of the glyph texture (the font's atlas)
     glm::ivec2 Size;        // size of glyph
     glm::ivec2 Bearing;     // offset from baseline to left/top of glyph
     unsigned int Advance;   // horizontal offset to advance to next glyph
+    glm::vec2 UVMin;        // top left corner of the glyph in the atlas
+    glm::vec2 UVMax;        // bottom right corner of the glyph in the atlas
 };
 
 // A renderer class for rendering text displayed by a font loaded using the
 // FreeType library. A single font is loaded, processed into a list of Character
-// items for later rendering.
+// items packed into one atlas texture for later rendering.
 class TextRenderer
 {
 public:
     // holds a list of pre-compiled Characters
     std::map<char, Character> Characters;
     
-    // shader used for text rendering
-    Shader TextShader;
+    // shader used for text rendering, looked up on every draw so reloading it takes effect straight away
+    ResourceId TextShader;
   
-    // constructor
-    TextRenderer(unsigned int width, unsigned int height);
+    // constructor/destructor, RenderText streams its glyphs through the given buffer
+    TextRenderer(StreamBuffer &stream);
+    ~TextRenderer();
   
-    // pre-compiles a list of characters from the given font 
-    void Load(std::string font, unsigned int fontSize);
+    // pre-compiles a list of characters from the given font (its embedded copy if it has one)
+    void Load(const std::string &font, unsigned int fontSize);
    
     // renders a string of text using the precompiled list of characters
-    void RenderText(std::string text, float x, float y, float scale, glm::vec3 color = glm::vec3(1.0f));
+    void RenderText(const std::string &text, float x, float y, float scale, glm::vec3 color = glm::vec3(1.0f));
+
+    // lays out a string as two triangles per glyph (vec2 position, vec2 texCoords per vertex), appending to vertices
+    void Layout(const std::string &text, float x, float y, float scale, std::vector<float> &vertices);
+
+    // binds the text shader, the given color and the font's atlas ready to draw glyph quads
+    void Prepare(glm::vec3 color);
 
 private:
+    // render state
+    unsigned int VAO;
+    unsigned int Atlas;
+    long long atlasBytes;
+    StreamBuffer &stream;
+
+    // vertex data for RenderText, kept around so its storage is reused
+    std::vector<float> scratch;
+
+    // deletes the font's atlas texture, if there is one
+    void deleteAtlas();
+};
+
+// A piece of text whose glyphs are laid out once and kept on the GPU. Changing
+// the contents re-lays out and re-uploads the text; drawing unchanged text is a
+// single draw call with no CPU side layout.
+class TextObject
+{
+public:
+    // constructor/destructor
+    TextObject(TextRenderer &renderer, float x, float y, float scale, glm::vec3 color = glm::vec3(1.0f));
+    TextObject(TextRenderer &renderer, const std::string &text, float x, float y, float scale, glm::vec3 color = glm::vec3(1.0f));
+    ~TextObject();
+
+    // text objects own GL buffers, so they can not be copied
+    TextObject(const TextObject &) = delete;
+    TextObject &operator=(const TextObject &) = delete;
+
+    // changes the text, re-uploading the glyphs only if it actually differs
+    void SetText(const std::string &text);
+    const std::string &GetText() const { return this->text; }
+
+    // draws the text
+    void Draw();
+
+private:
+    TextRenderer &renderer;
+    std::string text;
+    float x, y, scale;
+    glm::vec3 color;
+
     // render state
     unsigned int VAO, VBO;
+    unsigned int vertexCount;
+    long long bufferBytes;
+    std::vector<float> vertices;
 };
 
-#endif
\ No newline at end of file
+#endif
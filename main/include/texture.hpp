@@ -11,16 +11,41 @@
 
 #include <glad/glad.h>
 
+// A lightweight, trivially copyable reference to a texture owned by a Texture2D,
+// for the places that only draw with it (game objects, render snapshots). It
+// does not keep the texture alive; an ID of zero means no texture.
+struct TextureHandle
+{
+    unsigned int ID;
+
+    // binds the texture as the current active GL_TEXTURE_2D texture object
+    void Bind() const;
+
+    // true if this refers to a texture
+    bool Valid() const { return this->ID != 0; }
+};
+
+// One mipmap level of an image ready to upload: tightly packed rows in the texture's image format
+struct TextureLevel
+{
+    unsigned int Width, Height;
+    const unsigned char *Data;
+};
+
 // Texture2D is able to store and configure a texture in OpenGL.
-// It also hosts utility functions for easy management.
+// It also hosts utility functions for easy management. It owns its
+// GL texture: constructing one does no GL work until Generate, moving
+// one hands the texture over, and destroying it deletes the texture.
 class Texture2D
 {
 public:
-    // holds the ID of the texture object, used for all texture operations to reference to this particular texture
+    // holds the ID of the texture object, used for all texture operations to reference to this particular texture.
+    // Zero until the texture is generated
     unsigned int ID;
    
     // texture image dimensions
     unsigned int Width, Height; // width and height of loaded image in pixels
+    unsigned int Levels; // mipmap levels stored, the image itself is level 0
  
     // texture Format
     unsigned int Internal_Format; // format of texture object
@@ -34,12 +59,38 @@ public:
    
     // constructor (sets default texture modes)
     Texture2D();
+
+    // destructor, deletes the texture
+    ~Texture2D();
+
+    // move only, there is exactly one owner of each texture
+    Texture2D(Texture2D &&other) noexcept;
+    Texture2D &operator=(Texture2D &&other) noexcept;
+    Texture2D(const Texture2D &) = delete;
+    Texture2D &operator=(const Texture2D &) = delete;
    
-    // generates texture from image data
+    // generates texture from image data (creating the texture the first time)
     void Generate(unsigned int width, unsigned int height, unsigned char* data);
+
+    // generates texture from an image and its mipmaps, each level half the size of the one before (sampled
+    // with the matching mipmap filter when there is more than one)
+    void Generate(const TextureLevel *levels, unsigned int count);
   
     // binds the texture as the current active GL_TEXTURE_2D texture object
     void Bind() const;
+
+    // a handle to this texture for use sites, valid as long as this texture is
+    TextureHandle Handle() const;
+
+    // estimated size of the texture's storage in bytes
+    long long Bytes() const;
+
+private:
+    // the storage size counted towards the GL memory stats
+    long long countedBytes;
+
+    // deletes the texture, if there is one
+    void release();
 };
 
 #endif
\ No newline at end of file
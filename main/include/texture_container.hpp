@@ -0,0 +1,75 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef TEXTURE_CONTAINER_H
+#define TEXTURE_CONTAINER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "texture.hpp"
+
+// A texture container (.btex) holds an image already decoded into the
+// pixels GL is given, so loading one is mapping the file and handing its
+// levels to glTexImage2D: no PNG decode and no copy. Containers are baked
+// from the PNG sources (see Bake, run by --bake-textures) into the same
+// directory, and record a hash of the PNG they came from, so one that is
+// older than its source is never used. Everything is little endian:
+//
+//   magic 'B' 'T' 'E' 'X', version (u32), source hash (u64)
+//   channels (3 or 4), width, height, level count (u32 each)
+//   per level: width, height, data offset, data size (u32 each)
+//   the levels' pixels, tightly packed rows, each level starting on a 4 byte boundary
+class TextureContainer
+{
+public:
+    // bytes before the level table, and of each entry in it
+    static const unsigned int HEADER_SIZE = 32;
+    static const unsigned int LEVEL_SIZE = 16;
+
+    // constructor/destructor (unmapping the file)
+    TextureContainer();
+    ~TextureContainer();
+
+    // a container maps a file, so it can not be copied
+    TextureContainer(const TextureContainer &) = delete;
+    TextureContainer &operator=(const TextureContainer &) = delete;
+
+    // maps a container file, checking that it was baked from a source with this hash. Returns false if there is
+    // no such file (quietly), or it is stale or malformed
+    bool Map(const std::string &path, unsigned long long sourceHash);
+
+    // releases the mapped file, invalidating the levels
+    void Unmap();
+
+    // the image's channels (3 for RGB, 4 for RGBA) and its levels, pointing into the mapped file
+    unsigned int GetChannels() const { return this->channels; }
+    const std::vector<TextureLevel> &GetLevels() const { return this->levels; }
+
+    // the container baked from a source file: its path with the extension replaced by .btex
+    static std::string PathFor(const std::string &source);
+
+    // the hash of a source file's bytes a container records
+    static unsigned long long HashSource(const std::string &bytes);
+
+    // decodes an image file's bytes (any format stb_image reads) and writes them to a container with 3 channels, or
+    // 4 if the image has alpha, and with a full chain of box filtered mipmaps if asked. Returns false if either fails
+    static bool Bake(const std::string &bytes, const std::string &path, bool mipmaps);
+
+private:
+    // the whole file, mapped (or read, where there is no mmap)
+    const unsigned char *data;
+    size_t size;
+    std::vector<unsigned char> buffer;
+
+    unsigned int channels;
+    std::vector<TextureLevel> levels;
+};
+
+#endif
@@ -0,0 +1,82 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <string>
+
+// A static class recording timed zones on every thread, to be written out
+// as a Chrome trace (JSON trace events) and viewed on a timeline in Perfetto
+// (ui.perfetto.dev) or chrome://tracing, where spikes that averages hide
+// stand out. Each thread appends the zones it closes to its own buffer
+// without locking (a lock is only taken the first time a thread records).
+// Recording is off until Start; while it is off a zone costs one relaxed
+// atomic load, and building with -D NO_TRACE removes the zones altogether.
+class Trace
+{
+public:
+    // starts recording, with times measured from now
+    static void Start();
+
+    // stops recording and writes every zone recorded so far to a Chrome trace JSON file. Returns false if
+    // it can not be written
+    static bool Write(const std::string &path);
+
+    // whether zones are being recorded
+    static bool Enabled() { return enabled.load(std::memory_order_relaxed); }
+
+    // names the calling thread on the timeline
+    static void SetThreadName(const char *name);
+
+    // nanoseconds since recording started
+    static long long Now();
+
+    // records a zone on the calling thread. The name must outlive the trace (a string literal)
+    static void Record(const char *name, long long start, long long end);
+
+private:
+    // private constructor, all members are static
+    Trace() {}
+
+    static std::atomic<bool> enabled;
+};
+
+// Records the time from its construction to the end of its scope as a zone, if tracing is on
+class TraceZone
+{
+public:
+    TraceZone(const char *name)
+        : name(Trace::Enabled() ? name : nullptr), start(this->name != nullptr ? Trace::Now() : 0)
+    {
+    }
+    ~TraceZone()
+    {
+        if (this->name != nullptr)
+            Trace::Record(this->name, this->start, Trace::Now());
+    }
+
+private:
+    const char *name;
+    long long start;
+
+    TraceZone(const TraceZone &) = delete;
+    TraceZone &operator=(const TraceZone &) = delete;
+};
+
+// TRACE_ZONE("name") times the rest of the enclosing scope
+#ifndef NO_TRACE
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(traceZone, __LINE__)(name)
+#else
+#define TRACE_ZONE(name)
+#endif
+
+#endif
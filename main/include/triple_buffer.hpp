@@ -0,0 +1,65 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// A lock-free triple buffer for handing the latest value of T from a single
+// producer thread to a single consumer thread. The producer always owns one
+// slot to write into, the consumer always owns one slot to read from, and the
+// third slot sits in the middle holding the most recently published value.
+// Neither side ever blocks, and the consumer skips any values it was too slow
+// to see, which is exactly what a renderer wants from a simulation.
+template <typename T>
+class TripleBuffer
+{
+public:
+    // constructor (slot 0 is written, slot 1 is in the middle, slot 2 is read)
+    TripleBuffer() : middle(1), writeIndex(0), readIndex(2) {}
+
+    // producer: the slot to fill before calling Publish
+    T &WriteBuffer() { return this->buffers[this->writeIndex]; }
+
+    // producer: hands the filled slot to the consumer and takes back the middle slot
+    void Publish()
+    {
+        unsigned int previous = this->middle.exchange(this->writeIndex | DIRTY_BIT, std::memory_order_acq_rel);
+        this->writeIndex = previous & INDEX_MASK;
+    }
+
+    // consumer: swaps in the most recently published slot, returns false if nothing new was published
+    bool Update()
+    {
+        if ((this->middle.load(std::memory_order_relaxed) & DIRTY_BIT) == 0)
+            return false;
+        unsigned int previous = this->middle.exchange(this->readIndex, std::memory_order_acq_rel);
+        this->readIndex = previous & INDEX_MASK;
+        return true;
+    }
+
+    // consumer: the slot most recently swapped in by Update
+    const T &ReadBuffer() const { return this->buffers[this->readIndex]; }
+
+private:
+    static const unsigned int INDEX_MASK = 3;
+    static const unsigned int DIRTY_BIT = 4;
+
+    // the three slots
+    T buffers[3];
+
+    // index of the middle slot, with DIRTY_BIT set when it holds an unread value
+    alignas(64) std::atomic<unsigned int> middle;
+
+    // slots owned by the producer and consumer respectively
+    alignas(64) unsigned int writeIndex;
+    alignas(64) unsigned int readIndex;
+};
+
+#endif
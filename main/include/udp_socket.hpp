@@ -0,0 +1,81 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#ifndef UDP_SOCKET_H
+#define UDP_SOCKET_H
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+// Simulated network conditions applied to outgoing packets, for testing
+// netplay on one machine
+struct NetworkConditions
+{
+    unsigned int LatencyMs; // every packet is held back this long
+    unsigned int JitterMs;  // plus a random extra delay of up to this long (so packets can arrive out of order)
+    unsigned int LossPercent;
+};
+
+// UdpSocket is a non-blocking UDP socket bound to a local port that
+// exchanges datagrams with a single peer. Outgoing packets can be delayed,
+// reordered and dropped to simulate a bad connection; delayed packets are
+// held until a later Send or Flush finds them due. Uses BSD sockets, so it
+// is unavailable on Windows, where Open always fails.
+class UdpSocket
+{
+public:
+    // constructor/destructor
+    UdpSocket();
+    ~UdpSocket();
+
+    // a socket owns its descriptor, so it can not be copied
+    UdpSocket(const UdpSocket &) = delete;
+    UdpSocket &operator=(const UdpSocket &) = delete;
+
+    // binds to a local port and resolves the peer (a host name or address), returns false on failure
+    bool Open(unsigned short localPort, const std::string &peerHost, unsigned short peerPort);
+    void Close();
+    bool IsOpen() const { return this->fd >= 0; }
+
+    // conditions applied to every packet sent from now on
+    void SetConditions(const NetworkConditions &conditions);
+
+    // sends a packet to the peer (or queues it, if latency is simulated)
+    void Send(const unsigned char *data, unsigned int size);
+
+    // sends the queued packets that are due
+    void Flush();
+
+    // receives one packet from the peer without blocking, returns its size or 0 if none is waiting
+    unsigned int Receive(unsigned char *data, unsigned int capacity);
+
+private:
+    // a packet held back to simulate latency
+    struct Pending
+    {
+        std::chrono::steady_clock::time_point Due;
+        std::vector<unsigned char> Data;
+    };
+
+    // the socket descriptor, or -1 if closed
+    int fd;
+
+    // the peer's address (a sockaddr_in), kept as bytes so the header needs no socket headers
+    unsigned char peer[16];
+
+    NetworkConditions conditions;
+    std::vector<Pending> pending;
+    std::mt19937 random;
+
+    // sends a packet straight away
+    void sendNow(const unsigned char *data, unsigned int size);
+};
+
+#endif
@@ -1,12 +1,21 @@
 #version 330 core
 in vec2 TexCoords;
+flat in int ColorIndex;
 out vec4 color;
 
 uniform sampler2D image;
-uniform int textureSamplerIndex;
+uniform bool useTexture;
 
-// set up the color a game sprite like a block or the ball, picking from the textureSampler
+layout (std140) uniform Palette
+{
+    vec4 colors[11];
+};
+
+// set up the color of a game sprite like a block or the ball, either a flat color picked from the palette or a textured sprite
 void main()
 {    
-   color = texture(image, vec2(textureSamplerIndex/10.0f - 0.01f, 0.5));
-}  
\ No newline at end of file
+   if (useTexture)
+      color = texture(image, TexCoords);
+   else
+      color = colors[ColorIndex];
+}  
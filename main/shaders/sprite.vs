@@ -1,14 +1,27 @@
 #version 330 core
 layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>
+layout (location = 1) in vec4 rect;   // <vec2 position, vec2 size>, per sprite
+layout (location = 2) in float rotation;
+layout (location = 3) in int colorIndex;
 
 out vec2 TexCoords;
+flat out int ColorIndex;
 
-uniform mat4 model;
-uniform mat4 projection;
+layout (std140) uniform Frame
+{
+    mat4 projection;
+    vec4 viewport;
+    float time;
+};
 
-// set up the position of a game sprite like a block or the ball
+// set up the position of a game sprite like a block or the ball, scaling the unit quad to its rect and rotating it around the rect's center
 void main()
 {
     TexCoords = vertex.zw;
-    gl_Position = projection * model * vec4(vertex.xy, 0.0, 1.0);
-}
\ No newline at end of file
+    ColorIndex = colorIndex;
+    vec2 offset = (vertex.xy - 0.5) * rect.zw;
+    float c = cos(rotation);
+    float s = sin(rotation);
+    vec2 position = rect.xy + 0.5 * rect.zw + vec2(c * offset.x - s * offset.y, s * offset.x + c * offset.y);
+    gl_Position = projection * vec4(position, 0.0, 1.0);
+}
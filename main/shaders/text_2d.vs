@@ -2,11 +2,16 @@
 layout (location = 0) in vec4 vertex; // <vec2 pos, vec2 tex>
 out vec2 TexCoords;
 
-uniform mat4 projection;
+layout (std140) uniform Frame
+{
+    mat4 projection;
+    vec4 viewport;
+    float time;
+};
 
 // set up the position of written text
 void main()
 {
     gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
     TexCoords = vertex.zw;
-} 
\ No newline at end of file
+} 
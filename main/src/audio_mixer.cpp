@@ -0,0 +1,196 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "audio_mixer.hpp"
+
+// A sound: a square wave moving from one pitch to another over its length,
+// either gliding or in a number of even steps (notes), each fading out
+struct Tone
+{
+    float StartHz;
+    float EndHz;
+    unsigned int Ms;
+    // 0 to glide, otherwise how many notes
+    unsigned int Steps;
+    float Volume;
+};
+
+// the sounds, in SoundEffect order
+const Tone TONES[SOUND_COUNT] = {
+    {880.0f, 880.0f, 50, 1, 0.35f},     // SOUND_BRICK
+    {220.0f, 220.0f, 70, 1, 0.35f},     // SOUND_SOLID
+    {440.0f, 440.0f, 60, 1, 0.4f},      // SOUND_PADDLE
+    {660.0f, 660.0f, 25, 1, 0.2f},      // SOUND_WALL
+    {440.0f, 110.0f, 600, 0, 0.4f},     // SOUND_LIFE_LOST
+    {523.25f, 1046.5f, 640, 4, 0.35f}}; // SOUND_WIN
+
+// frames the device is asked to fetch per callback (about 5 ms at 48 kHz)
+const Uint16 DEVICE_FRAMES = 256;
+
+// constructor
+AudioMixer::AudioMixer()
+    : device(0), rate(0), gain(256), voices(), started(0), accumulator(), played(0), dropped(0), stolen(0)
+{
+}
+
+// destructor
+AudioMixer::~AudioMixer()
+{
+    this->Close();
+}
+
+// open the default device and start playing
+bool AudioMixer::Open(float volume)
+{
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0)
+    {
+        std::cout << "ERROR::AUDIO_MIXER: Could not initialize audio: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    // mono 16 bit samples, at whatever rate the device prefers
+    SDL_AudioSpec want, have;
+    SDL_zero(want);
+    want.freq = SAMPLE_RATE;
+    want.format = AUDIO_S16SYS;
+    want.channels = 1;
+    want.samples = DEVICE_FRAMES;
+    want.callback = AudioMixer::Callback;
+    want.userdata = this;
+    this->device = SDL_OpenAudioDevice(nullptr, 0, &want, &have, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+    if (this->device == 0)
+    {
+        std::cout << "ERROR::AUDIO_MIXER: Could not open an audio device: " << SDL_GetError() << std::endl;
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        return false;
+    }
+
+    // the device starts paused, so the callback does not run until the sounds are ready
+    this->gain = static_cast<int>(std::min(std::max(volume, 0.0f), 1.0f) * 256.0f);
+    this->Synthesize(have.freq);
+    SDL_PauseAudioDevice(this->device, 0);
+    return true;
+}
+
+// stop playing and close the device
+void AudioMixer::Close()
+{
+    if (this->device == 0)
+        return;
+    // waits for a callback in progress to return
+    SDL_CloseAudioDevice(this->device);
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    this->device = 0;
+}
+
+// post a tick's sounds to the callback
+void AudioMixer::Post(unsigned int sounds)
+{
+    if (sounds != 0 && !this->posted.Push(sounds))
+        this->dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+// synthesize every sound at a sample rate
+void AudioMixer::Synthesize(int rate)
+{
+    this->rate = rate;
+    for (unsigned int sound = 0; sound < SOUND_COUNT; ++sound)
+    {
+        const Tone &tone = TONES[sound];
+        std::vector<short> &samples = this->sounds[sound];
+        samples.resize(static_cast<size_t>(rate) * tone.Ms / 1000);
+        float phase = 0.0f;
+        for (size_t i = 0; i < samples.size(); ++i)
+        {
+            // how far through the sound, and through its current note
+            float t = static_cast<float>(i) / static_cast<float>(samples.size());
+            float note = tone.Steps == 0 ? t : t * tone.Steps - std::floor(t * tone.Steps);
+            float pitch = tone.Steps == 0 ? t : (tone.Steps > 1 ? std::floor(t * tone.Steps) / (tone.Steps - 1) : 0.0f);
+
+            // pitch moves evenly in octaves, so a glide sounds even and the steps are in tune
+            float hz = tone.StartHz * std::pow(tone.EndHz / tone.StartHz, pitch);
+            phase += hz / static_cast<float>(rate);
+            phase -= std::floor(phase);
+            float square = phase < 0.5f ? 1.0f : -1.0f;
+            samples[i] = static_cast<short>(square * (1.0f - note) * tone.Volume * 32767.0f);
+        }
+    }
+}
+
+// start a voice, taking the oldest one if every voice is playing
+void AudioMixer::Start(SoundEffect sound)
+{
+    Voice *voice = nullptr;
+    for (Voice &candidate : this->voices)
+    {
+        if (candidate.Samples == nullptr)
+        {
+            voice = &candidate;
+            break;
+        }
+        if (voice == nullptr || candidate.Started - voice->Started > 0x80000000u)
+            voice = &candidate;
+    }
+    if (voice->Samples != nullptr)
+        this->stolen.fetch_add(1, std::memory_order_relaxed);
+
+    const std::vector<short> &samples = this->sounds[sound];
+    voice->Samples = samples.empty() ? nullptr : samples.data();
+    voice->Length = static_cast<unsigned int>(samples.size());
+    voice->Position = 0;
+    voice->Started = this->started++;
+    this->played.fetch_add(1, std::memory_order_relaxed);
+}
+
+// mix the playing voices
+void AudioMixer::Mix(short *out, unsigned int frames)
+{
+    // start the sounds posted since the last callback
+    unsigned int sounds;
+    while (this->posted.Pop(sounds))
+    {
+        for (unsigned int sound = 0; sound < SOUND_COUNT; ++sound)
+        {
+            if (sounds & (1u << sound))
+                this->Start(static_cast<SoundEffect>(sound));
+        }
+    }
+
+    while (frames > 0)
+    {
+        // sum the voices at full precision, then scale and clip once
+        unsigned int count = frames < MIX_FRAMES ? frames : MIX_FRAMES;
+        std::fill(this->accumulator, this->accumulator + count, 0);
+        for (Voice &voice : this->voices)
+        {
+            if (voice.Samples == nullptr)
+                continue;
+            unsigned int length = std::min(count, voice.Length - voice.Position);
+            const short *samples = voice.Samples + voice.Position;
+            for (unsigned int i = 0; i < length; ++i)
+                this->accumulator[i] += samples[i];
+            voice.Position += length;
+            if (voice.Position == voice.Length)
+                voice.Samples = nullptr;
+        }
+        for (unsigned int i = 0; i < count; ++i)
+            out[i] = static_cast<short>(std::min(std::max((this->accumulator[i] * this->gain) >> 8, -32768), 32767));
+        out += count;
+        frames -= count;
+    }
+}
+
+// fill the device's buffer
+void AudioMixer::Callback(void *mixer, Uint8 *stream, int bytes)
+{
+    static_cast<AudioMixer *>(mixer)->Mix(reinterpret_cast<short *>(stream), static_cast<unsigned int>(bytes) / sizeof(short));
+}
@@ -0,0 +1,286 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <cmath>
+#include <limits>
+
+#include "autopilot.hpp"
+
+// How far from each side BallObject::Move keeps the ball
+const float WALL_MARGIN = 63.0f;
+
+// Paddles closer than this to where they should be stay put, rather than jittering either side of it
+const float DEAD_ZONE = 6.0f;
+
+// How far (in pixels) a ball can stray from its predicted path and still be on it, as the game's
+// collision response nudges balls out of what they hit
+const float PATH_TOLERANCE = 4.0f;
+
+// Ticks a stuck ball is left on its paddle before being launched
+const unsigned int LAUNCH_DELAY = 30;
+
+// constructor
+Autopilot::Autopilot()
+    : predictions(), aimX(0.0f), aimLive(~0u), launchDelay(0), traced(0), reused(0)
+{
+}
+
+// the input bits for both paddles this tick
+void Autopilot::Think(const Game &game, unsigned char inputs[2])
+{
+    inputs[0] = inputs[1] = 0;
+    if (game.State != GAME_ACTIVE)
+        return;
+
+    game.SaveState(this->state);
+    const GameLevel &level = game.Levels[game.Level];
+    unsigned int paddles = game.Level > 0 ? 2 : 1;
+
+    // predict where each ball in play comes down, reusing the last prediction while the ball follows it
+    bool stuck = false;
+    for (unsigned int ball = 0; ball < paddles; ++ball)
+    {
+        Prediction &prediction = this->predictions[ball];
+        if (this->state.BallDead[ball] || this->state.BallStuck[ball])
+        {
+            prediction.Valid = false;
+            stuck |= this->state.BallStuck[ball];
+            continue;
+        }
+        if (prediction.Valid && prediction.LiveBreakable == level.LiveBreakable() &&
+            this->follows(prediction, this->state.BallPositions[ball] + glm::vec2(BALL_RADIUS), this->state.BallVelocities[ball]))
+            ++this->reused;
+        else
+        {
+            this->trace(game, ball, prediction);
+            ++this->traced;
+        }
+    }
+
+    // find the middle of the bricks left whenever one is broken
+    if (this->aimLive != level.LiveBreakable())
+    {
+        float sum = 0.0f;
+        unsigned int count = 0;
+        for (const GameObject &brick : level.Bricks)
+        {
+            if (!brick.IsSolid && !brick.Destroyed)
+            {
+                sum += brick.Position.x + brick.Size.x / 2.0f;
+                ++count;
+            }
+        }
+        this->aimX = count > 0 ? sum / count : game.Width / 2.0f;
+        this->aimLive = level.LiveBreakable();
+    }
+
+    // each paddle goes for the ball that comes down to it first (of those still above it, and that it can reach
+    // in time). The lower paddle (Player) leaves a ball the upper one (Player2) is going for to it, unless that
+    // is the only ball it can get to
+    int chosen[2] = {-1, -1};
+    for (int paddle = static_cast<int>(paddles) - 1; paddle >= 0; --paddle)
+    {
+        int fallback = -1;
+        for (unsigned int ball = 0; ball < paddles; ++ball)
+        {
+            if (!this->reaches(ball, paddle))
+                continue;
+            const Prediction &prediction = this->predictions[ball];
+            if (paddle == 0 && chosen[1] == static_cast<int>(ball))
+            {
+                fallback = static_cast<int>(ball);
+                continue;
+            }
+            if (chosen[paddle] < 0 || prediction.LandingTime[paddle] < this->predictions[chosen[paddle]].LandingTime[paddle])
+                chosen[paddle] = static_cast<int>(ball);
+        }
+        if (chosen[paddle] < 0)
+            chosen[paddle] = fallback;
+    }
+
+    for (unsigned int paddle = 0; paddle < paddles; ++paddle)
+    {
+        float halfWidth = this->state.PlayerSizes[paddle].x / 2.0f;
+        float center = this->state.PlayerPositions[paddle].x + halfWidth;
+
+        // meet the ball off center, so it bounces back towards the bricks left (never straight up, where
+        // it would bounce between the paddle and the same column forever), or wait in the middle
+        float target = game.Width / 2.0f;
+        if (chosen[paddle] >= 0)
+        {
+            float landing = this->predictions[chosen[paddle]].LandingX[paddle];
+            float hit = glm::clamp((this->aimX - landing) / 300.0f, -0.8f, 0.8f);
+            if (std::abs(hit) < 0.2f)
+                hit = hit < 0.0f ? -0.2f : 0.2f;
+            target = landing - hit * halfWidth;
+        }
+
+        if (target < center - DEAD_ZONE)
+            inputs[paddle] |= INPUT_LEFT;
+        else if (target > center + DEAD_ZONE)
+            inputs[paddle] |= INPUT_RIGHT;
+    }
+
+    // launch stuck balls after a moment
+    if (stuck && ++this->launchDelay >= LAUNCH_DELAY)
+    {
+        inputs[0] |= INPUT_LAUNCH;
+        this->launchDelay = 0;
+    }
+}
+
+// whether a ball is predicted to come down to a paddle that can get there in time
+bool Autopilot::reaches(unsigned int ball, unsigned int paddle) const
+{
+    const Prediction &prediction = this->predictions[ball];
+    if (!prediction.Valid || !prediction.Lands[paddle])
+        return false;
+
+    // a ball already past the paddle's top is out of its reach
+    float line = this->state.PlayerPositions[paddle].y - BALL_RADIUS;
+    glm::vec2 center = this->state.BallPositions[ball] + glm::vec2(BALL_RADIUS);
+    if (center.y > line)
+        return false;
+
+    // on its last segment the time left is exact, before that the paddle is given the benefit of the doubt
+    if (prediction.Current + 1 < prediction.Segments)
+        return true;
+    float timeLeft = (line - center.y) / prediction.Velocities[prediction.Current].y;
+    float paddleCenter = this->state.PlayerPositions[paddle].x + this->state.PlayerSizes[paddle].x / 2.0f;
+    float distance = std::abs(prediction.LandingX[paddle] - paddleCenter) - this->state.PlayerSizes[paddle].x / 2.0f;
+    return distance <= PLAYER_VELOCITY * timeLeft;
+}
+
+// whether a ball is still on its predicted path
+bool Autopilot::follows(Prediction &prediction, glm::vec2 center, glm::vec2 velocity)
+{
+    // it is either still on the same segment or has bounced onto the next one
+    for (unsigned int segment = prediction.Current; segment < prediction.Segments && segment <= prediction.Current + 1; ++segment)
+    {
+        glm::vec2 difference = glm::abs(prediction.Velocities[segment] - velocity);
+        if (difference.x > 1e-5f || difference.y > 1e-5f)
+            continue;
+
+        // and close to the line the segment runs along
+        glm::vec2 offset = center - prediction.Starts[segment];
+        float distance = std::abs(offset.x * velocity.y - offset.y * velocity.x) / glm::length(velocity);
+        if (distance <= PATH_TOLERANCE)
+        {
+            prediction.Current = segment;
+            return true;
+        }
+    }
+    return false;
+}
+
+// traces a ball's path down to both paddles' lines
+void Autopilot::trace(const Game &game, unsigned int ball, Prediction &prediction)
+{
+    const GameLevel &level = game.Levels[game.Level];
+    const float radius = BALL_RADIUS;
+    const float minX = WALL_MARGIN + radius, maxX = game.Width - WALL_MARGIN - radius;
+
+    prediction.Valid = false;
+    prediction.Segments = 0;
+    prediction.Current = 0;
+    prediction.LiveBreakable = level.LiveBreakable();
+    float lines[2];
+    for (unsigned int paddle = 0; paddle < 2; ++paddle)
+    {
+        prediction.Lands[paddle] = false;
+        lines[paddle] = this->state.PlayerPositions[paddle].y - radius;
+    }
+
+    // follow the ball's center, breaking bricks only in this copy of which are broken
+    glm::vec2 position = this->state.BallPositions[ball] + glm::vec2(radius);
+    glm::vec2 velocity = this->state.BallVelocities[ball];
+    this->broken.assign(level.Bricks.size(), false);
+    float time = 0.0f;
+    while (prediction.Segments < MAX_SEGMENTS)
+    {
+        prediction.Starts[prediction.Segments] = position;
+        prediction.Velocities[prediction.Segments++] = velocity;
+
+        // the nearest thing along this segment: a side wall, the top, or a brick (grown by the ball's radius)
+        float nearest = std::numeric_limits<float>::infinity();
+        bool flipX = false;
+        int hitBrick = -1;
+        if (velocity.x < 0.0f)
+            nearest = (minX - position.x) / velocity.x, flipX = true;
+        else if (velocity.x > 0.0f)
+            nearest = (maxX - position.x) / velocity.x, flipX = true;
+        if (velocity.y < 0.0f && (radius - position.y) / velocity.y < nearest)
+            nearest = (radius - position.y) / velocity.y, flipX = false;
+
+        for (unsigned int i = 0; i < level.Bricks.size(); ++i)
+        {
+            const GameObject &brick = level.Bricks[i];
+            if (brick.Destroyed || this->broken[i])
+                continue;
+
+            // slab test against the grown box, entering it no earlier than now
+            glm::vec2 low = brick.Position - glm::vec2(radius), high = brick.Position + brick.Size + glm::vec2(radius);
+            float enterX = -std::numeric_limits<float>::infinity(), exitX = std::numeric_limits<float>::infinity();
+            float enterY = enterX, exitY = exitX;
+            if (velocity.x != 0.0f)
+            {
+                float a = (low.x - position.x) / velocity.x, b = (high.x - position.x) / velocity.x;
+                enterX = std::min(a, b), exitX = std::max(a, b);
+            }
+            else if (position.x < low.x || position.x > high.x)
+                continue;
+            if (velocity.y != 0.0f)
+            {
+                float a = (low.y - position.y) / velocity.y, b = (high.y - position.y) / velocity.y;
+                enterY = std::min(a, b), exitY = std::max(a, b);
+            }
+            else if (position.y < low.y || position.y > high.y)
+                continue;
+
+            float enter = std::max(enterX, enterY);
+            if (enter > 1e-3f && enter < std::min(exitX, exitY) && enter < nearest)
+            {
+                nearest = enter;
+                flipX = enterX > enterY;
+                hitBrick = static_cast<int>(i);
+            }
+        }
+
+        // note where the ball crosses each paddle's line on the way down, before it hits anything
+        if (velocity.y > 0.0f)
+        {
+            for (unsigned int paddle = 0; paddle < 2; ++paddle)
+            {
+                float reach = (lines[paddle] - position.y) / velocity.y;
+                if (!prediction.Lands[paddle] && reach >= 0.0f && reach <= nearest)
+                {
+                    prediction.Lands[paddle] = true;
+                    prediction.LandingX[paddle] = position.x + velocity.x * reach;
+                    prediction.LandingTime[paddle] = time + reach;
+                }
+            }
+            // the lower paddle's line is the last one that matters
+            if (prediction.Lands[0] || position.y > lines[0])
+                break;
+        }
+        if (!std::isfinite(nearest))
+            break;
+
+        // bounce and go on
+        position += velocity * nearest;
+        time += nearest;
+        if (flipX)
+            velocity.x = -velocity.x;
+        else
+            velocity.y = -velocity.y;
+        if (hitBrick >= 0 && !level.Bricks[hitBrick].IsSolid)
+            this->broken[hitBrick] = true;
+    }
+
+    prediction.Valid = prediction.Lands[0] || prediction.Lands[1];
+}
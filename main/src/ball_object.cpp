@@ -7,11 +7,16 @@
 ** option) any later version.
 ******************************************************************/
 #include "ball_object.hpp"
+#include "fixed_point.hpp"
 
 // construct a new ball
-BallObject::BallObject(glm::vec2 pos, float radius, glm::vec2 velocity, Texture2D sprite)
+BallObject::BallObject(glm::vec2 pos, float radius, glm::vec2 velocity, TextureHandle sprite)
     : GameObject(pos, glm::vec2(radius * 2.0f, radius * 2.0f), sprite, 8, velocity), Radius(radius), Stuck(true) {}
 
+// construct a new flat colored ball
+BallObject::BallObject(glm::vec2 pos, float radius, glm::vec2 velocity)
+    : BallObject(pos, radius, velocity, TextureHandle{0}) {}
+
 // move the ball each frame
 glm::vec2 BallObject::Move(float dt, unsigned int window_width)
 {
@@ -46,6 +51,43 @@ glm::vec2 BallObject::Move(float dt, unsigned int window_width)
     return this->Position;
 }
 
+// move the ball each frame in fixed point
+glm::vec2 BallObject::MoveFixed(int dt, unsigned int window_width)
+{
+    if (!this->Stuck)
+    {
+        // a velocity times a step leaves VELOCITY_BITS + TIME_BITS fraction bits, moving by it POSITION_BITS
+        const int shift = FIXED_VELOCITY_BITS + FIXED_TIME_BITS - FIXED_POSITION_BITS;
+        glm::ivec2 position(ToFixed(this->Position.x, FIXED_POSITION_BITS), ToFixed(this->Position.y, FIXED_POSITION_BITS));
+        glm::ivec2 velocity(ToFixed(this->Velocity.x, FIXED_VELOCITY_BITS), ToFixed(this->Velocity.y, FIXED_VELOCITY_BITS));
+        position.x += FixedMultiply(velocity.x, dt, shift);
+        position.y += FixedMultiply(velocity.y, dt, shift);
+
+        // bounce off the left, right and top walls
+        const int wall = 63 << FIXED_POSITION_BITS;
+        int right = (static_cast<int>(window_width) << FIXED_POSITION_BITS) - wall - ToFixed(this->Size.x, FIXED_POSITION_BITS);
+        if (position.x <= wall)
+        {
+            velocity.x = -velocity.x;
+            position.x = wall;
+        }
+        else if (position.x >= right)
+        {
+            velocity.x = -velocity.x;
+            position.x = right;
+        }
+        if (position.y <= 0)
+        {
+            velocity.y = -velocity.y;
+            position.y = 0;
+        }
+
+        this->Position = glm::vec2(FromFixed(position.x, FIXED_POSITION_BITS), FromFixed(position.y, FIXED_POSITION_BITS));
+        this->Velocity = glm::vec2(FromFixed(velocity.x, FIXED_VELOCITY_BITS), FromFixed(velocity.y, FIXED_VELOCITY_BITS));
+    }
+    return this->Position;
+}
+
 // resets the ball to initial Stuck Position (if ball is outside window bounds)
 void BallObject::Reset(glm::vec2 position, glm::vec2 velocity)
 {
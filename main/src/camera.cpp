@@ -0,0 +1,67 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "camera.hpp"
+#include "memory_stats.hpp"
+
+// constructor, the viewport starts out covering the game area one pixel per unit
+Camera::Camera(unsigned int width, unsigned int height)
+    : block(), UBO(0), start(std::chrono::steady_clock::now())
+{
+    this->SetProjection(width, height);
+    this->SetViewport(0, 0, width, height);
+
+    glGenBuffers(1, &this->UBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, this->UBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_DYNAMIC_DRAW);
+    MemoryStats::Created(GL_OBJECT_BUFFER);
+    MemoryStats::AddBufferBytes(sizeof(Block));
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+// destructor
+Camera::~Camera()
+{
+    glDeleteBuffers(1, &this->UBO);
+    MemoryStats::Deleted(GL_OBJECT_BUFFER);
+    MemoryStats::AddBufferBytes(-static_cast<long long>(sizeof(Block)));
+}
+
+// map the game area onto clip space with the origin in the top left corner
+void Camera::SetProjection(unsigned int width, unsigned int height)
+{
+    this->block.Projection = glm::ortho(0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f, -1.0f, 1.0f);
+}
+
+// set the part of the framebuffer that is drawn to
+void Camera::SetViewport(int x, int y, int width, int height)
+{
+    this->block.Viewport = glm::vec4(x, y, width, height);
+}
+
+// upload and bind this frame's data
+void Camera::Apply()
+{
+    this->block.Time = std::chrono::duration<float>(std::chrono::steady_clock::now() - this->start).count();
+
+    glBindBuffer(GL_UNIFORM_BUFFER, this->UBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &this->block);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, this->UBO);
+
+    glm::ivec4 viewport = this->GetViewport();
+    glViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+}
+
+// the current viewport
+glm::ivec4 Camera::GetViewport() const
+{
+    return glm::ivec4(this->block.Viewport);
+}
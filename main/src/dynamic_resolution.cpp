@@ -0,0 +1,140 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "dynamic_resolution.hpp"
+#include "memory_stats.hpp"
+#include "gl_debug.hpp"
+
+// how much each frame time moves the smoothed frame time
+const float FRAME_SMOOTHING = 0.2f;
+// frames the smoothed time is given to follow a new scale before the scale changes again
+const unsigned int SETTLE_FRAMES = 12;
+// below this fraction of the target there is room to render more pixels
+const float HEADROOM = 0.8f;
+// scales are multiples of this, so a steady frame time settles on one scale instead of drifting
+const float SCALE_STEP = 1.0f / 32.0f;
+
+// constructor, frames start out at full resolution
+DynamicResolution::DynamicResolution(float targetMs)
+    : targetMs(targetMs), scale(1.0f), frameMs(0.0f), framebuffer(0), color(0), size(0), viewport(0), rendered(0), target(0),
+      queries(), frames(0), settled(0)
+{
+    glGenFramebuffers(1, &this->framebuffer);
+    MemoryStats::Created(GL_OBJECT_FRAMEBUFFER);
+    glGenQueries(QUERY_COUNT, this->queries);
+}
+
+// destructor
+DynamicResolution::~DynamicResolution()
+{
+    glDeleteQueries(QUERY_COUNT, this->queries);
+    glDeleteFramebuffers(1, &this->framebuffer);
+    MemoryStats::Deleted(GL_OBJECT_FRAMEBUFFER);
+    if (this->color != 0)
+    {
+        glDeleteTextures(1, &this->color);
+        MemoryStats::Deleted(GL_OBJECT_TEXTURE);
+        MemoryStats::AddTextureBytes(-4ll * this->size.x * this->size.y);
+    }
+}
+
+// bind the color buffer, scaled down from the viewport
+glm::ivec4 DynamicResolution::Begin(glm::ivec4 viewport)
+{
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &this->target);
+    this->viewport = viewport;
+    this->reserve(viewport.z, viewport.w);
+
+    // the frame timed QUERY_COUNT frames ago is done by now, unless the GPU is that far behind (then skip it)
+    unsigned int &query = this->queries[this->frames % QUERY_COUNT];
+    if (this->frames >= QUERY_COUNT)
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+        {
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+            float ms = static_cast<float>(nanoseconds) / 1000000.0f;
+            this->frameMs = this->frameMs > 0.0f ? this->frameMs + (ms - this->frameMs) * FRAME_SMOOTHING : ms;
+            this->adjust();
+        }
+    }
+
+    this->rendered = glm::max(glm::ivec2(glm::round(glm::vec2(viewport.z, viewport.w) * this->scale)), glm::ivec2(1));
+    glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    glClear(GL_COLOR_BUFFER_BIT);
+    return glm::ivec4(0, 0, this->rendered.x, this->rendered.y);
+}
+
+// scale the frame up into the viewport
+void DynamicResolution::End()
+{
+    GL_DEBUG_SCOPE("DynamicResolution::End");
+    glEndQuery(GL_TIME_ELAPSED);
+    ++this->frames;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, this->framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->target);
+    bool exact = this->rendered.x == this->viewport.z && this->rendered.y == this->viewport.w;
+    glBlitFramebuffer(0, 0, this->rendered.x, this->rendered.y, this->viewport.x, this->viewport.y, this->viewport.x + this->viewport.z,
+                      this->viewport.y + this->viewport.w, GL_COLOR_BUFFER_BIT, exact ? GL_NEAREST : GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, this->target);
+}
+
+// grow the color buffer when the viewport outgrows it
+void DynamicResolution::reserve(int width, int height)
+{
+    if (width <= this->size.x && height <= this->size.y)
+        return;
+    long long bytes = 4ll * this->size.x * this->size.y;
+    this->size = glm::max(this->size, glm::ivec2(width, height));
+    if (this->color == 0)
+    {
+        glGenTextures(1, &this->color);
+        MemoryStats::Created(GL_OBJECT_TEXTURE);
+    }
+    glBindTexture(GL_TEXTURE_2D, this->color);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, this->size.x, this->size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    MemoryStats::AddTextureBytes(4ll * this->size.x * this->size.y - bytes);
+    GLDebug::Label(GL_TEXTURE, this->color, "DynamicResolution::Color");
+
+    glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->color, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::DYNAMIC_RESOLUTION: Framebuffer is not complete" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, this->target);
+}
+
+// move the scale towards the one that renders a frame in the target time
+void DynamicResolution::adjust()
+{
+    if (++this->settled < SETTLE_FRAMES)
+        return;
+
+    // a frame's time goes with its pixel count, the square of the scale
+    float next = this->scale;
+    if (this->frameMs > this->targetMs)
+        next = this->scale * std::max(std::sqrt(this->targetMs / this->frameMs), 0.85f);
+    else if (this->frameMs < HEADROOM * this->targetMs)
+        next = this->scale * std::min(std::sqrt(HEADROOM * this->targetMs / this->frameMs), 1.05f);
+    next = std::min(std::max(std::round(next / SCALE_STEP) * SCALE_STEP, MIN_SCALE), 1.0f);
+    if (next != this->scale)
+    {
+        this->scale = next;
+        this->settled = 0;
+    }
+}
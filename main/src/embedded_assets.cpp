@@ -0,0 +1,69 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <sstream>
+
+#include "embedded_assets.hpp"
+
+// paths edited on disk since startup, guarded by overridesLock
+static std::set<std::string> overrides;
+static std::mutex overridesLock;
+
+// the embedded copy of a file
+const EmbeddedFile *EmbeddedAssets::Find(const std::string &path)
+{
+    for (unsigned int i = 0; i < EMBEDDED_FILE_COUNT; ++i)
+        if (path == EMBEDDED_FILES[i].Path)
+            return overridden(path) ? nullptr : &EMBEDDED_FILES[i];
+    return nullptr;
+}
+
+// the pre-parsed tiles of a level file
+const EmbeddedLevel *EmbeddedAssets::FindLevel(const std::string &path)
+{
+    for (unsigned int i = 0; i < EMBEDDED_LEVEL_COUNT; ++i)
+        if (path == EMBEDDED_LEVELS[i].Path)
+            return overridden(path) ? nullptr : &EMBEDDED_LEVELS[i];
+    return nullptr;
+}
+
+// reads a whole asset into contents
+bool EmbeddedAssets::Read(const std::string &path, std::string &contents)
+{
+    const EmbeddedFile *file = Find(path);
+    if (file != nullptr)
+    {
+        contents.assign(reinterpret_cast<const char *>(file->Data), file->Size);
+        return true;
+    }
+
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+        return false;
+    std::stringstream buffer;
+    buffer << stream.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+// stops using the embedded copy of a file
+void EmbeddedAssets::Override(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(overridesLock);
+    overrides.insert(path);
+}
+
+// whether a path has been overridden
+bool EmbeddedAssets::overridden(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(overridesLock);
+    return overrides.count(path) > 0;
+}
@@ -0,0 +1,97 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <iostream>
+#include <set>
+
+#include "file_watcher.hpp"
+
+#ifdef LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// constructor
+FileWatcher::FileWatcher()
+    : fd(-1)
+{
+#ifdef LINUX
+    this->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (this->fd < 0)
+        std::cout << "ERROR::FILE_WATCHER: Could not initialize inotify, hot reload is disabled" << std::endl;
+#endif
+}
+
+// destructor
+FileWatcher::~FileWatcher()
+{
+#ifdef LINUX
+    if (this->fd >= 0)
+        close(this->fd);
+#endif
+}
+
+// runs onChange whenever the file at path is written or replaced
+void FileWatcher::Watch(const std::string &path, std::function<void()> onChange)
+{
+    this->callbacks[path].push_back(onChange);
+
+#ifdef LINUX
+    if (this->fd < 0)
+        return;
+
+    // watch the file's directory, once per directory (inotify merges repeated watches on the same directory)
+    std::string::size_type slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : path.substr(0, slash);
+    int wd = inotify_add_watch(this->fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0)
+        std::cout << "ERROR::FILE_WATCHER: Could not watch " << directory << std::endl;
+    else
+        this->directories[wd] = directory;
+#endif
+}
+
+// runs the callbacks of every watched file changed since the last poll, without blocking
+unsigned int FileWatcher::Poll()
+{
+    std::set<std::string> changed;
+
+#ifdef LINUX
+    if (this->fd < 0)
+        return 0;
+
+    // drain every pending event, collecting the watched files they name
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = read(this->fd, buffer, sizeof(buffer))) > 0)
+    {
+        for (char *next = buffer; next < buffer + length;)
+        {
+            const inotify_event *event = reinterpret_cast<const inotify_event *>(next);
+            next += sizeof(inotify_event) + event->len;
+
+            std::map<int, std::string>::const_iterator directory = this->directories.find(event->wd);
+            if (directory == this->directories.end() || event->len == 0)
+                continue;
+
+            std::string path = directory->second == "." ? event->name : directory->second + "/" + event->name;
+            if (this->callbacks.count(path) != 0)
+                changed.insert(path);
+        }
+    }
+#endif
+
+    // then run each changed file's callbacks once
+    for (const std::string &path : changed)
+    {
+        std::cout << "Reloading " << path << std::endl;
+        for (std::function<void()> &onChange : this->callbacks[path])
+            onChange();
+    }
+    return static_cast<unsigned int>(changed.size());
+}
@@ -0,0 +1,156 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <cmath>
+#include <cstring>
+
+#include "frame_pacer.hpp"
+
+const double FramePacer::SPIN_THRESHOLD_MS = 2.0;
+
+// constructor
+FramePacer::FramePacer(double intervalMs, PacingMode mode)
+    : mode(mode), intervalMs(intervalMs), refreshMs(intervalMs), nextDeadline(0), lastFrame(0)
+{
+    this->ticksPerMs = SDL_GetPerformanceFrequency() / 1000.0;
+    this->intervalTicks = static_cast<Uint64>(intervalMs * this->ticksPerMs);
+    this->ResetStats();
+}
+
+// switches pacing mode, setting the swap interval for vsync modes
+PacingMode FramePacer::SetMode(PacingMode mode)
+{
+    // adaptive vsync is a swap interval of -1, which not every driver supports
+    if (mode == PACING_ADAPTIVE_VSYNC && SDL_GL_SetSwapInterval(-1) != 0)
+        mode = PACING_VSYNC;
+    if (mode == PACING_VSYNC && SDL_GL_SetSwapInterval(1) != 0)
+        mode = PACING_CAPPED;
+    // the other modes do their own waiting (or none), so the swap should never block
+    if (mode == PACING_CAPPED || mode == PACING_UNCAPPED)
+        SDL_GL_SetSwapInterval(0);
+
+    this->mode = mode;
+    this->refreshMs = this->refreshIntervalMs();
+    this->ResetStats();
+    return mode;
+}
+
+// (re)starts pacing from now
+void FramePacer::Start()
+{
+    this->lastFrame = SDL_GetPerformanceCounter();
+    this->nextDeadline = this->lastFrame + this->intervalTicks;
+}
+
+// waits until the next frame should begin, returns the time since the previous frame
+double FramePacer::Wait()
+{
+    if (this->mode == PACING_CAPPED)
+    {
+        // sleep while there is comfortably more time left than SDL_Delay might oversleep by
+        Uint64 now = SDL_GetPerformanceCounter();
+        while (now < this->nextDeadline)
+        {
+            double remaining = (this->nextDeadline - now) / this->ticksPerMs;
+            if (remaining <= SPIN_THRESHOLD_MS)
+                break;
+            SDL_Delay(static_cast<Uint32>(remaining - SPIN_THRESHOLD_MS));
+            now = SDL_GetPerformanceCounter();
+        }
+
+        // then spin for the last stretch
+        while (now < this->nextDeadline)
+            now = SDL_GetPerformanceCounter();
+
+        double frameTime = (now - this->lastFrame) / this->ticksPerMs;
+        this->record(frameTime, (now - this->nextDeadline) / this->ticksPerMs);
+        this->lastFrame = now;
+
+        // aim the next frame one interval after this deadline so small errors do not accumulate,
+        // unless we have fallen a whole interval behind, in which case start over rather than rush to catch up
+        this->nextDeadline += this->intervalTicks;
+        if (this->nextDeadline <= now)
+            this->nextDeadline = now + this->intervalTicks;
+        return frameTime;
+    }
+
+    // vsync and uncapped frames do not wait here, just measure
+    Uint64 now = SDL_GetPerformanceCounter();
+    double frameTime = (now - this->lastFrame) / this->ticksPerMs;
+    this->lastFrame = now;
+    if (this->mode == PACING_UNCAPPED)
+        this->record(frameTime, 0.0);
+    else
+        this->record(frameTime, std::fabs(frameTime - this->refreshMs));
+    return frameTime;
+}
+
+// clears the pacing error measured so far
+void FramePacer::ResetStats()
+{
+    this->stats.FrameTime = 0.0;
+    this->stats.LastError = 0.0;
+    this->stats.AverageError = 0.0;
+    this->stats.MaxError = 0.0;
+    this->stats.Frames = 0;
+}
+
+// parses a pacing mode name, returns false if the name is unknown
+bool FramePacer::ParseMode(const char *name, PacingMode &mode)
+{
+    for (int i = PACING_VSYNC; i <= PACING_UNCAPPED; ++i)
+    {
+        if (std::strcmp(name, ModeName(static_cast<PacingMode>(i))) == 0)
+        {
+            mode = static_cast<PacingMode>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// the name of a pacing mode
+const char *FramePacer::ModeName(PacingMode mode)
+{
+    switch (mode)
+    {
+    case PACING_VSYNC:
+        return "vsync";
+    case PACING_ADAPTIVE_VSYNC:
+        return "adaptive";
+    case PACING_CAPPED:
+        return "capped";
+    default:
+        return "uncapped";
+    }
+}
+
+// records the error of a frame against its target
+void FramePacer::record(double frameTime, double error)
+{
+    this->stats.FrameTime = frameTime;
+    this->stats.LastError = error;
+
+    // the first frame measures from Start and says nothing useful about pacing, leave it out of the aggregate
+    if (++this->stats.Frames == 1)
+        return;
+    this->stats.AverageError += (error - this->stats.AverageError) / (this->stats.Frames - 1);
+    if (error > this->stats.MaxError)
+        this->stats.MaxError = error;
+}
+
+// the refresh interval of the display the current GL window is on
+double FramePacer::refreshIntervalMs() const
+{
+    SDL_DisplayMode displayMode;
+    SDL_Window *window = SDL_GL_GetCurrentWindow();
+    int display = window != nullptr ? SDL_GetWindowDisplayIndex(window) : 0;
+    if (SDL_GetCurrentDisplayMode(display < 0 ? 0 : display, &displayMode) == 0 && displayMode.refresh_rate > 0)
+        return 1000.0 / displayMode.refresh_rate;
+    return this->intervalMs;
+}
@@ -7,8 +7,10 @@
 ** option) any later version.
 ******************************************************************/
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <cstdio>
 
 #include <SDL2/SDL.h>
 
@@ -17,6 +19,20 @@
 #include "sprite_renderer.hpp"
 #include "game_object.hpp"
 #include "text_renderer.hpp"
+#include "palette.hpp"
+#include "camera.hpp"
+#include "dynamic_resolution.hpp"
+#include "stream_buffer.hpp"
+#include "memory_stats.hpp"
+#include "trace.hpp"
+#include "gl_debug.hpp"
+#include "fixed_point.hpp"
+
+// GameLevel::SweepFixed squares offsets of up to the ball's radius plus one in 32 bit ints, and adds two of them,
+// which caps the radius at about 7.9 units in Q12
+static_assert(2 * (static_cast<long long>(BALL_RADIUS * (1 << FIXED_POSITION_BITS)) + 1) *
+                      (static_cast<long long>(BALL_RADIUS * (1 << FIXED_POSITION_BITS)) + 1) <= 0x7fffffffll,
+              "BALL_RADIUS is too large for the fixed-point brick sweep, use fewer FIXED_POSITION_BITS");
 
 // Possible collision directions
 enum Direction
@@ -30,103 +46,108 @@ enum Direction
 // Define a type for collisions
 typedef std::tuple<bool, Direction, glm::vec2> Collision;
 
-// Game-related State data
-SpriteRenderer *Renderer;
-GameObject *Player;
-GameObject *Player2;
-BallObject *Ball;
-BallObject *Ball2;
-TextRenderer *TextLives;
-TextRenderer *TextMenu;
-
-// Track if each ball has fallen off the bottom of the screen yet
-bool ballDead = false;
-bool ball2Dead = false;
-
-// Initial velocity of the Ball
-const glm::vec2 INITIAL_BALL_VELOCITY(0.25f, -0.25f);
-
-// Radius of the ball object
-const float BALL_RADIUS = 6;
-
-// The score of the current game
-int score = 0;
-
 // construct a game
 Game::Game(unsigned int width, unsigned int height)
-    : State(GAME_MENU), Keys(), Width(width), Height(height), Level(0), Lives(3)
+    : State(GAME_MENU), Keys(), KeysProcessed(), Width(width), Height(height), Physics(PHYSICS_FLOAT), Level(0), Lives(3),
+      Player(glm::vec2(0.0f), PLAYER_SIZE, 8), Player2(glm::vec2(0.0f), PLAYER_SIZE, 8),
+      Ball(glm::vec2(0.0f), BALL_RADIUS, INITIAL_BALL_VELOCITY), Ball2(glm::vec2(0.0f), BALL_RADIUS, INITIAL_BALL_VELOCITY),
+      Score(0), BricksBroken(0), LivesLost(0), Sounds(0), ShowMemoryStats(false), renderer(nullptr), colors(nullptr), view(nullptr), viewport(0, 0, width, height),
+      resolution(nullptr), backgroundTexture(), stream(nullptr),
+      textLives(nullptr), textMenu(nullptr), livesText(nullptr), scoreText(nullptr), menuText(), winText(),
+      shownLives(-1), shownScore(-1), ballDead(false), ball2Dead(false), snapshotSequence(0), brickHits()
 {
 }
 
 // destruct a game
 Game::~Game()
 {
-    delete Renderer;
-    delete Player;
-    delete Player2;
-    delete Ball;
-    delete Ball2;
-    delete TextLives;
-    delete TextMenu;
+    delete this->renderer;
+    delete this->colors;
+    delete this->view;
+    delete this->resolution;
+    delete this->livesText;
+    delete this->scoreText;
+    for (TextObject *text : this->menuText)
+        delete text;
+    for (TextObject *text : this->winText)
+        delete text;
+    delete this->textLives;
+    delete this->textMenu;
+    delete this->stream;
 }
 
 // initialize game state (load all shaders/textures/levels)
 void Game::Init()
 {
+    TRACE_ZONE("Game::Init");
     // load shaders
     ResourceManager::LoadShader("shaders/sprite.vs", "shaders/sprite.frag", nullptr, "sprite");
 
+    // load the sprite colors into the palette uniform buffer
+    this->colors = new Palette();
+    this->colors->Load(PALETTE_FILE);
+    this->colors->Upload();
+
+    // set up the per-frame view data shared by every shader
+    this->view = new Camera(this->Width, this->Height);
+
     // configure shaders
-    glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(this->Width),
-                                      static_cast<float>(this->Height), 0.0f, -1.0f, 1.0f);
-    ResourceManager::GetShader("sprite").Use().SetInteger("image", 0);
-    ResourceManager::GetShader("sprite").SetMatrix4("projection", projection);
-    ResourceManager::GetShader("particle").Use().SetInteger("sprite", 0);
-    ResourceManager::GetShader("particle").SetMatrix4("projection", projection);
+    this->ConfigureShader("sprite");
 
-    // set render-specific controls
-    Shader shader = ResourceManager::GetShader("sprite");
-    Renderer = new SpriteRenderer(shader);
+    // set render-specific controls, streaming per-frame geometry through one shared ring buffer
+    this->stream = new StreamBuffer();
+    this->renderer = new SpriteRenderer(ResourceManager::ShaderId("sprite"), *this->stream);
 
     // set up text rendering for top bar text
-    TextLives = new TextRenderer(this->Width, this->Height);
-    TextLives->Load("fonts/FFFFORWA.TTF", 45);
+    this->textLives = new TextRenderer(*this->stream);
+    this->textLives->Load("fonts/FFFFORWA.TTF", 45);
 
     // set up text rendering for menu text
-    TextMenu = new TextRenderer(this->Width, this->Height);
-    TextMenu->Load("fonts/OCRAEXT.TTF", 24);
-
-    // load textures
-    ResourceManager::LoadTexture("textures/background.png", false, "background");
-    ResourceManager::LoadTexture("textures/texture_sampler.png", false, "ball");
-    ResourceManager::LoadTexture("textures/texture_sampler.png", false, "block");
-    ResourceManager::LoadTexture("textures/texture_sampler.png", false, "block_solid");
-    ResourceManager::LoadTexture("textures/texture_sampler.png", false, "paddle");
-
-    // load levels
-    GameLevel one;
-    one.Load("levels/one.lvl", this->Width, this->Height / 3);
-    GameLevel two;
-    two.Load("levels/two.lvl", this->Width, this->Height / 3);
-    GameLevel three;
-    three.Load("levels/three.lvl", this->Width, this->Height / 3);
-    GameLevel four;
-    four.Load("levels/four.lvl", this->Width, this->Height / 3);
-    this->Levels.push_back(one);
-    this->Levels.push_back(two);
-    this->Levels.push_back(three);
-    this->Levels.push_back(four);
+    this->textMenu = new TextRenderer(*this->stream);
+    this->textMenu->Load("fonts/OCRAEXT.TTF", 24);
+
+    // lay out the text in the top bar (filled in on first render) and the menu and win screen text
+    glm::vec3 topBarColor(142 / 255.0f, 142 / 255.0f, 142 / 255.0f);
+    this->livesText = new TextObject(*this->textLives, 750.0f, 5.0f, 1.0f, topBarColor);
+    this->scoreText = new TextObject(*this->textLives, 200.0f, 5.0f, 1.0f, topBarColor);
+    this->menuText[0] = new TextObject(*this->textMenu, "Press ENTER to start", 360.0f, Height / 2, 1.0f);
+    this->menuText[1] = new TextObject(*this->textMenu, "Press W or S to select level", 350.0f, Height / 2 + 20.0f, 0.75f);
+    this->menuText[2] = new TextObject(*this->textMenu, "Once game starts, press SPACE to release ball", 170.0f, Height / 2 + 60.0f, 1.0f);
+    this->menuText[3] = new TextObject(*this->textMenu, "Use W and S to move paddle left and right", 270.0f, Height / 2 + 80.0f, 0.75f);
+    this->winText[0] = new TextObject(*this->textMenu, "You WON!!!", 400.0, Height / 2 - 20.0, 1.0, glm::vec3(0.0, 1.0, 0.0));
+    this->winText[1] = new TextObject(*this->textMenu, "Press ENTER to retry or ESC to quit", 280.0, Height / 2, 1.0, glm::vec3(1.0, 1.0, 0.0));
+
+    // load textures (everything else is drawn in flat palette colors)
+    this->backgroundTexture = ResourceManager::LoadTexture("textures/background.png", false, "background");
+
+    // load levels and set up the paddles and balls
+    this->InitSimulation();
+}
+
+// load the levels and place the paddles and balls (no GL needed)
+void Game::InitSimulation(int level)
+{
+    // load levels (or only the one this game plays, leaving the others empty)
+    {
+        MemoryScope scope(MEMORY_LEVELS);
+        this->Levels.assign(LEVEL_COUNT, GameLevel());
+        for (unsigned int i = 0; i < LEVEL_COUNT; ++i)
+        {
+            if (level < 0 || static_cast<unsigned int>(level) == i)
+                this->Levels[i].Load(LEVEL_FILES[i], this->Width, this->Height / 3);
+        }
+    }
 
     // start at the first level in selection
-    this->Level = 0;
+    this->Level = level < 0 ? 0 : static_cast<unsigned int>(level) % LEVEL_COUNT;
 
     // set up player paddle 1
     glm::vec2 playerPos = glm::vec2(this->Width / 2.0f - PLAYER_SIZE.x / 2.0f, this->Height - PLAYER_SIZE.y);
-    Player = new GameObject(playerPos, PLAYER_SIZE, ResourceManager::GetTexture("paddle"), 8);
+    this->Player.Position = playerPos;
 
     // set up player paddle 2
     glm::vec2 playerPos2 = glm::vec2(this->Width / 2.0f - PLAYER_SIZE.x / 2.0f, this->Height - PLAYER_SIZE.y - 100.0f);
-    Player2 = new GameObject(playerPos2, PLAYER_SIZE, ResourceManager::GetTexture("paddle"), 8);
+    this->Player2.Position = playerPos2;
 
     // initialize all key press values to false/unpressed
     for (int i = 0; i < 322; i++)
@@ -138,43 +159,67 @@ void Game::Init()
     // set up ball 1
     glm::vec2 ballPos = playerPos + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS,
                                               -BALL_RADIUS * 2.0f);
-    Ball = new BallObject(ballPos, BALL_RADIUS, INITIAL_BALL_VELOCITY,
-                          ResourceManager::GetTexture("ball"));
+    this->Ball.Reset(ballPos, INITIAL_BALL_VELOCITY);
 
     // set up ball 2
     glm::vec2 ballPos2 = playerPos2 + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS,
                                                 -BALL_RADIUS * 2.0f);
-    Ball2 = new BallObject(ballPos2, BALL_RADIUS, INITIAL_BALL_VELOCITY,
-                           ResourceManager::GetTexture("ball"));
+    this->Ball2.Reset(ballPos2, INITIAL_BALL_VELOCITY);
 }
 
 // loop every frame to update the game state
 void Game::Update(float dt)
 {
-    // move the balls each frame
-    Ball->Move(dt, this->Width);
-    Ball2->Move(dt, this->Width);
+    TRACE_ZONE("Game::Update");
+    // move the live balls each frame (a ball bounced off a wall if that turned it around); a dead ball stays where it
+    // fell, so it cannot run its fixed-point position out of range
+    glm::vec2 velocity = this->Ball.Velocity, velocity2 = this->Ball2.Velocity;
+    if (this->Physics == PHYSICS_FIXED)
+    {
+        int step = ToFixed(dt, FIXED_TIME_BITS);
+        if (!this->ballDead)
+            this->Ball.MoveFixed(step, this->Width);
+        if (!this->ball2Dead)
+            this->Ball2.MoveFixed(step, this->Width);
+    }
+    else
+    {
+        if (!this->ballDead)
+            this->Ball.Move(dt, this->Width);
+        if (!this->ball2Dead)
+            this->Ball2.Move(dt, this->Width);
+    }
+    if (this->Ball.Velocity != velocity || this->Ball2.Velocity != velocity2)
+        this->Sounds |= 1u << SOUND_WALL;
 
     // check for collisions every frame
     this->DoCollisions();
 
+    // consume the bricks destroyed this frame, scoring a point for each
+    GameLevel &level = this->Levels[this->Level];
+    this->Score += static_cast<int>(level.Events.size());
+    this->BricksBroken += level.Events.size();
+    level.Events.clear();
+
     // did ball reach the bottom edge?
-    if (Ball->Position.y >= this->Height)
+    if (this->Ball.Position.y >= this->Height)
     {
-        ballDead = true;
+        this->ballDead = true;
     }
 
     // did ball2 reach bottom edge?
-    if (Ball2->Position.y >= this->Height)
+    if (this->Ball2.Position.y >= this->Height)
     {
-        ball2Dead = true;
+        this->ball2Dead = true;
     }
 
     // if both ball(s) have fallen off the bottom, the player loses, so lose a life
-    if (ballDead && ball2Dead)
+    if (this->ballDead && this->ball2Dead)
     {
         // subtract a life
         --this->Lives;
+        ++this->LivesLost;
+        this->Sounds |= 1u << SOUND_LIFE_LOST;
 
         // did the player lose all their lives? if they did, it is game over, so reset to menu
         if (this->Lives == 0)
@@ -193,6 +238,7 @@ void Game::Update(float dt)
         this->ResetPlayer();
         this->ResetLevel();
         this->State = GAME_WIN;
+        this->Sounds |= 1u << SOUND_WIN;
     }
 }
 
@@ -210,15 +256,7 @@ void Game::ProcessInput(float dt)
 
             // if this is normal Breakout, disable Ball2 and Player2
             if (this->Level == 0)
-            {
-                // Move the ball offscreen (below screen so it counts as dead) and don't let it move
-                Ball2->Position.x += 10000;
-                Ball2->Position.y += 10000;
-                Ball2->Velocity = glm::vec2(0, 0);
-
-                // move player off screen so it can't affect game
-                Player2->Position.y += 10000;
-            }
+                this->RemoveSecondPlayer();
 
             // done with enter key press
             this->KeysProcessed[SDLK_RETURN] = true;
@@ -227,7 +265,7 @@ void Game::ProcessInput(float dt)
         if (this->Keys[SDLK_w] && !this->KeysProcessed[SDLK_w])
         {
             // scroll one
-            this->Level = (this->Level + 1) % 4;
+            this->Level = (this->Level + 1) % LEVEL_COUNT;
 
             // put two paddles on levels besides lv1
             this->ResetPlayer();
@@ -243,7 +281,7 @@ void Game::ProcessInput(float dt)
             if (this->Level > 0)
                 --this->Level;
             else
-                this->Level = 3;
+                this->Level = LEVEL_COUNT - 1;
 
             // put two paddles on levels besides lv1
             this->ResetPlayer();
@@ -257,23 +295,23 @@ void Game::ProcessInput(float dt)
     if (this->State == GAME_ACTIVE)
     {
         // set the velocity value based on framerate
-        float velocity = PLAYER_VELOCITY * dt;
+        float velocity = this->PaddleStep(dt);
 
         // if the player presses a, move the player paddle left
         if (this->Keys[SDLK_a])
         {
             // as long as the player isn't brushing up against the left wall, move the paddles
-            if (Player->Position.x >= 64.0f)
+            if (this->Player.Position.x >= 64.0f)
             {
                 // move both player paddles
-                Player->Position.x -= velocity;
-                Player2->Position.x -= velocity;
+                this->Player.Position.x -= velocity;
+                this->Player2.Position.x -= velocity;
 
                 // if the game hasn't started yet and the balls are fixed to the paddles, move them too
-                if (Ball->Stuck)
+                if (this->Ball.Stuck)
                 {
-                    Ball->Position.x -= velocity;
-                    Ball2->Position.x -= velocity;
+                    this->Ball.Position.x -= velocity;
+                    this->Ball2.Position.x -= velocity;
                 }
             }
         }
@@ -281,17 +319,17 @@ void Game::ProcessInput(float dt)
         if (this->Keys[SDLK_d])
         {
             // as long as the player isn't brushing up against the right wall, move the paddles
-            if (Player->Position.x <= this->Width - Player->Size.x - 64.0f)
+            if (this->Player.Position.x <= this->Width - this->Player.Size.x - 64.0f)
             {
                 // move both player paddles
-                Player->Position.x += velocity;
-                Player2->Position.x += velocity;
+                this->Player.Position.x += velocity;
+                this->Player2.Position.x += velocity;
 
                 // if the game hasn't started yet and the balls are fixed to the paddles, move them too
-                if (Ball->Stuck)
+                if (this->Ball.Stuck)
                 {
-                    Ball->Position.x += velocity;
-                    Ball2->Position.x += velocity;
+                    this->Ball.Position.x += velocity;
+                    this->Ball2.Position.x += velocity;
                 }
             }
         }
@@ -299,8 +337,8 @@ void Game::ProcessInput(float dt)
         // if the player presses the space bar, begin the game (if it has already started, this will do nothing)
         if (this->Keys[SDLK_SPACE])
         {
-            Ball->Stuck = false;
-            Ball2->Stuck = false;
+            this->Ball.Stuck = false;
+            this->Ball2.Stuck = false;
         }
     }
 
@@ -315,68 +353,280 @@ void Game::ProcessInput(float dt)
     }
 }
 
-// loop every frame to render the game window
-void Game::Render()
+// start playing a level from its beginning
+void Game::StartLevel(unsigned int level)
+{
+    this->Level = level % LEVEL_COUNT;
+    this->ResetLevel();
+    this->ResetPlayer();
+    this->State = GAME_ACTIVE;
+
+    // if this is normal Breakout, disable Ball2 and Player2
+    if (this->Level == 0)
+        this->RemoveSecondPlayer();
+}
+
+// start a two player versus game on a Super Breakout level
+void Game::StartVersus(unsigned int level)
+{
+    this->StartLevel(level > 0 && level < LEVEL_COUNT ? level : 1);
+}
+
+// take Ball2 and Player2 out of play, for normal Breakout
+void Game::RemoveSecondPlayer()
+{
+    // Move the ball offscreen (below screen so it counts as dead) and don't let it move
+    this->Ball2.Position.x += 10000;
+    this->Ball2.Position.y += 10000;
+    this->Ball2.Velocity = glm::vec2(0, 0);
+
+    // move player off screen so it can't affect game
+    this->Player2.Position.y += 10000;
+}
+
+// apply one versus frame's input bits
+void Game::ProcessVersusInput(float dt, const unsigned char inputs[2])
+{
+    // after a game over or a win, either player can start the next game
+    if (this->State != GAME_ACTIVE)
+    {
+        if ((inputs[0] | inputs[1]) & INPUT_START)
+            this->State = GAME_ACTIVE;
+        return;
+    }
+
+    // each player moves their own paddle (and their ball, while it is still fixed to it)
+    float velocity = this->PaddleStep(dt);
+    GameObject *paddles[2] = {&this->Player, &this->Player2};
+    BallObject *balls[2] = {&this->Ball, &this->Ball2};
+    for (unsigned int i = 0; i < 2; ++i)
+    {
+        float move = 0.0f;
+        if ((inputs[i] & INPUT_LEFT) && paddles[i]->Position.x >= 64.0f)
+            move -= velocity;
+        if ((inputs[i] & INPUT_RIGHT) && paddles[i]->Position.x <= this->Width - paddles[i]->Size.x - 64.0f)
+            move += velocity;
+        paddles[i]->Position.x += move;
+        if (balls[i]->Stuck)
+            balls[i]->Position.x += move;
+    }
+
+    // either player can release the balls
+    if ((inputs[0] | inputs[1]) & INPUT_LAUNCH)
+    {
+        this->Ball.Stuck = false;
+        this->Ball2.Stuck = false;
+    }
+}
+
+// the keyboard's controls as versus input bits
+unsigned char Game::SampleInput() const
+{
+    unsigned char input = 0;
+    if (this->Keys[SDLK_a])
+        input |= INPUT_LEFT;
+    if (this->Keys[SDLK_d])
+        input |= INPUT_RIGHT;
+    if (this->Keys[SDLK_SPACE])
+        input |= INPUT_LAUNCH;
+    if (this->Keys[SDLK_RETURN])
+        input |= INPUT_START;
+    return input;
+}
+
+// save everything a game changes while it is played
+void Game::SaveState(GameSave &save) const
+{
+    save.State = this->State;
+    save.Level = this->Level;
+    save.Lives = this->Lives;
+    save.Score = this->Score;
+
+    const GameObject *paddles[2] = {&this->Player, &this->Player2};
+    const BallObject *balls[2] = {&this->Ball, &this->Ball2};
+    for (unsigned int i = 0; i < 2; ++i)
+    {
+        save.PlayerPositions[i] = paddles[i]->Position;
+        save.PlayerSizes[i] = paddles[i]->Size;
+        save.BallPositions[i] = balls[i]->Position;
+        save.BallVelocities[i] = balls[i]->Velocity;
+        save.BallStuck[i] = balls[i]->Stuck;
+    }
+    save.BallDead[0] = this->ballDead;
+    save.BallDead[1] = this->ball2Dead;
+
+    this->Levels[this->Level].GetAlive(save.BrickAlive);
+
+    save.BricksBroken = this->BricksBroken;
+    save.LivesLost = this->LivesLost;
+}
+
+// restore everything a game changes while it is played
+void Game::LoadState(const GameSave &save)
+{
+    this->State = save.State;
+    this->Level = save.Level;
+    this->Lives = save.Lives;
+    this->Score = save.Score;
+
+    GameObject *paddles[2] = {&this->Player, &this->Player2};
+    BallObject *balls[2] = {&this->Ball, &this->Ball2};
+    for (unsigned int i = 0; i < 2; ++i)
+    {
+        paddles[i]->Position = save.PlayerPositions[i];
+        paddles[i]->Size = save.PlayerSizes[i];
+        balls[i]->Position = save.BallPositions[i];
+        balls[i]->Velocity = save.BallVelocities[i];
+        balls[i]->Stuck = save.BallStuck[i];
+    }
+    this->ballDead = save.BallDead[0];
+    this->ball2Dead = save.BallDead[1];
+
+    this->Levels[this->Level].SetAlive(save.BrickAlive);
+
+    this->BricksBroken = save.BricksBroken;
+    this->LivesLost = save.LivesLost;
+}
+
+// loop every frame to render the game window from the latest snapshot of the game state
+void Game::Render(const RenderSnapshot &snapshot)
 {
+    TRACE_ZONE("Game::Render");
+    GL_DEBUG_SCOPE("Game::Render");
+    // draw into the scaled down frame when the resolution is dynamic, otherwise straight into the viewport
+    this->view->SetViewport(this->viewport.x, this->viewport.y, this->viewport.z, this->viewport.w);
+    if (this->resolution != nullptr)
+    {
+        glm::ivec4 scaled = this->resolution->Begin(this->viewport);
+        this->view->SetViewport(scaled.x, scaled.y, scaled.z, scaled.w);
+    }
+
+    // upload this frame's view data for every shader
+    this->view->Apply();
+
     // if the game is active or at the menu, draw the game
-    if (this->State == GAME_ACTIVE || this->State == GAME_MENU || this->State == GAME_WIN)
+    if (snapshot.State == GAME_ACTIVE || snapshot.State == GAME_MENU || snapshot.State == GAME_WIN)
     {
         // draw background
-        Renderer->DrawSprite(ResourceManager::GetTexture("background"), glm::vec2(0.0f, 0.0f), glm::vec2(this->Width, this->Height), 0.0f);
+        this->renderer->DrawSprite(ResourceManager::GetTexture(this->backgroundTexture), glm::vec2(0.0f, 0.0f), glm::vec2(this->Width, this->Height), 0.0f);
 
         // draw level
-        this->Levels[this->Level].Draw(*Renderer);
-
-        // draw player
-        Player->Draw(*Renderer);
+        if (snapshot.Bricks)
+            GameLevel::Draw(*this->renderer, *snapshot.Bricks, snapshot.BrickAlive);
 
-        // draw ball
-        Ball->Draw(*Renderer);
-
-        // if it is Super Breakout, also draw player2 and ball2
-        if (Level > 0)
+        // draw player and ball; if it is Super Breakout, also draw player2 and ball2
+        unsigned int count = snapshot.Level > 0 ? 2 : 1;
+        for (unsigned int i = 0; i < count; ++i)
         {
-            Player2->Draw(*Renderer);
-            Ball2->Draw(*Renderer);
+            const SpriteState &player = snapshot.Players[i];
+            const SpriteState &ball = snapshot.Balls[i];
+            this->renderer->DrawSprite(player.Sprite, player.Position, player.Size, player.Rotation, player.ColorIndex);
+            this->renderer->DrawSprite(ball.Sprite, ball.Position, ball.Size, ball.Rotation, ball.ColorIndex);
         }
 
-        // set up a stream for the life count
-        std::stringstream ss;
-        ss << this->Lives;
+        // draw all the queued sprites at once, before the text goes on top
+        this->renderer->Flush();
 
-        // convert the score remaining to 3 digits
-        std::string scorestring = std::to_string(score);
-        if (score < 10)
+        // only re-lay out the top bar text when the values change
+        if (static_cast<int>(snapshot.Lives) != this->shownLives)
         {
-            scorestring = "00" + std::to_string(score);
+            this->shownLives = snapshot.Lives;
+            this->livesText->SetText(std::to_string(this->shownLives));
         }
-        else if (score >= 10 && score < 100)
+        if (snapshot.Score != this->shownScore)
         {
-            scorestring = "0" + std::to_string(score);
+            // convert the score to (at least) 3 digits
+            char scorestring[16];
+            std::snprintf(scorestring, sizeof(scorestring), "%03d", snapshot.Score);
+            this->shownScore = snapshot.Score;
+            this->scoreText->SetText(scorestring);
         }
 
         // render the text in the top bar for the lives remaining and the score
-        TextLives->RenderText("" + ss.str(), 750.0f, 5.0f, 1.0f, glm::vec3(142 / 255.0f, 142 / 255.0f, 142 / 255.0f));
-        TextLives->RenderText("" + scorestring, 200.0f, 5.0f, 1.0f, glm::vec3(142 / 255.0f, 142 / 255.0f, 142 / 255.0f));
+        this->livesText->Draw();
+        this->scoreText->Draw();
     }
 
     // if the game is on the menu, render the menu how to play text
-    if (this->State == GAME_MENU)
+    if (snapshot.State == GAME_MENU)
     {
-        TextMenu->RenderText("Press ENTER to start", 360.0f, Height / 2, 1.0f);
-        TextMenu->RenderText("Press W or S to select level", 350.0f, Height / 2 + 20.0f, 0.75f);
-        TextMenu->RenderText("Once game starts, press SPACE to release ball", 170.0f, Height / 2 + 60.0f, 1.0f);
-        TextMenu->RenderText("Use W and S to move paddle left and right", 270.0f, Height / 2 + 80.0f, 0.75f);
+        for (TextObject *text : this->menuText)
+            text->Draw();
     }
 
     // if the game has been won, render the won text and instructions
-    if (this->State == GAME_WIN)
+    if (snapshot.State == GAME_WIN)
     {
-        TextMenu->RenderText(
-            "You WON!!!", 400.0, Height / 2 - 20.0, 1.0, glm::vec3(0.0, 1.0, 0.0));
-        TextMenu->RenderText(
-            "Press ENTER to retry or ESC to quit", 280.0, Height / 2, 1.0, glm::vec3(1.0, 1.0, 0.0));
+        for (TextObject *text : this->winText)
+            text->Draw();
     }
+
+    // the memory overlay goes on top of everything else
+    if (this->ShowMemoryStats)
+        this->RenderMemoryStats();
+
+    // scale the frame up into the viewport
+    if (this->resolution != nullptr)
+        this->resolution->End();
+
+    // everything streamed this frame is now in use by its draws
+    this->stream->Fence();
+}
+
+// draw the current memory and GL resource counters in the top left corner
+void Game::RenderMemoryStats()
+{
+    MemoryScope scope(MEMORY_RENDER);
+    std::istringstream report(MemoryStats::Report(MemoryStats::Sample()));
+    std::string line;
+    float y = 60.0f;
+    while (std::getline(report, line))
+    {
+        this->textMenu->RenderText(line, 70.0f, y, 0.5f, glm::vec3(1.0f, 1.0f, 0.0f));
+        y += 14.0f;
+    }
+}
+
+// note a key being pressed or released
+void Game::SetKey(int key, bool pressed)
+{
+    // if an event happens greater than the valid keypress values, ignore it
+    if (key < 0 || key >= 322)
+        return;
+
+    this->Keys[key] = pressed;
+
+    // when a key is released, it can be processed again on the next press
+    if (!pressed)
+        this->KeysProcessed[key] = false;
+}
+
+// copy the state needed to draw the current frame into a snapshot
+void Game::Snapshot(RenderSnapshot &snapshot)
+{
+    snapshot.State = this->State;
+    snapshot.Level = this->Level;
+    snapshot.Lives = this->Lives;
+    snapshot.Score = this->Score;
+
+    // share the (immutable) brick layout and copy out which bricks are alive. the mask is
+    // resized in place, so once every slot has seen the largest level this never allocates
+    const GameLevel &level = this->Levels[this->Level];
+    snapshot.Bricks = level.Layout;
+    level.GetAlive(snapshot.BrickAlive);
+
+    snapshot.Players[0] = this->Player.GetSpriteState();
+    snapshot.Players[1] = this->Player2.GetSpriteState();
+    snapshot.Balls[0] = this->Ball.GetSpriteState();
+    snapshot.Balls[1] = this->Ball2.GetSpriteState();
+
+    snapshot.Sequence = this->snapshotSequence++;
+}
+
+// true for states where nothing moves without input (the menu and win screens)
+bool Game::IsIdle(GameState state)
+{
+    return state == GAME_MENU || state == GAME_WIN;
 }
 
 // determine the direction of a collision
@@ -434,129 +684,328 @@ Collision CheckCollision(BallObject &one, GameObject &two)
         return std::make_tuple(false, UP, glm::vec2(0.0f, 0.0f));
 }
 
-// check if a box and a ball have collided
-void Game::CheckBallBrickCollision(BallObject *Ball, GameObject &box)
+// check if a brick and a ball have collided
+void Game::CheckBallBrickCollision(BallObject *ball, GameLevel &level, unsigned int brick)
 {
-    Collision collision = CheckCollision(*Ball, box);
+    Collision collision = CheckCollision(*ball, level.Bricks[brick]);
     if (std::get<0>(collision)) // if collision is true
     {
-        // destroy block if not solid
-        if (!box.IsSolid)
-        {
-            score++;
-            box.Destroyed = true;
-        }
+        // destroy block if not solid (the level queues an event for it, which is scored in Update)
+        this->Sounds |= 1u << (level.Bricks[brick].IsSolid ? SOUND_SOLID : SOUND_BRICK);
+        level.DestroyBrick(brick);
 
         // collision resolution
         Direction dir = std::get<1>(collision);
         glm::vec2 diff_vector = std::get<2>(collision);
         if (dir == LEFT || dir == RIGHT) // horizontal collision
         {
-            Ball->Velocity.x = -Ball->Velocity.x; // reverse horizontal velocity
+            ball->Velocity.x = -ball->Velocity.x; // reverse horizontal velocity
             // relocate
-            float penetration = Ball->Radius - std::abs(diff_vector.x);
+            float penetration = ball->Radius - std::abs(diff_vector.x);
             if (dir == LEFT)
-                Ball->Position.x += penetration; // move ball to right
+                ball->Position.x += penetration; // move ball to right
             else
-                Ball->Position.x -= penetration; // move ball to left;
+                ball->Position.x -= penetration; // move ball to left;
         }
         else // vertical collision
         {
-            Ball->Velocity.y = -Ball->Velocity.y; // reverse vertical velocity
+            ball->Velocity.y = -ball->Velocity.y; // reverse vertical velocity
             // relocate
-            float penetration = Ball->Radius - std::abs(diff_vector.y);
+            float penetration = ball->Radius - std::abs(diff_vector.y);
             if (dir == UP)
-                Ball->Position.y -= penetration; // move ball back up
+                ball->Position.y -= penetration; // move ball back up
             else
-                Ball->Position.y += penetration; // move ball back down
+                ball->Position.y += penetration; // move ball back down
         }
     }
 }
 
 // check if a player paddle and a ball have collided
-void Game::CheckBallPlayerCollision(BallObject *Ball, GameObject *Player)
+void Game::CheckBallPlayerCollision(BallObject *ball, GameObject *player)
 {
     // check for a collision between the given ball and player paddle
-    Collision result = CheckCollision(*Ball, *Player);
+    Collision result = CheckCollision(*ball, *player);
 
     // if there is a collision result and the ball is not in the pre-game-start stuck state, handle it
-    if (!Ball->Stuck && std::get<0>(result))
+    if (!ball->Stuck && std::get<0>(result))
     {
         // check where the ball hit the paddle, and change velocity based on where it hit the paddle
-        float centerBoard = Player->Position.x + Player->Size.x / 2.0f;
-        float distance = (Ball->Position.x + Ball->Radius) - centerBoard;
-        float percentage = distance / (Player->Size.x / 2.0f);
+        float centerBoard = player->Position.x + player->Size.x / 2.0f;
+        float distance = (ball->Position.x + ball->Radius) - centerBoard;
+        float percentage = distance / (player->Size.x / 2.0f);
 
         // then move the ball accordingly
         float strength = 2.0f;
-        glm::vec2 oldVelocity = Ball->Velocity;
-        Ball->Velocity.x = INITIAL_BALL_VELOCITY.x * percentage * strength;
-        Ball->Velocity.y = -1.0f * abs(Ball->Velocity.y);
-        Ball->Velocity = glm::normalize(Ball->Velocity) * glm::length(oldVelocity);
+        glm::vec2 oldVelocity = ball->Velocity;
+        ball->Velocity.x = INITIAL_BALL_VELOCITY.x * percentage * strength;
+        ball->Velocity.y = -1.0f * abs(ball->Velocity.y);
+        ball->Velocity = glm::normalize(ball->Velocity) * glm::length(oldVelocity);
+        this->Sounds |= 1u << SOUND_PADDLE;
     }
 }
 
 // look for collisions every frame and resolve them
 void Game::DoCollisions()
 {
+    TRACE_ZONE("Game::DoCollisions");
+    if (this->Physics == PHYSICS_FIXED)
+    {
+        this->DoCollisionsFixed();
+        return;
+    }
+
     // loop through every brick
-    for (GameObject &brick : this->Levels[this->Level].Bricks)
+    GameLevel &level = this->Levels[this->Level];
+    for (unsigned int brick = 0; brick < level.Bricks.size(); ++brick)
     {
-        // if the current brick has not been destroyed yet, check for collisions with it and both ball(s)
+        // if the current brick has not been destroyed yet, check for collisions with it and the live ball(s)
         // and handle them, if any
-        if (!brick.Destroyed)
+        if (!level.Bricks[brick].Destroyed)
+        {
+            if (!this->ballDead)
+                CheckBallBrickCollision(&this->Ball, level, brick);
+            if (!this->ball2Dead)
+                CheckBallBrickCollision(&this->Ball2, level, brick);
+        }
+    }
+
+    // check for collisions between the live ball(s) and player paddle(s) and handle them, if any
+    if (!this->ballDead)
+    {
+        CheckBallPlayerCollision(&this->Ball, &this->Player);
+        CheckBallPlayerCollision(&this->Ball, &this->Player2);
+    }
+    if (!this->ball2Dead)
+    {
+        CheckBallPlayerCollision(&this->Ball2, &this->Player);
+        CheckBallPlayerCollision(&this->Ball2, &this->Player2);
+    }
+}
+
+// a vector in fixed point
+static glm::ivec2 toFixed(glm::vec2 value, int bits)
+{
+    return glm::ivec2(ToFixed(value.x, bits), ToFixed(value.y, bits));
+}
+
+static glm::vec2 fromFixed(glm::ivec2 value, int bits)
+{
+    return glm::vec2(FromFixed(value.x, bits), FromFixed(value.y, bits));
+}
+
+// VectorDirection in integers: the compass direction with the largest dot product with the difference (the first
+// on a tie, none for no difference), which normalizing does not change
+static Direction fixedDirection(glm::ivec2 difference)
+{
+    int dots[4] = {difference.y, difference.x, -difference.y, -difference.x};
+    int max = 0;
+    unsigned int best_match = -1;
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        if (dots[i] > max)
+        {
+            max = dots[i];
+            best_match = i;
+        }
+    }
+    return (Direction)best_match;
+}
+
+// the offset from a circle's center to the closest point of a rectangle, and whether it is within the radius
+static bool fixedCollision(glm::ivec2 center, int radius, glm::ivec2 position, glm::ivec2 size, glm::ivec2 &difference)
+{
+    difference = glm::clamp(center, position, position + size) - center;
+    return static_cast<long long>(difference.x) * difference.x + static_cast<long long>(difference.y) * difference.y <=
+           static_cast<long long>(radius) * radius;
+}
+
+// look for collisions in fixed point
+void Game::DoCollisionsFixed()
+{
+    GameLevel &level = this->Levels[this->Level];
+    this->brickHits.resize(level.SweepSize());
+    if (!this->ballDead)
+    {
+        this->CheckBallBricksFixed(&this->Ball, level);
+        this->CheckBallPlayerCollisionFixed(&this->Ball, &this->Player);
+        this->CheckBallPlayerCollisionFixed(&this->Ball, &this->Player2);
+    }
+    if (!this->ball2Dead)
+    {
+        this->CheckBallBricksFixed(&this->Ball2, level);
+        this->CheckBallPlayerCollisionFixed(&this->Ball2, &this->Player);
+        this->CheckBallPlayerCollisionFixed(&this->Ball2, &this->Player2);
+    }
+}
+
+// resolve a ball against every brick it touches, in order
+void Game::CheckBallBricksFixed(BallObject *ball, GameLevel &level)
+{
+    int radius = ToFixed(ball->Radius, FIXED_POSITION_BITS);
+    glm::ivec2 position = toFixed(ball->Position, FIXED_POSITION_BITS);
+    glm::ivec2 velocity = toFixed(ball->Velocity, FIXED_VELOCITY_BITS);
+    glm::ivec2 center = position + radius;
+    unsigned char *hits = this->brickHits.data();
+    level.SweepFixed(center.x, center.y, radius, 0, hits);
+
+    bool moved = false;
+    for (unsigned int brick = 0; brick < level.Bricks.size(); ++brick)
+    {
+        // the sweep only looks at the edges, the few bricks it finds are checked for being destroyed
+        GameObject &tile = level.Bricks[brick];
+        glm::ivec2 difference;
+        if (!hits[brick] || tile.Destroyed ||
+            !fixedCollision(center, radius, toFixed(tile.Position, FIXED_POSITION_BITS), toFixed(tile.Size, FIXED_POSITION_BITS), difference))
+            continue;
+
+        // destroy block if not solid, then resolve the collision as CheckBallBrickCollision does
+        this->Sounds |= 1u << (tile.IsSolid ? SOUND_SOLID : SOUND_BRICK);
+        level.DestroyBrick(brick);
+        Direction dir = fixedDirection(difference);
+        if (dir == LEFT || dir == RIGHT)
+        {
+            velocity.x = -velocity.x;
+            int penetration = radius - std::abs(difference.x);
+            position.x += dir == LEFT ? penetration : -penetration;
+        }
+        else
         {
-            CheckBallBrickCollision(Ball, brick);
-            CheckBallBrickCollision(Ball2, brick);
+            velocity.y = -velocity.y;
+            int penetration = radius - std::abs(difference.y);
+            position.y += dir == UP ? -penetration : penetration;
         }
+        moved = true;
+
+        // the ball moved, so sweep the bricks after this one again
+        center = position + radius;
+        level.SweepFixed(center.x, center.y, radius, brick + 1, hits);
+    }
+
+    if (moved)
+    {
+        ball->Position = fromFixed(position, FIXED_POSITION_BITS);
+        ball->Velocity = fromFixed(velocity, FIXED_VELOCITY_BITS);
+    }
+}
+
+// bounce a ball off a paddle in fixed point
+void Game::CheckBallPlayerCollisionFixed(BallObject *ball, GameObject *player)
+{
+    if (ball->Stuck)
+        return;
+    int radius = ToFixed(ball->Radius, FIXED_POSITION_BITS);
+    glm::ivec2 position = toFixed(ball->Position, FIXED_POSITION_BITS);
+    glm::ivec2 paddle = toFixed(player->Position, FIXED_POSITION_BITS), size = toFixed(player->Size, FIXED_POSITION_BITS);
+    glm::ivec2 difference;
+    if (!fixedCollision(position + radius, radius, paddle, size, difference))
+        return;
+
+    // the further from the paddle's center it hits, the more sideways the ball goes (as CheckBallPlayerCollision)
+    long long half = size.x / 2;
+    long long distance = position.x + radius - (paddle.x + half);
+    long long strength = 2;
+    glm::ivec2 velocity = toFixed(ball->Velocity, FIXED_VELOCITY_BITS);
+    long long x = ToFixed(INITIAL_BALL_VELOCITY.x, FIXED_VELOCITY_BITS) * distance * strength / half;
+    long long y = -std::abs(static_cast<long long>(velocity.y));
+
+    // at the speed it came in at
+    unsigned long long speed = FixedSqrt(static_cast<unsigned long long>(static_cast<long long>(velocity.x) * velocity.x + y * y));
+    long long length = static_cast<long long>(FixedSqrt(static_cast<unsigned long long>(x * x + y * y)));
+    if (length > 0)
+    {
+        x = x * static_cast<long long>(speed) / length;
+        y = y * static_cast<long long>(speed) / length;
     }
+    ball->Velocity = fromFixed(glm::ivec2(static_cast<int>(x), static_cast<int>(y)), FIXED_VELOCITY_BITS);
+    this->Sounds |= 1u << SOUND_PADDLE;
+}
 
-    // check for collisions between both ball(s) and player paddle(s) and handle them, if any
-    CheckBallPlayerCollision(Ball, Player);
-    CheckBallPlayerCollision(Ball, Player2);
-    CheckBallPlayerCollision(Ball2, Player);
-    CheckBallPlayerCollision(Ball2, Player2);
+// how far a paddle moves in a step
+float Game::PaddleStep(float dt) const
+{
+    // in fixed point the step lands on the position grid, so adding it to a paddle's position is exact
+    if (this->Physics == PHYSICS_FIXED)
+        return FromFixed(FixedMultiply(ToFixed(PLAYER_VELOCITY, FIXED_VELOCITY_BITS), ToFixed(dt, FIXED_TIME_BITS),
+                                       FIXED_VELOCITY_BITS + FIXED_TIME_BITS - FIXED_POSITION_BITS),
+                         FIXED_POSITION_BITS);
+    return PLAYER_VELOCITY * dt;
 }
 
 // reset a level after a game over
 void Game::ResetLevel()
 {
-    // level 1
-    if (this->Level == 0)
-        this->Levels[0].Load("levels/one.lvl", this->Width, this->Height / 3);
-    // level 2
-    else if (this->Level == 1)
-        this->Levels[1].Load("levels/two.lvl", this->Width, this->Height / 3);
-    // level 3
-    else if (this->Level == 2)
-        this->Levels[2].Load("levels/three.lvl", this->Width, this->Height / 3);
-    // level 4
-    else if (this->Level == 3)
-        this->Levels[3].Load("levels/four.lvl", this->Width, this->Height / 3);
+    // reload the current level's bricks
+    this->Levels[this->Level].Load(LEVEL_FILES[this->Level], this->Width, this->Height / 3);
 
     // reset lives to 3 and score to 0
     this->Lives = 3;
-    score = 0;
+    this->Score = 0;
+}
+
+// reload a level's bricks from its file, resetting that level's progress
+void Game::ReloadLevel(unsigned int level)
+{
+    if (level < this->Levels.size())
+        this->Levels[level].Load(LEVEL_FILES[level], this->Width, this->Height / 3);
+}
+
+// set a shader's uniforms (again, after the shader has been reloaded into a new program)
+void Game::ConfigureShader(const std::string &name)
+{
+    if (name == "sprite")
+    {
+        ResourceManager::GetShader("sprite").Use().SetInteger("image", 0);
+        ResourceManager::GetShader("sprite").SetUniformBlock("Frame", Camera::BINDING);
+        ResourceManager::GetShader("sprite").SetUniformBlock("Palette", Palette::BINDING);
+    }
+    else if (name == "text")
+    {
+        ResourceManager::GetShader("text").Use().SetInteger("text", 0);
+        ResourceManager::GetShader("text").SetUniformBlock("Frame", Camera::BINDING);
+    }
+}
+
+// fit the game area to a new framebuffer size
+void Game::Resize(int width, int height)
+{
+    float scale = std::min(static_cast<float>(width) / this->Width, static_cast<float>(height) / this->Height);
+    int fitWidth = std::max(static_cast<int>(this->Width * scale + 0.5f), 1);
+    int fitHeight = std::max(static_cast<int>(this->Height * scale + 0.5f), 1);
+    this->viewport = glm::ivec4((width - fitWidth) / 2, (height - fitHeight) / 2, fitWidth, fitHeight);
+}
+
+// render at a scale that holds a frame time from the next frame on
+void Game::EnableDynamicResolution(float targetMs)
+{
+    delete this->resolution;
+    this->resolution = new DynamicResolution(targetMs);
+}
+
+// read the sprite colors again after the palette file has been edited
+void Game::ReloadPalette()
+{
+    if (this->colors->Load(PALETTE_FILE))
+        this->colors->Upload();
 }
 
 // reset the player and ball after a loss of life or game over
 void Game::ResetPlayer()
 {
     // reset player
-    Player->Size = PLAYER_SIZE;
-    Player->Position = glm::vec2(this->Width / 2.0f - PLAYER_SIZE.x / 2.0f, this->Height - PLAYER_SIZE.y);
+    this->Player.Size = PLAYER_SIZE;
+    this->Player.Position = glm::vec2(this->Width / 2.0f - PLAYER_SIZE.x / 2.0f, this->Height - PLAYER_SIZE.y);
 
     // reset ball
-    ballDead = false;
-    Ball->Reset(Player->Position + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -(BALL_RADIUS * 2.0f)), INITIAL_BALL_VELOCITY);
+    this->ballDead = false;
+    this->Ball.Reset(this->Player.Position + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -(BALL_RADIUS * 2.0f)), INITIAL_BALL_VELOCITY);
 
     // if it is Super Breakout, also reset player 2 and ball 2
     if (Level > 0)
     {
-        Player2->Size = PLAYER_SIZE;
-        Player2->Position = glm::vec2(this->Width / 2.0f - PLAYER_SIZE.x / 2.0f, this->Height - PLAYER_SIZE.y - 100);
+        this->Player2.Size = PLAYER_SIZE;
+        this->Player2.Position = glm::vec2(this->Width / 2.0f - PLAYER_SIZE.x / 2.0f, this->Height - PLAYER_SIZE.y - 100);
 
-        Ball2->Reset(Player->Position + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -(BALL_RADIUS * 2.0f) - 100), INITIAL_BALL_VELOCITY);
-        ball2Dead = false;
+        this->Ball2.Reset(this->Player.Position + glm::vec2(PLAYER_SIZE.x / 2.0f - BALL_RADIUS, -(BALL_RADIUS * 2.0f) - 100), INITIAL_BALL_VELOCITY);
+        this->ball2Dead = false;
     }
 }
\ No newline at end of file
@@ -0,0 +1,213 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <new>
+
+#include "game_batch.hpp"
+#include "memory_stats.hpp"
+
+// constructor
+GameBatch::GameBatch(unsigned int count, unsigned int level, unsigned int threads, float stepMs, unsigned int width, unsigned int height)
+    : count(count), level(level % LEVEL_COUNT), stepMs(stepMs), width(width), height(height), breakable(0), chunks(),
+      job(JOB_CREATE), actions(nullptr), observations(nullptr), rewards(nullptr), dones(nullptr),
+      generation(0), running(0), quitting(false)
+{
+    // one chunk per thread, never more threads than games
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    if (threads > count)
+        threads = count;
+    if (threads == 0)
+        threads = 1;
+
+    this->chunks.resize(threads);
+    for (unsigned int i = 0; i < threads; ++i)
+    {
+        Chunk &chunk = this->chunks[i];
+        chunk.Games = nullptr;
+        chunk.First = static_cast<unsigned int>(static_cast<unsigned long long>(count) * i / threads);
+        chunk.Count = static_cast<unsigned int>(static_cast<unsigned long long>(count) * (i + 1) / threads) - chunk.First;
+    }
+    for (unsigned int i = 1; i < threads; ++i)
+        this->chunks[i].Thread = std::thread(&GameBatch::workerLoop, this, i);
+
+    // each thread creates its own games
+    this->run(JOB_CREATE);
+    if (count > 0)
+        this->breakable = this->chunks[0].Games[0].Levels[this->level].LiveBreakable();
+}
+
+// destructor
+GameBatch::~GameBatch()
+{
+    this->run(JOB_DESTROY);
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->quitting = true;
+    }
+    this->started.notify_all();
+    for (Chunk &chunk : this->chunks)
+    {
+        if (chunk.Thread.joinable())
+            chunk.Thread.join();
+    }
+}
+
+// restarts every game
+void GameBatch::Reset(float *observations)
+{
+    this->observations = observations;
+    this->run(JOB_RESET);
+}
+
+// advances every game by one step
+void GameBatch::Step(const unsigned char *actions, float *observations, float *rewards, unsigned char *dones)
+{
+    this->actions = actions;
+    this->observations = observations;
+    this->rewards = rewards;
+    this->dones = dones;
+    this->run(JOB_STEP);
+}
+
+// a game, only to be read between steps
+const Game *GameBatch::GetGame(unsigned int index) const
+{
+    // (this also keeps an empty batch from dividing by zero)
+    if (index >= this->count)
+        return nullptr;
+    unsigned int chunk = static_cast<unsigned int>(static_cast<unsigned long long>(index) * this->chunks.size() / this->count);
+    while (index < this->chunks[chunk].First)
+        --chunk;
+    while (index >= this->chunks[chunk].First + this->chunks[chunk].Count)
+        ++chunk;
+    return &this->chunks[chunk].Games[index - this->chunks[chunk].First];
+}
+
+// runs a job on every chunk
+void GameBatch::run(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->job = job;
+        this->running = static_cast<unsigned int>(this->chunks.size()) - 1;
+        ++this->generation;
+    }
+    this->started.notify_all();
+
+    // the calling thread works the first chunk, then waits for the rest
+    this->work(this->chunks[0], job);
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->finished.wait(lock, [this] { return this->running == 0; });
+}
+
+// waits for jobs on one chunk's thread
+void GameBatch::workerLoop(unsigned int chunk)
+{
+    unsigned long long done = 0;
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->started.wait(lock, [this, done] { return this->quitting || this->generation != done; });
+            if (this->quitting)
+                return;
+            done = this->generation;
+            job = this->job;
+        }
+
+        this->work(this->chunks[chunk], job);
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (--this->running == 0)
+            this->finished.notify_one();
+    }
+}
+
+// does a job on one chunk
+void GameBatch::work(Chunk &chunk, Job job)
+{
+    MemoryScope scope(MEMORY_SIMULATION);
+    switch (job)
+    {
+    case JOB_CREATE:
+        // the chunk's games sit side by side, each loading only the level it plays
+        chunk.Games = static_cast<Game *>(::operator new(sizeof(Game) * chunk.Count));
+        for (unsigned int i = 0; i < chunk.Count; ++i)
+        {
+            Game *game = new (&chunk.Games[i]) Game(this->width, this->height);
+            game->InitSimulation(static_cast<int>(this->level));
+            game->StartLevel(this->level);
+        }
+        break;
+
+    case JOB_RESET:
+        for (unsigned int i = 0; i < chunk.Count; ++i)
+        {
+            chunk.Games[i].StartLevel(this->level);
+            this->observe(chunk.Games[i], this->observations + (chunk.First + i) * OBSERVATION_SIZE);
+        }
+        break;
+
+    case JOB_STEP:
+        for (unsigned int i = 0; i < chunk.Count; ++i)
+        {
+            Game &game = chunk.Games[i];
+            unsigned int index = chunk.First + i;
+            unsigned long long bricks = game.BricksBroken, lives = game.LivesLost;
+
+            game.ProcessVersusInput(this->stepMs, this->actions + index * 2);
+            game.Update(this->stepMs);
+
+            this->rewards[index] = static_cast<float>(game.BricksBroken - bricks) - static_cast<float>(game.LivesLost - lives);
+            this->dones[index] = game.State != GAME_ACTIVE;
+            if (this->dones[index])
+                game.StartLevel(this->level);
+            this->observe(game, this->observations + index * OBSERVATION_SIZE);
+        }
+        break;
+
+    case JOB_DESTROY:
+        for (unsigned int i = 0; i < chunk.Count; ++i)
+            chunk.Games[i].~Game();
+        ::operator delete(chunk.Games);
+        chunk.Games = nullptr;
+        break;
+    }
+}
+
+// writes one game's observation
+void GameBatch::observe(const Game &game, float *observation) const
+{
+    const float speed = glm::length(INITIAL_BALL_VELOCITY);
+    const float width = static_cast<float>(game.Width), height = static_cast<float>(game.Height);
+
+    *observation++ = (game.Player.Position.x + game.Player.Size.x / 2.0f) / width;
+    *observation++ = (game.Player2.Position.x + game.Player2.Size.x / 2.0f) / width;
+
+    const BallObject *balls[2] = {&game.Ball, &game.Ball2};
+    for (const BallObject *ball : balls)
+    {
+        // a ball below the screen (or moved off it, outside Super Breakout) is out of play
+        if (ball->Position.y >= height)
+        {
+            for (unsigned int i = 0; i < 5; ++i)
+                *observation++ = 0.0f;
+            continue;
+        }
+        *observation++ = (ball->Position.x + ball->Radius) / width;
+        *observation++ = (ball->Position.y + ball->Radius) / height;
+        *observation++ = ball->Velocity.x / speed;
+        *observation++ = ball->Velocity.y / speed;
+        *observation++ = ball->Stuck ? 1.0f : 0.0f;
+    }
+
+    *observation++ = game.Lives / 3.0f;
+    *observation++ = this->breakable > 0 ? game.Levels[game.Level].LiveBreakable() / static_cast<float>(this->breakable) : 0.0f;
+}
@@ -7,7 +7,12 @@
 ** option) any later version.
 ******************************************************************/
 #include "game_level.hpp"
+#include "memory_stats.hpp"
+#include "embedded_assets.hpp"
+#include "trace.hpp"
+#include "fixed_point.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -15,29 +20,59 @@
 // loads level from file
 void GameLevel::Load(const char *file, unsigned int levelWidth, unsigned int levelHeight)
 {
+    TRACE_ZONE("GameLevel::Load");
+    MemoryScope scope(MEMORY_LEVELS);
+
     // clear old data
     this->Bricks.clear();
+    this->Events.clear();
+    this->liveBreakable = 0;
+    this->fixedLeft.clear();
+    this->fixedTop.clear();
+    this->fixedRight.clear();
+    this->fixedBottom.clear();
+    this->Layout = std::make_shared<const std::vector<SpriteState>>();
+
+    // use the tiles parsed at build time if the level is embedded
+    const EmbeddedLevel *embedded = EmbeddedAssets::FindLevel(file);
+    if (embedded != nullptr)
+    {
+        if (embedded->Height > 0)
+            this->init(embedded->Tiles, embedded->Width, embedded->Height, levelWidth, levelHeight);
+        return;
+    }
 
-    // load from file
+    // otherwise load from file
     unsigned int tileCode;
-    GameLevel level;
     std::string line;
     std::ifstream fstream(file);
-    std::vector<std::vector<unsigned int>> tileData;
+    std::vector<unsigned char> tiles;
+    unsigned int width = 0, height = 0;
     if (fstream)
     {
         while (std::getline(fstream, line)) // read each line from level file
         {
             std::istringstream sstream(line);
-            std::vector<unsigned int> row;
+            unsigned int rowWidth = 0;
             while (sstream >> tileCode) // read each word separated by spaces
-                row.push_back(tileCode);
-            tileData.push_back(row);
+            {
+                tiles.push_back(static_cast<unsigned char>(std::min(tileCode, 255u)));
+                ++rowWidth;
+            }
+            if (rowWidth == 0)
+                continue;
+            if (height > 0 && rowWidth != width)
+            {
+                std::cout << "ERROR::LEVEL: Rows of different widths in " << file << std::endl;
+                return;
+            }
+            width = rowWidth;
+            ++height;
         }
 
         // if there is any data in the level file, initialize a game level from it
-        if (tileData.size() > 0)
-            this->init(tileData, levelWidth, levelHeight);
+        if (height > 0)
+            this->init(tiles.data(), width, height, levelWidth, levelHeight);
     }
 }
 
@@ -50,22 +85,102 @@ void GameLevel::Draw(SpriteRenderer &renderer)
             tile.Draw(renderer);
 }
 
-// check if the level is completed (all non-solid tiles are destroyed)
-bool GameLevel::IsCompleted()
+// render a level layout, drawing only the bricks marked alive
+void GameLevel::Draw(SpriteRenderer &renderer, const std::vector<SpriteState> &layout, const std::vector<bool> &alive)
 {
-    // look through the bricks to see if any are still not destroyed. if one is, level is not completed yet
-    for (GameObject &tile : this->Bricks)
-        if (!tile.IsSolid && !tile.Destroyed)
-            return false;
+    for (unsigned int i = 0; i < layout.size() && i < alive.size(); ++i)
+    {
+        if (alive[i])
+        {
+            const SpriteState &tile = layout[i];
+            renderer.DrawSprite(tile.Sprite, tile.Position, tile.Size, tile.Rotation, tile.ColorIndex);
+        }
+    }
+}
+
+// destroy a breakable brick, queueing an event for it
+bool GameLevel::DestroyBrick(unsigned int brick)
+{
+    GameObject &tile = this->Bricks[brick];
+    if (tile.IsSolid || tile.Destroyed)
+        return false;
+
+    tile.Destroyed = true;
+    --this->liveBreakable;
+    this->Events.push_back(BrickEvent{brick, tile.Position, tile.Size, tile.ColorIndex});
     return true;
 }
 
+// copy out which bricks are alive
+void GameLevel::GetAlive(std::vector<bool> &alive) const
+{
+    alive.resize(this->Bricks.size());
+    for (unsigned int i = 0; i < this->Bricks.size(); ++i)
+        alive[i] = !this->Bricks[i].Destroyed;
+}
+
+// restore which bricks are alive
+void GameLevel::SetAlive(const std::vector<bool> &alive)
+{
+    this->Events.clear();
+    this->liveBreakable = 0;
+    for (unsigned int i = 0; i < this->Bricks.size() && i < alive.size(); ++i)
+    {
+        GameObject &tile = this->Bricks[i];
+        tile.Destroyed = !alive[i];
+        if (!tile.IsSolid && !tile.Destroyed)
+            ++this->liveBreakable;
+    }
+}
+
+// mark one breakable brick alive or destroyed without queueing an event
+void GameLevel::SetBrickAlive(unsigned int brick, bool alive)
+{
+    GameObject &tile = this->Bricks[brick];
+    if (tile.IsSolid || tile.Destroyed == !alive)
+        return;
+
+    tile.Destroyed = !alive;
+    if (alive)
+        ++this->liveBreakable;
+    else
+        --this->liveBreakable;
+}
+
+// where the rectangles padding the fixed-point edges are (far enough from any position to never be touched, near
+// enough that its offset from one fits in 32 bits)
+const int FAR_AWAY = -(1 << 29);
+
+// marks the rectangles of blocks first to count a circle touches. The offsets to the closest point of each are clamped
+// to just past the radius, which leaves the comparison as it was and keeps the sum of the squares within 32 bits for
+// radii under 2^15 / sqrt(2) (game.cpp checks the ball's). Sweeping whole blocks leaves no remainder to handle one by
+// one, which is what lets -O2 vectorize the loop
+static void sweepCircle(const int *__restrict left, const int *__restrict top, const int *__restrict right, const int *__restrict bottom,
+                        unsigned char *__restrict hits, unsigned int first, unsigned int count, int x, int y, int radius)
+{
+    int limit = radius + 1;
+    int reach = radius * radius;
+    for (unsigned int i = first * GameLevel::SWEEP_BLOCK; i < count * GameLevel::SWEEP_BLOCK; ++i)
+    {
+        int dx = std::min(std::max(x, left[i]), right[i]) - x;
+        int dy = std::min(std::max(y, top[i]), bottom[i]) - y;
+        dx = std::min(std::max(dx, -limit), limit);
+        dy = std::min(std::max(dy, -limit), limit);
+        hits[i] = static_cast<unsigned char>(dx * dx + dy * dy <= reach);
+    }
+}
+
+// find the bricks a circle touches
+void GameLevel::SweepFixed(int x, int y, int radius, unsigned int first, unsigned char *hits) const
+{
+    sweepCircle(this->fixedLeft.data(), this->fixedTop.data(), this->fixedRight.data(), this->fixedBottom.data(), hits,
+                first / SWEEP_BLOCK, static_cast<unsigned int>(this->fixedLeft.size()) / SWEEP_BLOCK, x, y, radius);
+}
+
 // initialize level from tile data
-void GameLevel::init(std::vector<std::vector<unsigned int>> tileData, unsigned int levelWidth, unsigned int levelHeight)
+void GameLevel::init(const unsigned char *tiles, unsigned int width, unsigned int height, unsigned int levelWidth, unsigned int levelHeight)
 {
     // calculate dimensions
-    unsigned int height = tileData.size();
-    unsigned int width = tileData[0].size();
     float unit_width = levelWidth / static_cast<float>(width), unit_height = levelHeight / 11;
 
     // initialize level tiles based on tileData
@@ -73,55 +188,85 @@ void GameLevel::init(std::vector<std::vector<unsigned int>> tileData, unsigned i
     {
         for (unsigned int x = 0; x < width; ++x)
         {
+            unsigned int tile = tiles[y * width + x];
+
             // check block type from level data (2D level array)
             // solid block
-            if (tileData[y][x] == 1 || tileData[y][x] > 7)
+            if (tile == 1 || tile > 7)
             {
                 int colorIndex = 1; // original: black
 
                 // if solid block is a type 1, it is a solid block from the middle of the screen, so color it white
-                if (tileData[y][x] == 1)
+                if (tile == 1)
                     colorIndex = 10;
                 // if the solid block is a type 8, it is a screen border block, so color it light grey
-                else if (tileData[y][x] == 8)
+                else if (tile == 8)
                     colorIndex = 9;
 
                 // create the solid block and add it to the bricks vector
                 glm::vec2 pos(unit_width * x, unit_height * y);
                 glm::vec2 size(unit_width, unit_height);
-                GameObject obj(pos, size, ResourceManager::GetTexture("block_solid"), colorIndex);
+                GameObject obj(pos, size, colorIndex);
                 obj.IsSolid = true;
                 this->Bricks.push_back(obj);
             }
             // non-solid block
-            else if (tileData[y][x] > 1)
+            else if (tile > 1)
             {
                 int colorIndex = 1.0; // original: black
 
                 // blue block
-                if (tileData[y][x] == 2)
+                if (tile == 2)
                     colorIndex = 2;
                 // green block
-                else if (tileData[y][x] == 3)
+                else if (tile == 3)
                     colorIndex = 3;
                 // yellow block
-                else if (tileData[y][x] == 4)
+                else if (tile == 4)
                     colorIndex = 4;
                 // gold block
-                else if (tileData[y][x] == 5)
+                else if (tile == 5)
                     colorIndex = 5;
                 // orange block
-                else if (tileData[y][x] == 6)
+                else if (tile == 6)
                     colorIndex = 6;
                 // red block
-                else if (tileData[y][x] == 7)
+                else if (tile == 7)
                     colorIndex = 7;
 
                 // create the non-solid block and add it to the bricks vector
                 glm::vec2 pos(unit_width * x, unit_height * y);
                 glm::vec2 size(unit_width, unit_height);
-                this->Bricks.push_back(GameObject(pos, size, ResourceManager::GetTexture("block"), colorIndex));
+                this->Bricks.push_back(GameObject(pos, size, colorIndex));
+                ++this->liveBreakable;
             }
         }
     }
+
+    // publish the draw state of the new bricks for the render thread
+    std::shared_ptr<std::vector<SpriteState>> layout = std::make_shared<std::vector<SpriteState>>();
+    layout->reserve(this->Bricks.size());
+    for (const GameObject &tile : this->Bricks)
+        layout->push_back(tile.GetSpriteState());
+    this->Layout = layout;
+
+    // and lay out their edges for the fixed physics
+    for (const GameObject &tile : this->Bricks)
+    {
+        glm::ivec2 position(ToFixed(tile.Position.x, FIXED_POSITION_BITS), ToFixed(tile.Position.y, FIXED_POSITION_BITS));
+        glm::ivec2 size(ToFixed(tile.Size.x, FIXED_POSITION_BITS), ToFixed(tile.Size.y, FIXED_POSITION_BITS));
+        this->fixedLeft.push_back(position.x);
+        this->fixedTop.push_back(position.y);
+        this->fixedRight.push_back(position.x + size.x);
+        this->fixedBottom.push_back(position.y + size.y);
+    }
+
+    // padded to whole blocks with rectangles far outside the level, which nothing ever touches
+    while (this->fixedLeft.size() % SWEEP_BLOCK != 0)
+    {
+        this->fixedLeft.push_back(FAR_AWAY);
+        this->fixedTop.push_back(FAR_AWAY);
+        this->fixedRight.push_back(FAR_AWAY);
+        this->fixedBottom.push_back(FAR_AWAY);
+    }
 }
\ No newline at end of file
@@ -9,12 +9,22 @@
 #include "game_object.hpp"
 
 // construct a game object
-GameObject::GameObject(glm::vec2 pos, glm::vec2 size, Texture2D sprite, int colorIndex, glm::vec2 velocity)
+GameObject::GameObject(glm::vec2 pos, glm::vec2 size, TextureHandle sprite, int colorIndex, glm::vec2 velocity)
     : Position(pos), Size(size), Velocity(velocity), ColorIndex(colorIndex), Rotation(0.0f), Sprite(sprite), IsSolid(false), Destroyed(false) {}
 
+// construct a flat colored game object
+GameObject::GameObject(glm::vec2 pos, glm::vec2 size, int colorIndex, glm::vec2 velocity)
+    : GameObject(pos, size, TextureHandle{0}, colorIndex, velocity) {}
+
 // draw sprite
 void GameObject::Draw(SpriteRenderer &renderer)
 {
     // use the renderer to draw the object
     renderer.DrawSprite(this->Sprite, this->Position, this->Size, this->Rotation, this->ColorIndex);
+}
+
+// copy out the state needed to draw this object
+SpriteState GameObject::GetSpriteState() const
+{
+    return SpriteState{this->Position, this->Size, this->Rotation, this->ColorIndex, this->Sprite};
 }
\ No newline at end of file
@@ -0,0 +1,212 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <iostream>
+#include <cstring>
+
+#include "game_snapshot.hpp"
+
+// Marks a snapshot (and its layout version)
+const unsigned char SNAPSHOT_MAGIC[2] = {'B', 'S'};
+const unsigned char SNAPSHOT_VERSION = 1;
+
+// Snapshot flags
+const unsigned char SNAPSHOT_DELTA = 1 << 0;
+
+// writes a little endian integer into a snapshot
+static unsigned char *writeInt(unsigned char *out, unsigned int value, unsigned int bytes)
+{
+    for (unsigned int i = 0; i < bytes; ++i)
+        *out++ = static_cast<unsigned char>(value >> (8 * i));
+    return out;
+}
+
+// reads a little endian integer from a snapshot
+static const unsigned char *readInt(const unsigned char *in, unsigned int &value, unsigned int bytes)
+{
+    value = 0;
+    for (unsigned int i = 0; i < bytes; ++i)
+        value |= static_cast<unsigned int>(*in++) << (8 * i);
+    return in;
+}
+
+// writes a vector's floats by their bits
+static unsigned char *writeVec(unsigned char *out, glm::vec2 value)
+{
+    unsigned int bits[2];
+    std::memcpy(bits, &value[0], sizeof(bits));
+    out = writeInt(out, bits[0], 4);
+    return writeInt(out, bits[1], 4);
+}
+
+static const unsigned char *readVec(const unsigned char *in, glm::vec2 &value)
+{
+    unsigned int bits[2];
+    in = readInt(in, bits[0], 4);
+    in = readInt(in, bits[1], 4);
+    std::memcpy(&value[0], bits, sizeof(bits));
+    return in;
+}
+
+// the largest snapshot of a level with this many bricks
+unsigned int GameSnapshot::MaxSize(unsigned int bricks)
+{
+    // a delta is only ever written when it is smaller than the alive bits
+    return HEADER_SIZE + (bricks + 7) / 8;
+}
+
+// saves a game into out
+unsigned int GameSnapshot::Save(const Game &game, unsigned char *out, unsigned int capacity, bool delta)
+{
+    const GameLevel &level = game.Levels[game.Level];
+    unsigned int bricks = static_cast<unsigned int>(level.Bricks.size());
+    if (bricks > 0xFFFF)
+    {
+        std::cout << "ERROR::GAME_SNAPSHOT: Too many bricks to save (" << bricks << ")" << std::endl;
+        return 0;
+    }
+
+    // a delta costs two bytes for the count and two per destroyed brick, the alive bits one per eight bricks
+    unsigned int destroyed = 0;
+    if (delta)
+    {
+        for (const GameObject &brick : level.Bricks)
+            destroyed += brick.Destroyed;
+        delta = 2 + 2 * destroyed < (bricks + 7) / 8;
+    }
+    unsigned int size = HEADER_SIZE + (delta ? 2 + 2 * destroyed : (bricks + 7) / 8);
+    if (size > capacity)
+        return 0;
+
+    unsigned char *at = out;
+    *at++ = SNAPSHOT_MAGIC[0];
+    *at++ = SNAPSHOT_MAGIC[1];
+    *at++ = SNAPSHOT_VERSION;
+    *at++ = delta ? SNAPSHOT_DELTA : 0;
+    *at++ = static_cast<unsigned char>(game.State);
+    *at++ = static_cast<unsigned char>(game.Level);
+    *at++ = static_cast<unsigned char>(game.Lives);
+    *at++ = static_cast<unsigned char>(game.Ball.Stuck << 0 | game.Ball2.Stuck << 1 | game.ballDead << 2 | game.ball2Dead << 3);
+    at = writeInt(at, static_cast<unsigned int>(game.Score), 4);
+
+    at = writeVec(at, game.Player.Position);
+    at = writeVec(at, game.Player2.Position);
+    at = writeVec(at, game.Player.Size);
+    at = writeVec(at, game.Player2.Size);
+    at = writeVec(at, game.Ball.Position);
+    at = writeVec(at, game.Ball2.Position);
+    at = writeVec(at, game.Ball.Velocity);
+    at = writeVec(at, game.Ball2.Velocity);
+
+    at = writeInt(at, bricks, 2);
+    if (delta)
+    {
+        at = writeInt(at, destroyed, 2);
+        for (unsigned int i = 0; i < bricks; ++i)
+        {
+            if (level.Bricks[i].Destroyed)
+                at = writeInt(at, i, 2);
+        }
+    }
+    else
+    {
+        std::memset(at, 0, (bricks + 7) / 8);
+        for (unsigned int i = 0; i < bricks; ++i)
+            at[i / 8] |= static_cast<unsigned char>(!level.Bricks[i].Destroyed) << (i % 8);
+        at += (bricks + 7) / 8;
+    }
+    return static_cast<unsigned int>(at - out);
+}
+
+// restores a game from a snapshot
+bool GameSnapshot::Load(Game &game, const unsigned char *data, unsigned int size)
+{
+    if (size < HEADER_SIZE || data[0] != SNAPSHOT_MAGIC[0] || data[1] != SNAPSHOT_MAGIC[1] || data[2] != SNAPSHOT_VERSION)
+    {
+        std::cout << "ERROR::GAME_SNAPSHOT: Not a snapshot this version can load" << std::endl;
+        return false;
+    }
+    bool delta = (data[3] & SNAPSHOT_DELTA) != 0;
+    unsigned int state = data[4], levelIndex = data[5], lives = data[6], balls = data[7];
+
+    // check the whole snapshot before changing anything
+    unsigned int bricks, destroyed = 0;
+    readInt(data + HEADER_SIZE - 2, bricks, 2);
+    if (state > GAME_WIN || levelIndex >= game.Levels.size() || game.Levels[levelIndex].Bricks.size() != bricks)
+    {
+        std::cout << "ERROR::GAME_SNAPSHOT: Snapshot does not match the game's levels" << std::endl;
+        return false;
+    }
+    const unsigned char *bricksData = data + HEADER_SIZE;
+    if (delta)
+    {
+        if (size >= HEADER_SIZE + 2)
+            bricksData = readInt(bricksData, destroyed, 2);
+        if (size != HEADER_SIZE + 2 + 2 * destroyed)
+        {
+            std::cout << "ERROR::GAME_SNAPSHOT: Snapshot is truncated" << std::endl;
+            return false;
+        }
+        for (unsigned int i = 0; i < destroyed; ++i)
+        {
+            unsigned int brick;
+            readInt(bricksData + 2 * i, brick, 2);
+            if (brick >= bricks)
+            {
+                std::cout << "ERROR::GAME_SNAPSHOT: Snapshot destroys brick " << brick << " of " << bricks << std::endl;
+                return false;
+            }
+        }
+    }
+    else if (size != HEADER_SIZE + (bricks + 7) / 8)
+    {
+        std::cout << "ERROR::GAME_SNAPSHOT: Snapshot is truncated" << std::endl;
+        return false;
+    }
+
+    game.State = static_cast<GameState>(state);
+    game.Level = levelIndex;
+    game.Lives = lives;
+    game.Ball.Stuck = (balls & 1 << 0) != 0;
+    game.Ball2.Stuck = (balls & 1 << 1) != 0;
+    game.ballDead = (balls & 1 << 2) != 0;
+    game.ball2Dead = (balls & 1 << 3) != 0;
+    unsigned int score;
+    const unsigned char *in = readInt(data + 8, score, 4);
+    game.Score = static_cast<int>(score);
+
+    in = readVec(in, game.Player.Position);
+    in = readVec(in, game.Player2.Position);
+    in = readVec(in, game.Player.Size);
+    in = readVec(in, game.Player2.Size);
+    in = readVec(in, game.Ball.Position);
+    in = readVec(in, game.Ball2.Position);
+    in = readVec(in, game.Ball.Velocity);
+    in = readVec(in, game.Ball2.Velocity);
+
+    GameLevel &level = game.Levels[levelIndex];
+    level.Events.clear();
+    if (delta)
+    {
+        // every brick the level starts with, less the destroyed ones
+        for (unsigned int i = 0; i < bricks; ++i)
+            level.SetBrickAlive(i, true);
+        for (unsigned int i = 0; i < destroyed; ++i)
+        {
+            unsigned int brick;
+            readInt(bricksData + 2 * i, brick, 2);
+            level.SetBrickAlive(brick, false);
+        }
+    }
+    else
+    {
+        for (unsigned int i = 0; i < bricks; ++i)
+            level.SetBrickAlive(i, (bricksData[i / 8] >> (i % 8) & 1) != 0);
+    }
+    return true;
+}
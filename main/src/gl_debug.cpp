@@ -0,0 +1,271 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <iostream>
+#include <cstring>
+
+#include "gl_debug.hpp"
+
+// instantiate static members
+std::atomic<bool> GLDebug::enabled(false);
+std::atomic<const char *> GLDebug::scope(nullptr);
+
+// A slot of the message ring. Its sequence says whose turn it is: equal to a
+// write position it is free for that message, one past it the message is
+// written and waiting to be drained (a bounded multi-producer queue, so the
+// driver can report from any thread without locking)
+struct DebugSlot
+{
+    std::atomic<unsigned int> Sequence;
+    GLDebugMessage Message;
+};
+
+static DebugSlot slots[GLDebug::CAPACITY];
+static std::atomic<unsigned int> writePosition(0);
+static unsigned int readPosition = 0;
+static std::atomic<unsigned int> droppedMessages(0);
+static std::atomic<int> minimumSeverity(DEBUG_SEVERITY_HIGH);
+
+// the severity of a GL severity enum
+static DebugSeverity toSeverity(GLenum severity)
+{
+    switch (severity)
+    {
+    case GL_DEBUG_SEVERITY_HIGH:
+        return DEBUG_SEVERITY_HIGH;
+    case GL_DEBUG_SEVERITY_MEDIUM:
+        return DEBUG_SEVERITY_MEDIUM;
+    case GL_DEBUG_SEVERITY_LOW:
+        return DEBUG_SEVERITY_LOW;
+    default:
+        return DEBUG_SEVERITY_NOTIFICATION;
+    }
+}
+
+static const char *sourceName(GLenum source)
+{
+    switch (source)
+    {
+    case GL_DEBUG_SOURCE_API:
+        return "API";
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM:
+        return "window system";
+    case GL_DEBUG_SOURCE_SHADER_COMPILER:
+        return "shader compiler";
+    case GL_DEBUG_SOURCE_THIRD_PARTY:
+        return "third party";
+    case GL_DEBUG_SOURCE_APPLICATION:
+        return "application";
+    default:
+        return "other";
+    }
+}
+
+static const char *typeName(GLenum type)
+{
+    switch (type)
+    {
+    case GL_DEBUG_TYPE_ERROR:
+        return "error";
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
+        return "deprecated behavior";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
+        return "undefined behavior";
+    case GL_DEBUG_TYPE_PORTABILITY:
+        return "portability";
+    case GL_DEBUG_TYPE_PERFORMANCE:
+        return "performance";
+    case GL_DEBUG_TYPE_MARKER:
+        return "marker";
+    default:
+        return "other";
+    }
+}
+
+// called by the driver for every enabled message, from within the call that caused it. Only copies the
+// message into the ring
+static void APIENTRY debugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                                   const GLchar *message, const void *)
+{
+    // the groups scopes push are reported as notifications of their own, they are not news
+    if (type == GL_DEBUG_TYPE_PUSH_GROUP || type == GL_DEBUG_TYPE_POP_GROUP)
+        return;
+    DebugSeverity level = toSeverity(severity);
+    if (level < minimumSeverity.load(std::memory_order_relaxed))
+        return;
+
+    // claim the next free slot, or drop the message when the ring is full
+    unsigned int position = writePosition.load(std::memory_order_relaxed);
+    DebugSlot *slot;
+    for (;;)
+    {
+        slot = &slots[position % GLDebug::CAPACITY];
+        int turn = static_cast<int>(slot->Sequence.load(std::memory_order_acquire) - position);
+        if (turn == 0)
+        {
+            if (writePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (turn < 0)
+        {
+            droppedMessages.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else
+            position = writePosition.load(std::memory_order_relaxed);
+    }
+
+    GLDebugMessage &out = slot->Message;
+    out.Source = source;
+    out.Type = type;
+    out.ID = id;
+    out.Severity = level;
+    out.Scope = GLDebug::CurrentScope();
+    size_t size = length >= 0 ? static_cast<size_t>(length) : std::strlen(message);
+    if (size > sizeof(out.Text) - 1)
+        size = sizeof(out.Text) - 1;
+    std::memcpy(out.Text, message, size);
+    out.Text[size] = '\0';
+    slot->Sequence.store(position + 1, std::memory_order_release);
+}
+
+// installs the callback and enables messages of at least the given severity
+bool GLDebug::Enable(DebugSeverity minimum)
+{
+    if (!GLExtensions::HasDebugOutput())
+    {
+        std::cout << "ERROR::GL_DEBUG: The context supports neither KHR_debug nor ARB_debug_output" << std::endl;
+        return false;
+    }
+    for (unsigned int i = 0; i < CAPACITY; ++i)
+        slots[i].Sequence.store(i, std::memory_order_relaxed);
+    writePosition.store(0, std::memory_order_relaxed);
+    readPosition = 0;
+    minimumSeverity.store(minimum, std::memory_order_relaxed);
+    GLExtensions::DebugMessageCallback(debugCallback, nullptr);
+
+    // only have the driver generate the messages wanted (ARB_debug_output has no notifications)
+    bool labels = GLExtensions::HasDebugLabels();
+    const GLenum severities[4] = {GL_DEBUG_SEVERITY_NOTIFICATION, GL_DEBUG_SEVERITY_LOW, GL_DEBUG_SEVERITY_MEDIUM, GL_DEBUG_SEVERITY_HIGH};
+    for (int severity = DEBUG_SEVERITY_NOTIFICATION; severity <= DEBUG_SEVERITY_HIGH; ++severity)
+    {
+        if (labels || severity != DEBUG_SEVERITY_NOTIFICATION)
+            GLExtensions::DebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, severities[severity], 0, nullptr, severity >= minimum ? GL_TRUE : GL_FALSE);
+    }
+    if (labels)
+    {
+        GLExtensions::DebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_PUSH_GROUP, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+        GLExtensions::DebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_POP_GROUP, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+        // debug contexts start with output on, others need it turned on (ARB_debug_output only reports in debug contexts)
+        glEnable(GL_DEBUG_OUTPUT);
+    }
+    // messages are tagged with the current scope, which is only theirs if they arrive during the call
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+
+    GLint flags = 0;
+    glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+    if ((flags & GL_CONTEXT_FLAG_DEBUG_BIT) == 0)
+        std::cout << "GL_DEBUG: Not a debug context, the driver may report fewer messages" << std::endl;
+    enabled.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+// parses a severity name
+bool GLDebug::ParseSeverity(const std::string &name, DebugSeverity &severity)
+{
+    for (int value = DEBUG_SEVERITY_NOTIFICATION; value <= DEBUG_SEVERITY_HIGH; ++value)
+    {
+        if (name == SeverityName(static_cast<DebugSeverity>(value)))
+        {
+            severity = static_cast<DebugSeverity>(value);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *GLDebug::SeverityName(DebugSeverity severity)
+{
+    switch (severity)
+    {
+    case DEBUG_SEVERITY_HIGH:
+        return "high";
+    case DEBUG_SEVERITY_MEDIUM:
+        return "medium";
+    case DEBUG_SEVERITY_LOW:
+        return "low";
+    default:
+        return "notification";
+    }
+}
+
+// names a GL object in debug messages
+void GLDebug::Label(GLenum identifier, GLuint name, const std::string &label)
+{
+    if (Enabled() && GLExtensions::HasDebugLabels())
+        GLExtensions::ObjectLabel(identifier, name, static_cast<GLsizei>(label.size()), label.c_str());
+}
+
+// copies the collected messages out (only ever called from one thread)
+unsigned int GLDebug::Drain(GLDebugMessage *out, unsigned int capacity, unsigned int &dropped)
+{
+    unsigned int count = 0;
+    while (count < capacity)
+    {
+        DebugSlot &slot = slots[readPosition % CAPACITY];
+        if (slot.Sequence.load(std::memory_order_acquire) != readPosition + 1)
+            break;
+        out[count++] = slot.Message;
+        slot.Sequence.store(readPosition + CAPACITY, std::memory_order_release);
+        ++readPosition;
+    }
+    dropped = droppedMessages.exchange(0, std::memory_order_relaxed);
+    return count;
+}
+
+// writes the collected messages to a stream
+unsigned int GLDebug::Report(std::ostream &out)
+{
+    if (!Enabled())
+        return 0;
+    GLDebugMessage messages[16];
+    unsigned int total = 0, count, dropped;
+    do
+    {
+        count = Drain(messages, 16, dropped);
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            const GLDebugMessage &message = messages[i];
+            out << (message.Type == GL_DEBUG_TYPE_ERROR ? "ERROR::GL_DEBUG: " : "GL_DEBUG: ") << SeverityName(message.Severity)
+                << " " << sourceName(message.Source) << " " << typeName(message.Type) << " " << message.ID;
+            if (message.Scope != nullptr)
+                out << " in " << message.Scope;
+            out << ": " << message.Text << "\n";
+        }
+        if (dropped > 0)
+            out << "GL_DEBUG: " << dropped << " messages dropped, the ring was full\n";
+        total += count;
+    } while (count == 16);
+    return total;
+}
+
+// opens a scope, returning the one it is nested in
+const char *GLDebug::PushScope(const char *name)
+{
+    const char *previous = scope.exchange(name, std::memory_order_relaxed);
+    if (GLExtensions::HasDebugLabels())
+        GLExtensions::PushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+    return previous;
+}
+
+void GLDebug::PopScope(const char *previous)
+{
+    if (GLExtensions::HasDebugLabels())
+        GLExtensions::PopDebugGroup();
+    scope.store(previous, std::memory_order_relaxed);
+}
@@ -0,0 +1,82 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <cstring>
+
+#include "gl_extensions.hpp"
+
+// instantiate static members
+PFNGLBUFFERSTORAGEPROC GLExtensions::BufferStorage = nullptr;
+PFNGLDEBUGMESSAGECALLBACKPROC GLExtensions::DebugMessageCallback = nullptr;
+PFNGLDEBUGMESSAGECONTROLPROC GLExtensions::DebugMessageControl = nullptr;
+PFNGLOBJECTLABELPROC GLExtensions::ObjectLabel = nullptr;
+PFNGLPUSHDEBUGGROUPPROC GLExtensions::PushDebugGroup = nullptr;
+PFNGLPOPDEBUGGROUPPROC GLExtensions::PopDebugGroup = nullptr;
+
+// look up the entry points the context supports
+void GLExtensions::Load(GLADloadproc load)
+{
+    BufferStorage = nullptr;
+    if (HasVersion(4, 4))
+        BufferStorage = reinterpret_cast<PFNGLBUFFERSTORAGEPROC>(load("glBufferStorage"));
+    else if (HasExtension("GL_ARB_buffer_storage"))
+        BufferStorage = reinterpret_cast<PFNGLBUFFERSTORAGEPROC>(load("glBufferStorageARB"));
+
+    // KHR_debug is core from 4.3 (its GL entry points have no suffix), ARB_debug_output only has the callback
+    DebugMessageCallback = nullptr;
+    DebugMessageControl = nullptr;
+    ObjectLabel = nullptr;
+    PushDebugGroup = nullptr;
+    PopDebugGroup = nullptr;
+    if (HasVersion(4, 3) || HasExtension("GL_KHR_debug"))
+    {
+        DebugMessageCallback = reinterpret_cast<PFNGLDEBUGMESSAGECALLBACKPROC>(load("glDebugMessageCallback"));
+        DebugMessageControl = reinterpret_cast<PFNGLDEBUGMESSAGECONTROLPROC>(load("glDebugMessageControl"));
+        ObjectLabel = reinterpret_cast<PFNGLOBJECTLABELPROC>(load("glObjectLabel"));
+        PushDebugGroup = reinterpret_cast<PFNGLPUSHDEBUGGROUPPROC>(load("glPushDebugGroup"));
+        PopDebugGroup = reinterpret_cast<PFNGLPOPDEBUGGROUPPROC>(load("glPopDebugGroup"));
+    }
+    else if (HasExtension("GL_ARB_debug_output"))
+    {
+        DebugMessageCallback = reinterpret_cast<PFNGLDEBUGMESSAGECALLBACKPROC>(load("glDebugMessageCallbackARB"));
+        DebugMessageControl = reinterpret_cast<PFNGLDEBUGMESSAGECONTROLPROC>(load("glDebugMessageControlARB"));
+    }
+}
+
+bool GLExtensions::HasBufferStorage()
+{
+    return BufferStorage != nullptr;
+}
+
+bool GLExtensions::HasDebugOutput()
+{
+    return DebugMessageCallback != nullptr && DebugMessageControl != nullptr;
+}
+
+bool GLExtensions::HasDebugLabels()
+{
+    return ObjectLabel != nullptr && PushDebugGroup != nullptr && PopDebugGroup != nullptr;
+}
+
+bool GLExtensions::HasVersion(int major, int minor)
+{
+    return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+bool GLExtensions::HasExtension(const char *name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        const char *extension = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension && std::strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
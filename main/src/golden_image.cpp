@@ -0,0 +1,257 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+
+#include "golden_image.hpp"
+#include "stb_image.h"
+
+// the standard CRC-32 (as used by PNG chunks), table built on first use
+static unsigned int crc32(const unsigned char *data, size_t length, unsigned int crc = 0)
+{
+    static unsigned int table[256] = {0};
+    if (table[1] == 0)
+    {
+        for (unsigned int n = 0; n < 256; ++n)
+        {
+            unsigned int c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < length; ++i)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// appends a big endian 32 bit value
+static void putU32(std::vector<unsigned char> &out, unsigned int value)
+{
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+// appends a PNG chunk (length, type, data, CRC of type and data)
+static void putChunk(std::vector<unsigned char> &out, const char *type, const std::vector<unsigned char> &data)
+{
+    putU32(out, static_cast<unsigned int>(data.size()));
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    putU32(out, crc32(&out[start], out.size() - start));
+}
+
+// writes bits least significant first, as deflate streams are packed
+struct BitWriter
+{
+    std::vector<unsigned char> &out;
+    unsigned int buffer, count;
+
+    BitWriter(std::vector<unsigned char> &out) : out(out), buffer(0), count(0) {}
+
+    void Put(unsigned int bits, unsigned int length)
+    {
+        this->buffer |= bits << this->count;
+        this->count += length;
+        while (this->count >= 8)
+        {
+            this->out.push_back(this->buffer & 0xFF);
+            this->buffer >>= 8;
+            this->count -= 8;
+        }
+    }
+
+    // huffman codes are defined most significant bit first, so they go in reversed
+    void PutCode(unsigned int code, unsigned int length)
+    {
+        unsigned int reversed = 0;
+        for (unsigned int i = 0; i < length; ++i)
+            reversed |= ((code >> i) & 1) << (length - 1 - i);
+        this->Put(reversed, length);
+    }
+
+    void Flush()
+    {
+        if (this->count > 0)
+            this->out.push_back(this->buffer & 0xFF);
+        this->buffer = this->count = 0;
+    }
+};
+
+// writes a literal/length symbol using deflate's fixed huffman code
+static void putSymbol(BitWriter &bits, unsigned int symbol)
+{
+    if (symbol < 144)
+        bits.PutCode(0x30 + symbol, 8);
+    else if (symbol < 256)
+        bits.PutCode(0x190 + symbol - 144, 9);
+    else if (symbol < 280)
+        bits.PutCode(symbol - 256, 7);
+    else
+        bits.PutCode(0xC0 + symbol - 280, 8);
+}
+
+// compresses data as a single fixed huffman deflate block. Rendered frames are mostly flat colour, so
+// looking for repeats of only the previous pixel and the pixel above (distance stride) already shrinks them
+// to a small fraction of their raw size, without pulling in a compression library
+static void deflateFixed(const std::vector<unsigned char> &data, unsigned int stride, std::vector<unsigned char> &out)
+{
+    static const unsigned short LENGTH_BASE[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const unsigned char LENGTH_EXTRA[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const unsigned short DISTANCE_BASE[] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    static const unsigned char DISTANCE_EXTRA[] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    BitWriter bits(out);
+    bits.Put(1, 1); // last block
+    bits.Put(1, 2); // fixed huffman codes
+
+    const unsigned int candidates[] = {4, stride};
+    for (size_t i = 0; i < data.size();)
+    {
+        // find the longest repeat among the candidate distances
+        unsigned int bestLength = 0, bestDistance = 0;
+        for (unsigned int distance : candidates)
+        {
+            if (distance > i || distance > 32768)
+                continue;
+            unsigned int length = 0;
+            while (length < 258 && i + length < data.size() && data[i + length] == data[i + length - distance])
+                ++length;
+            if (length > bestLength)
+            {
+                bestLength = length;
+                bestDistance = distance;
+            }
+        }
+
+        if (bestLength < 3)
+        {
+            putSymbol(bits, data[i++]);
+            continue;
+        }
+
+        unsigned int code = 0;
+        while (code + 1 < 29 && LENGTH_BASE[code + 1] <= bestLength)
+            ++code;
+        putSymbol(bits, 257 + code);
+        bits.Put(bestLength - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+
+        code = 0;
+        while (code + 1 < 30 && DISTANCE_BASE[code + 1] <= bestDistance)
+            ++code;
+        bits.PutCode(code, 5);
+        bits.Put(bestDistance - DISTANCE_BASE[code], DISTANCE_EXTRA[code]);
+
+        i += bestLength;
+    }
+    putSymbol(bits, 256); // end of block
+    bits.Flush();
+}
+
+// loads a PNG as RGBA
+bool GoldenImage::Load(const std::string &path, Image &image)
+{
+    int width, height, nrChannels;
+    unsigned char *data = stbi_load(path.c_str(), &width, &height, &nrChannels, 4);
+    if (data == nullptr)
+        return false;
+    image.Width = width;
+    image.Height = height;
+    image.Pixels.assign(data, data + width * height * 4);
+    stbi_image_free(data);
+    return true;
+}
+
+// writes an image as an RGBA PNG
+bool GoldenImage::Save(const std::string &path, const Image &image)
+{
+    // raw scanlines, each prefixed with filter type 0 (none)
+    std::vector<unsigned char> raw;
+    unsigned int stride = image.Width * 4;
+    raw.reserve((stride + 1) * image.Height);
+    for (unsigned int y = 0; y < image.Height; ++y)
+    {
+        raw.push_back(0);
+        raw.insert(raw.end(), image.Pixels.begin() + y * stride, image.Pixels.begin() + (y + 1) * stride);
+    }
+
+    // zlib stream: header, deflate data, then the adler-32 of the raw data
+    std::vector<unsigned char> zlib = {0x78, 0x01};
+    deflateFixed(raw, stride + 1, zlib);
+    unsigned int a = 1, b = 0;
+    for (unsigned char byte : raw)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    putU32(zlib, (b << 16) | a);
+
+    // signature, header (8 bit RGBA, not interlaced), data and end chunks
+    std::vector<unsigned char> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    std::vector<unsigned char> header;
+    putU32(header, image.Width);
+    putU32(header, image.Height);
+    header.insert(header.end(), {8, 6, 0, 0, 0});
+    putChunk(png, "IHDR", header);
+    putChunk(png, "IDAT", zlib);
+    putChunk(png, "IEND", std::vector<unsigned char>());
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(png.data()), png.size());
+    return static_cast<bool>(file);
+}
+
+// compares two images, counting pixels with a channel more than tolerance apart
+ImageDiff GoldenImage::Compare(const Image &expected, const Image &actual, unsigned int tolerance, Image *diff)
+{
+    ImageDiff result = {expected.Width == actual.Width && expected.Height == actual.Height, 0, 0, 1.0};
+    if (!result.SameSize)
+        return result;
+
+    unsigned int pixels = expected.Width * expected.Height;
+    if (diff != nullptr)
+    {
+        diff->Width = expected.Width;
+        diff->Height = expected.Height;
+        diff->Pixels.assign(pixels * 4, 0);
+    }
+
+    for (unsigned int i = 0; i < pixels; ++i)
+    {
+        unsigned int worst = 0;
+        for (unsigned int c = 0; c < 4; ++c)
+        {
+            unsigned int error = std::abs(expected.Pixels[i * 4 + c] - actual.Pixels[i * 4 + c]);
+            if (error > worst)
+                worst = error;
+        }
+        if (worst > result.MaxChannelError)
+            result.MaxChannelError = worst;
+        if (worst > tolerance)
+            ++result.DifferingPixels;
+
+        // differing pixels in red, matching pixels as a faint grey copy of the expected image
+        if (diff != nullptr)
+        {
+            unsigned char *out = &diff->Pixels[i * 4];
+            unsigned char grey = expected.Pixels[i * 4] / 4;
+            out[0] = worst > tolerance ? 255 : grey;
+            out[1] = worst > tolerance ? 0 : grey;
+            out[2] = worst > tolerance ? 0 : grey;
+            out[3] = 255;
+        }
+    }
+    result.DifferingFraction = pixels > 0 ? static_cast<double>(result.DifferingPixels) / pixels : 0.0;
+    return result;
+}
@@ -11,6 +11,23 @@
 
 #include "game.hpp"
 #include "resource_manager.hpp"
+#include "triple_buffer.hpp"
+#include "spsc_queue.hpp"
+#include "frame_pacer.hpp"
+#include "file_watcher.hpp"
+#include "render_check.hpp"
+#include "gl_extensions.hpp"
+#include "memory_stats.hpp"
+#include "embedded_assets.hpp"
+#include "rollback.hpp"
+#include "autopilot.hpp"
+#include "game_batch.hpp"
+#include "replay.hpp"
+#include "trace.hpp"
+#include "gl_debug.hpp"
+#include "dynamic_resolution.hpp"
+#include "texture_container.hpp"
+#include "audio_mixer.hpp"
 
 #include <iostream>
 
@@ -30,6 +47,13 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <cstdlib>
+#include <algorithm>
+#include <chrono>
+#include <random>
 
 // vvvvvvvvvvvvvvvvvvvvvvvvvv Globals vvvvvvvvvvvvvvvvvvvvvvvvvv
 // Globals generally are prefixed with 'g' in this application.
@@ -41,70 +65,157 @@ SDL_Window *gGraphicsApplicationWindow = nullptr;
 SDL_GLContext gOpenGLContext = nullptr;
 
 // Main loop flag
-bool gQuit = false; // If this is quit = 'true' then the program terminates.
+std::atomic<bool> gQuit(false); // If this is quit = 'true' then the program terminates.
 
 // The Breakout game object
 Game Breakout(gScreenWidth, gScreenHeight);
 
+// A key press or release, handed from the input (main) thread to the simulation thread
+struct KeyEvent
+{
+	int Key;
+	bool Pressed;
+};
+
+// Key events waiting to be applied by the simulation thread
+SpscQueue<KeyEvent, 256> gKeyEvents;
+
+// Snapshots of the game state, published by the simulation thread and drawn by the render (main) thread
+TripleBuffer<RenderSnapshot> gSnapshots;
+
+// The simulation thread
+std::thread gSimulationThread;
+
+// Signalled whenever key events are queued (or on quit), wakes the simulation thread while the game is idle
+SDL_sem *gInputSignal = nullptr;
+
+// A user event the simulation thread pushes after publishing a snapshot while idle, wakes the main thread
+Uint32 gSnapshotEvent = (Uint32)-1;
+
+// Watches the shader, texture and level files and reloads them in place when they change
+FileWatcher gAssetWatcher;
+
+// Levels the simulation thread should reload from disk, one bit per level
+std::atomic<unsigned int> gLevelReloads(0);
+
+// How long an idle thread sleeps before checking whether it should quit, in milliseconds
+const Uint32 IDLE_TIMEOUT = 250;
+
 // The tick interval to advance a frame
 // Used to make the framerate fixed intervals
 int TICK_INTERVAL = 15;
 
-// The next time to advance a frame
-// Used to make the framerate fixed intervals
-static Uint32 next_time;
+// Paces the simulation at fixed tick intervals
+FramePacer gTickPacer(TICK_INTERVAL, PACING_CAPPED);
+
+// Paces rendering, by default by waiting for vsync (selectable with --pacing)
+FramePacer gFramePacer(TICK_INTERVAL, PACING_VSYNC);
+PacingMode gRequestedPacing = PACING_VSYNC;
 
-// Track the time since last frame advanced
+// Samples the memory counters to a file during long runs (enabled with --soak-log)
+SoakLog gSoakLog;
+
+// Track the time since last simulation tick advanced
 float deltaTime = 0.0f;
-float lastFrame = 0.0f;
+
+// Two player versus over UDP (enabled with --netplay): the socket to the peer, the simulated network
+// conditions and the rollback session that drives the game instead of the keyboard
+UdpSocket gNetSocket;
+NetworkConditions gNetConditions = {0, 0, 0};
+RollbackSession *gNetplay = nullptr;
+
+// Plays the game instead of the keyboard (enabled with --autopilot), for attract mode and unattended runs
+Autopilot *gAutopilot = nullptr;
+
+// Records every step of the game to a replay file (enabled with --record)
+ReplayRecorder gRecorder;
+
+// Plays a replay file back instead of the keyboard (enabled with --replay)
+ReplayPlayer *gReplay = nullptr;
+
+// The Chrome trace file zones are written to on exit (enabled with --trace)
+std::string gTraceFile;
+
+// Whether GL errors and warnings are reported through a debug context's callback (enabled with --gl-debug),
+// and the least severe ones reported
+bool gGLDebug = false;
+DebugSeverity gGLDebugSeverity = DEBUG_SEVERITY_MEDIUM;
+
+// Whether the window starts out fullscreen (enabled with --fullscreen, toggled with F11)
+bool gFullscreen = false;
+
+// The GPU time per frame dynamic resolution holds frames to, in milliseconds (enabled with --dynamic-resolution)
+float gDynamicResolutionMs = 0.0f;
+
+// Plays the game's sounds on its own callback thread, at a volume from 0 (no audio device at all) to 1 (set with --volume)
+AudioMixer gAudio;
+float gVolume = 1.0f;
+
+// How far [ and ] seek through a replay, in milliseconds of recorded ticks
+const int REPLAY_SEEK_MS = 10000;
+
+// ^^^^^^^^^^^^^^^^^^^^^^^^ Globals ^^^^^^^^^^^^^^^^^^^^^^^^^^^
 
 /**
- * Determine how much time is left until the frame should be advanced
- * Used to make the framerate fixed intervals
+ * Watch one asset file. Once it is edited on disk its copy embedded in the executable is
+ * stale, so it is overridden (read from disk from then on) before reloading it.
  *
- * @return The amount of ticks left until a frame should be advanced
+ * @param path the asset file
+ * @param reload reloads the resource loaded from the file
+ * @return void
  */
-Uint32 time_left()
+void WatchAsset(const std::string &path, std::function<void()> reload)
 {
-	Uint32 now;
-	now = SDL_GetTicks();
-
-	// If the next time to advance is before or equal to now, return 0 ticks until next advance
-	if (next_time <= now)
-		return 0;
-	// Otherwise, return how much time is left until frame should be advanced
-	else
-		return next_time - now;
+	gAssetWatcher.Watch(path, [path, reload]()
+						{
+							EmbeddedAssets::Override(path);
+							reload(); });
 }
 
-// ^^^^^^^^^^^^^^^^^^^^^^^^ Globals ^^^^^^^^^^^^^^^^^^^^^^^^^^^
-
-// vvvvvvvvvvvvvvvvvvv Error Handling Routines vvvvvvvvvvvvvvv
-static void GLClearAllErrors()
+/**
+ * Register every shader, texture, palette and level file with the asset watcher, so editing
+ * them reloads just that resource without restarting. Textures are reloaded into their
+ * existing GL objects and shaders into new programs (so they are only ever held by
+ * ResourceId) on the main thread; levels belong to the simulation thread, so the main
+ * thread only flags them for it to reload.
+ *
+ * @return void
+ */
+void WatchAssets()
 {
-	while (glGetError() != GL_NO_ERROR)
+	for (ResourceId id = 0; id < ResourceManager::ShaderSources.size(); ++id)
 	{
+		const ResourceManager::ShaderSource &shader = ResourceManager::ShaderSources[id];
+		std::string name = shader.Name;
+		std::function<void()> reload = [id, name]()
+		{
+			// relinking resets the shader's uniforms, so set them up again
+			if (ResourceManager::ReloadShader(id))
+				Breakout.ConfigureShader(name);
+		};
+		WatchAsset(shader.Vertex, reload);
+		WatchAsset(shader.Fragment, reload);
+		if (!shader.Geometry.empty())
+			WatchAsset(shader.Geometry, reload);
 	}
-}
 
-// Returns true if we have an error
-static bool GLCheckErrorStatus(const char *function, int line)
-{
-	while (GLenum error = glGetError())
+	for (ResourceId id = 0; id < ResourceManager::TextureSources.size(); ++id)
 	{
-		std::cout << "OpenGL Error:" << error
-				  << "\tLine: " << line
-				  << "\tfunction: " << function << std::endl;
-		return true;
+		WatchAsset(ResourceManager::TextureSources[id].File, [id]()
+				   { ResourceManager::ReloadTexture(id); });
 	}
-	return false;
-}
 
-#define GLCheck(x)      \
-	GLClearAllErrors(); \
-	x;                  \
-	GLCheckErrorStatus(#x, __LINE__);
-// ^^^^^^^^^^^^^^^^^^^ Error Handling Routines ^^^^^^^^^^^^^^^
+	WatchAsset(PALETTE_FILE, []()
+			   { Breakout.ReloadPalette(); });
+
+	for (unsigned int level = 0; level < LEVEL_COUNT; ++level)
+	{
+		WatchAsset(LEVEL_FILES[level], [level]()
+				   {
+					   gLevelReloads |= 1u << level;
+					   SDL_SemPost(gInputSignal); });
+	}
+}
 
 /**
  * Initialization of the graphics application. Typically this will involve setting up a window
@@ -114,6 +225,8 @@ static bool GLCheckErrorStatus(const char *function, int line)
  */
 void InitializeProgram()
 {
+	TRACE_ZONE("InitializeProgram");
+
 	// Initialize SDL
 	if (SDL_Init(SDL_INIT_VIDEO) < 0)
 	{
@@ -130,6 +243,9 @@ void InitializeProgram()
 	// We want to request a double buffer for smooth updating.
 	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
 	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+	// A debug context reports errors through a callback (slower, only when asked for)
+	if (gGLDebug)
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
 
 	// Create an application window using OpenGL that supports SDL
 	gGraphicsApplicationWindow = SDL_CreateWindow("Atari 2600 Super Breakout",
@@ -137,7 +253,8 @@ void InitializeProgram()
 												  SDL_WINDOWPOS_UNDEFINED,
 												  gScreenWidth,
 												  gScreenHeight,
-												  SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN);
+												  SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE |
+													  (gFullscreen ? SDL_WINDOW_FULLSCREEN_DESKTOP : 0));
 
 	// Check if Window did not create.
 	if (gGraphicsApplicationWindow == nullptr)
@@ -145,6 +262,7 @@ void InitializeProgram()
 		std::cout << "Window could not be created! SDL Error: " << SDL_GetError() << "\n";
 		exit(1);
 	}
+	SDL_SetWindowMinimumSize(gGraphicsApplicationWindow, gScreenWidth / 4, gScreenHeight / 4);
 
 	// Create an OpenGL Graphics Context
 	gOpenGLContext = SDL_GL_CreateContext(gGraphicsApplicationWindow);
@@ -160,11 +278,43 @@ void InitializeProgram()
 		std::cout << "glad did not initialize" << std::endl;
 		exit(1);
 	}
+	GLExtensions::Load(SDL_GL_GetProcAddress);
+	if (gGLDebug)
+		GLDebug::Enable(gGLDebugSeverity);
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	// Initialize the breakout game
+	// Set up the swap interval for the requested pacing mode (falls back if the driver refuses)
+	PacingMode pacing = gFramePacer.SetMode(gRequestedPacing);
+	if (pacing != gRequestedPacing)
+	{
+		std::cout << "Pacing mode " << FramePacer::ModeName(gRequestedPacing) << " is not supported, using "
+				  << FramePacer::ModeName(pacing) << "\n";
+	}
+
+	// Initialize the breakout game, drawing to as much of the window as it can
 	Breakout.Init();
+	if (gDynamicResolutionMs > 0.0f)
+		Breakout.EnableDynamicResolution(gDynamicResolutionMs);
+	int drawableWidth, drawableHeight;
+	SDL_GL_GetDrawableSize(gGraphicsApplicationWindow, &drawableWidth, &drawableHeight);
+	Breakout.Resize(drawableWidth, drawableHeight);
+
+	// Start the mixer (the game plays on silently without an audio device)
+	if (gVolume > 0.0f)
+		gAudio.Open(gVolume);
+
+	// Set up the signals the simulation and main threads use to wake each other while idle
+	gInputSignal = SDL_CreateSemaphore(0);
+	gSnapshotEvent = SDL_RegisterEvents(1);
+
+	// Reload assets when they are edited
+	WatchAssets();
+
+	// Publish the initial state so there is a snapshot to draw before the first tick
+	Breakout.Snapshot(gSnapshots.WriteBuffer());
+	gSnapshots.Publish();
+	gSnapshots.Update();
 }
 
 /**
@@ -176,27 +326,14 @@ void InitializeProgram()
  */
 void PreDraw()
 {
-	// Set up timestamps for frame advancing
-	float currentFrame = SDL_GetTicks();
-	deltaTime = currentFrame - lastFrame;
-	lastFrame = currentFrame;
-
 	// Disable depth test and face culling.
 	glDisable(GL_DEPTH_TEST);
 	glDisable(GL_CULL_FACE);
 
-	// manage user input
-	// -----------------
-	Breakout.ProcessInput(deltaTime);
-
-	// update game state
-	// -----------------
-	Breakout.Update(deltaTime);
-
 	// Initialize clear color
-	// This is the background of the screen.
-	glViewport(0, 0, gScreenWidth, gScreenHeight);
-	glClearColor(0.5f, 9.f, 1.f, 1.f);
+	// This is the background of the screen, left showing as bars around the game area when the window has
+	// another aspect ratio. (The viewport is set by the game's camera each frame.)
+	glClearColor(0.f, 0.f, 0.f, 1.f);
 
 	// Clear color buffer and Depth Buffer
 	glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
@@ -213,47 +350,294 @@ void PreDraw()
 void Draw()
 {
 	// Render the breakout game every frame
-	Breakout.Render();
+	Breakout.Render(gSnapshots.ReadBuffer());
+}
+
+/**
+ * Handle a single SDL event
+ *
+ * @return true if the event means the window needs to be redrawn
+ */
+bool HandleEvent(const SDL_Event &e)
+{
+	// If users posts an event to quit
+	// An example is hitting the "x" in the corner of the window or pressing the Escape key
+	if (e.type == SDL_QUIT || (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE))
+	{
+		gQuit = true;
+		SDL_SemPost(gInputSignal);
+	}
+	// F3 toggles the memory overlay, which only the render (main) thread looks at
+	else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F3 && !e.key.repeat)
+	{
+		Breakout.ShowMemoryStats = !Breakout.ShowMemoryStats;
+		return true;
+	}
+	// F11 switches between the window and fullscreen (at the desktop's resolution, so no mode change)
+	else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F11 && !e.key.repeat)
+	{
+		gFullscreen = !gFullscreen;
+		SDL_SetWindowFullscreen(gGraphicsApplicationWindow, gFullscreen ? SDL_WINDOW_FULLSCREEN_DESKTOP : 0);
+		return true;
+	}
+	// If it was a non-ESC keypress or a key release, pass it on to the simulation thread
+	// (key repeats are dropped, the game only cares whether a key is held)
+	else if ((e.type == SDL_KEYDOWN && !e.key.repeat) || e.type == SDL_KEYUP)
+	{
+		// If an event happens greater than the valid keypress values, ignore it
+		if (e.key.keysym.sym < 322)
+		{
+			gKeyEvents.Push(KeyEvent{e.key.keysym.sym, e.type == SDL_KEYDOWN});
+			SDL_SemPost(gInputSignal);
+		}
+	}
+	// The window was uncovered or changed, so what is on screen is stale
+	else if (e.type == SDL_WINDOWEVENT)
+	{
+		// Fit the game area to the window again when it changes size
+		if (e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+		{
+			int drawableWidth, drawableHeight;
+			SDL_GL_GetDrawableSize(gGraphicsApplicationWindow, &drawableWidth, &drawableHeight);
+			Breakout.Resize(drawableWidth, drawableHeight);
+		}
+		return e.window.event == SDL_WINDOWEVENT_EXPOSED || e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED ||
+			   e.window.event == SDL_WINDOWEVENT_RESTORED;
+	}
+	return false;
 }
 
 /**
  * Function called in the Main application loop to handle user input
  *
- * @return void
+ * @param wait If true, sleep until an event arrives (or IDLE_TIMEOUT passes) instead of returning straight away
+ * @return true if an event means the window needs to be redrawn
  */
-void Input()
+bool Input(bool wait)
 {
 	// Event handler that handles various events in SDL
 	// that are related to input and output
 	SDL_Event e;
+	bool redraw = false;
+
+	// When idle, block until something happens rather than spinning
+	if (wait && SDL_WaitEventTimeout(&e, IDLE_TIMEOUT) != 0)
+		redraw |= HandleEvent(e);
+
 	// Handle events on queue
 	while (SDL_PollEvent(&e) != 0)
+		redraw |= HandleEvent(e);
+
+	return redraw;
+}
+
+/**
+ * Wake the main thread while it waits on events on an idle screen, after the simulation thread
+ * published a snapshot it should draw
+ *
+ * @return void
+ */
+void WakeMainThread()
+{
+	SDL_Event wake;
+	SDL_zero(wake);
+	wake.type = gSnapshotEvent;
+	SDL_PushEvent(&wake);
+}
+
+/**
+ * Run one step of the game on the simulation thread, recording it first when
+ * recording a replay
+ *
+ * @param frame what the step feeds into the game
+ * @return void
+ */
+void RunStep(const ReplayFrame &frame)
+{
+	TRACE_ZONE("Simulation::Step");
+	if (gRecorder.IsOpen())
+		gRecorder.Record(Breakout, frame);
+	Replay::Apply(Breakout, frame);
+}
+
+/**
+ * Wait For Tick
+ * Waits until the next tick is due
+ *
+ * @return the step the next tick simulates, in milliseconds: the time waited, or with fixed physics exactly one tick
+ * interval, so the game only depends on its input and not on how well the ticks were timed
+ */
+float WaitForTick()
+{
+	double waited = gTickPacer.Wait();
+	return Breakout.Physics == PHYSICS_FIXED ? static_cast<float>(TICK_INTERVAL) : static_cast<float>(waited);
+}
+
+/**
+ * Publish Tick
+ * Hands the state the game is in after a tick to the render thread, and the
+ * sounds it made on the way to the mixer
+ *
+ * @return void
+ */
+void PublishTick()
+{
+	Breakout.Snapshot(gSnapshots.WriteBuffer());
+	gSnapshots.Publish();
+	if (gAudio.IsOpen())
+		gAudio.Post(Breakout.Sounds);
+	Breakout.Sounds = 0;
+}
+
+/**
+ * Simulation Loop
+ * Runs on its own thread, advancing the game at fixed intervals and publishing
+ * a render snapshot after every tick. Never touches OpenGL, so a slow buffer
+ * swap on the main thread can not delay the simulation. On the menu and win
+ * screens nothing moves, so it sleeps until a key event arrives and only
+ * publishes a snapshot once that key has been processed.
+ *
+ * @return void
+ */
+void SimulationLoop()
+{
+	// Everything allocated on this thread belongs to the simulation
+	MemoryScope scope(MEMORY_SIMULATION);
+	Trace::SetThreadName("Simulation");
+
+	// Start timing ticks from now
+	gTickPacer.Start();
+
+	while (!gQuit)
 	{
-		// If users posts an event to quit
-		// An example is hitting the "x" in the corner of the window or pressing the Escape key
-		if (e.type == SDL_QUIT || (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE))
+		// Apply the key events received since the last tick, noting the keys released for a recording
+		KeyEvent event;
+		bool keysChanged = false;
+		unsigned char released = 0;
+		int seek = -1;
+		while (gKeyEvents.Pop(event))
 		{
-			gQuit = true;
+			// a replay ignores the game's keys, [ and ] seek back and forward through it and BACKSPACE to its start
+			if (gReplay != nullptr)
+			{
+				int from = seek >= 0 ? seek : static_cast<int>(gReplay->Step());
+				if (event.Pressed && event.Key == SDLK_LEFTBRACKET)
+					seek = std::max(from - REPLAY_SEEK_MS / TICK_INTERVAL, 0);
+				else if (event.Pressed && event.Key == SDLK_RIGHTBRACKET)
+					seek = from + REPLAY_SEEK_MS / TICK_INTERVAL;
+				else if (event.Pressed && event.Key == SDLK_BACKSPACE)
+					seek = 0;
+				continue;
+			}
+
+			Breakout.SetKey(event.Key, event.Pressed);
+			if (!event.Pressed)
+				released |= Replay::KeyBit(event.Key);
+			keysChanged = true;
 		}
-		// If it was a non-ESC keypress, note that that key is being pressed
-		else if (e.type == SDL_KEYDOWN)
+
+		// In a versus game the rollback session simulates every frame at a fixed step, so both sides agree
+		// on the outcome, and nothing else may change the game (so edited levels are not reloaded)
+		if (gNetplay != nullptr)
 		{
-			// If an event happens greater than the valid keypress values, ignore it
-			if (e.key.keysym.sym < 322)
+			GameState previous = Breakout.State;
+			unsigned char input = Breakout.SampleInput();
+			if (gAutopilot != nullptr)
+			{
+				unsigned char inputs[2];
+				gAutopilot->Think(Breakout, inputs);
+				input = inputs[gNetplay->Player()];
+			}
 			{
-				Breakout.Keys[e.key.keysym.sym] = true;
+				TRACE_ZONE("RollbackSession::Tick");
+				gNetplay->Tick(input);
 			}
+			PublishTick();
+
+			// wake the main thread if it is waiting on an idle screen that the peer just left
+			if (Breakout.State != previous)
+				WakeMainThread();
+			gTickPacer.Wait();
+			continue;
 		}
-		// When a key is released, remove note of it from keys being pressed array
-		else if (e.type == SDL_KEYUP)
+
+		// A replay steps through the recording, jumping when asked to
+		if (gReplay != nullptr)
 		{
-			// If an event happens greater than the valid keypress values, ignore it
-			if (e.key.keysym.sym < 322)
+			GameState previous = Breakout.State;
+			if (seek >= 0)
 			{
-				Breakout.Keys[e.key.keysym.sym] = false;
-				Breakout.KeysProcessed[e.key.keysym.sym] = false;
+				TRACE_ZONE("ReplayPlayer::Seek");
+				gReplay->Seek(Breakout, static_cast<unsigned int>(seek));
 			}
+			else
+				gReplay->Advance(Breakout);
+			PublishTick();
+
+			// the main thread waits on events while idle, so wake it for every change it should draw
+			if (Breakout.State != previous || Game::IsIdle(Breakout.State))
+				WakeMainThread();
+			gTickPacer.Wait();
+			continue;
 		}
+
+		// Reload any level files that were edited
+		unsigned int reloads = gLevelReloads.exchange(0);
+		for (unsigned int level = 0; level < LEVEL_COUNT; ++level)
+		{
+			if (reloads & (1u << level))
+				Breakout.ReloadLevel(level);
+		}
+
+		// In attract mode the autopilot plays every level in turn, starting the next one whenever a game ends
+		if (gAutopilot != nullptr)
+		{
+			if (Game::IsIdle(Breakout.State))
+			{
+				RunStep(ReplayFrame{REPLAY_START_NEXT, 0, 0, {0, 0}, 0.0f});
+				WakeMainThread();
+			}
+			ReplayFrame frame{REPLAY_VERSUS, 0, 0, {0, 0}, deltaTime};
+			gAutopilot->Think(Breakout, frame.Inputs);
+			RunStep(frame);
+			PublishTick();
+			deltaTime = WaitForTick();
+			continue;
+		}
+
+		// While idle, only input (or a reload) can change anything, so there is nothing to simulate
+		if (Game::IsIdle(Breakout.State))
+		{
+			if (!keysChanged && reloads == 0)
+			{
+				SDL_SemWaitTimeout(gInputSignal, IDLE_TIMEOUT);
+				continue;
+			}
+
+			RunStep(ReplayFrame{REPLAY_KEYS_IDLE, Replay::HeldKeys(Breakout), released, {0, 0}, 0.0f});
+			PublishTick();
+
+			// wake the main thread, which is waiting on events while idle
+			WakeMainThread();
+
+			// if that input started the game, begin ticking from now rather than from before the idle wait
+			if (!Game::IsIdle(Breakout.State))
+			{
+				gTickPacer.Start();
+				deltaTime = 0.0f;
+			}
+			continue;
+		}
+
+		// manage user input and update game state
+		// ---------------------------------------
+		RunStep(ReplayFrame{REPLAY_KEYS, Replay::HeldKeys(Breakout), released, {0, 0}, deltaTime});
+
+		// hand the new state to the render thread
+		PublishTick();
+
+		// Wait until the next tick is due, the next tick's step
+		deltaTime = WaitForTick();
 	}
 }
 
@@ -266,15 +650,40 @@ void Input()
 void MainLoop()
 {
 
-	// Determine the initial next time to advance a frame
-	// Used to make the framerate fixed intervals
-	next_time = SDL_GetTicks() + TICK_INTERVAL;
+	// Start simulating the game on its own thread
+	gSimulationThread = std::thread(SimulationLoop);
+
+	// Start timing frames from now
+	gFramePacer.Start();
 
 	// While application is running
 	while (!gQuit)
 	{
-		// Handle Input
-		Input();
+		// When the last snapshot was an idle screen, nothing changes until input does
+		bool idle = Game::IsIdle(gSnapshots.ReadBuffer().State);
+
+		// Handle Input (forwarded to the simulation thread)
+		bool redraw;
+		{
+			TRACE_ZONE("MainLoop::Input");
+			redraw = Input(idle);
+		}
+
+		// Reload any shaders or textures that were edited
+		if (gAssetWatcher.Poll() > 0)
+			redraw = true;
+
+		// Log the memory counters when a soak sample is due
+		gSoakLog.Poll();
+
+		// Pick up the latest snapshot published by the simulation thread (if there is a newer one)
+		bool fresh = gSnapshots.Update();
+
+		// While idle, only redraw when the picture would actually change (or to refresh the memory overlay)
+		if (idle && !fresh && !redraw && !Breakout.ShowMemoryStats)
+			continue;
+
+		TRACE_ZONE("MainLoop::Frame");
 
 		// Setup anything (i.e. OpenGL State) that needs to take
 		// place before draw calls
@@ -287,16 +696,105 @@ void MainLoop()
 		//      currently binded.
 		Draw();
 
+		// Print what the driver reported since the last frame
+		GLDebug::Report(std::cout);
+
 		// Update screen of our specified window
-		SDL_GL_SwapWindow(gGraphicsApplicationWindow);
+		{
+			TRACE_ZONE("SDL_GL_SwapWindow");
+			SDL_GL_SwapWindow(gGraphicsApplicationWindow);
+		}
 
-		// Delay for the amount of time left until a frame should be advanced
-		// Used to make the framerate fixed intervals
-		SDL_Delay(time_left());
+		// Wait for the next frame (in vsync modes the swap above already waited, this only measures).
+		// Idle frames are not paced, restart timing instead so the wait is not counted as a late frame
+		if (idle)
+			gFramePacer.Start();
+		else
+		{
+			TRACE_ZONE("FramePacer::Wait");
+			gFramePacer.Wait();
+		}
+	}
+
+	// Wait for the simulation thread to notice gQuit and finish its last tick
+	SDL_SemPost(gInputSignal);
+	gSimulationThread.join();
+}
+
+/**
+ * Steps a batch of headless games with random inputs, and reports how fast
+ * they went. Needs no window, GL context or simulation thread.
+ *
+ * @param games   how many games are stepped side by side
+ * @param steps   how many steps each game takes
+ * @param threads threads stepping the games (0 for one per core)
+ * @param level   the level every game plays (1 to 4)
+ * @return program status
+ */
+int RunBatchBenchmark(unsigned int games, unsigned int steps, unsigned int threads, unsigned int level)
+{
+	GameBatch batch(games, level > 0 ? level - 1 : 0, threads, static_cast<float>(TICK_INTERVAL));
+	std::vector<float> observations(games * GameBatch::OBSERVATION_SIZE);
+	std::vector<float> rewards(games);
+	std::vector<unsigned char> dones(games);
+	std::vector<unsigned char> actions(games * 2);
+	std::mt19937 random(1);
 
-		// Set the next time a frame should be advanced to be the tick interval (15 ticks)
-		next_time += TICK_INTERVAL;
+	// the inputs change every few steps, rather than jittering every step
+	batch.Reset(observations.data());
+	double reward = 0.0;
+	unsigned long long ended = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int step = 0; step < steps; ++step)
+	{
+		if (step % 8 == 0)
+		{
+			for (unsigned char &action : actions)
+				action = static_cast<unsigned char>(random() % 3 + 1) | INPUT_LAUNCH;
+		}
+		batch.Step(actions.data(), observations.data(), rewards.data(), dones.data());
+		for (unsigned int i = 0; i < games; ++i)
+		{
+			reward += rewards[i];
+			ended += dones[i];
+		}
 	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::cout << "Stepped " << games << " games " << steps << " times on " << batch.Threads() << " threads in "
+			  << seconds * 1000.0 << " ms: " << games * static_cast<double>(steps) / seconds << " steps/s, total reward "
+			  << reward << ", " << ended << " games ended\n";
+	return 0;
+}
+
+/**
+ * Bakes every PNG texture compiled into the executable into a texture container
+ * next to its file, so later runs map it instead of decoding the PNG. Needs no
+ * window or GL context.
+ *
+ * @param mipmaps whether the containers also hold a full chain of mipmaps
+ * @return program status
+ */
+int RunTextureBake(bool mipmaps)
+{
+	int failures = 0;
+	for (unsigned int i = 0; i < EMBEDDED_FILE_COUNT; ++i)
+	{
+		std::string path = EMBEDDED_FILES[i].Path;
+		if (path.compare(0, 9, "textures/") != 0 || path.size() < 4 || path.compare(path.size() - 4, 4, ".png") != 0)
+			continue;
+
+		// bake the file on disk when there is one, it may have been edited since the executable was built
+		std::ifstream file(path, std::ios::binary);
+		std::string bytes = file ? std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>())
+								 : std::string(reinterpret_cast<const char *>(EMBEDDED_FILES[i].Data), EMBEDDED_FILES[i].Size);
+		std::string baked = TextureContainer::PathFor(path);
+		if (TextureContainer::Bake(bytes, baked, mipmaps))
+			std::cout << "Baked " << path << " into " << baked << "\n";
+		else
+			++failures;
+	}
+	return failures > 0 ? 1 : 0;
 }
 
 /**
@@ -308,8 +806,70 @@ void MainLoop()
  */
 void CleanUp()
 {
+	// Report how well frames and ticks kept to their targets
+	const PacingStats &frames = gFramePacer.GetStats();
+	const PacingStats &ticks = gTickPacer.GetStats();
+	std::cout << "Frame pacing (" << FramePacer::ModeName(gFramePacer.GetMode()) << "): average error "
+			  << frames.AverageError << " ms, max " << frames.MaxError << " ms over " << frames.Frames << " frames\n";
+	std::cout << "Tick pacing: average error " << ticks.AverageError << " ms, max " << ticks.MaxError
+			  << " ms over " << ticks.Frames << " ticks\n";
+
+	// Report how much a versus game had to roll back
+	if (gNetplay != nullptr)
+	{
+		const RollbackStats &rollback = gNetplay->GetStats();
+		std::cout << "Rollback: " << rollback.Rollbacks << " rollbacks resimulated " << rollback.Resimulated << " of "
+				  << rollback.Frames << " frames (at most " << rollback.MaxRollback << " frames in " << rollback.MaxRollbackMs
+				  << " ms), stalled " << rollback.Stalls << " ticks" << (rollback.Desynced ? ", DESYNCED" : "")
+				  << (rollback.PhysicsMismatch ? ", PHYSICS MISMATCH" : "") << "\n";
+		delete gNetplay;
+		gNetplay = nullptr;
+	}
+
+	// Report how often the autopilot could reuse its predictions
+	if (gAutopilot != nullptr)
+	{
+		std::cout << "Autopilot: traced " << gAutopilot->Traced() << " ball paths, reused " << gAutopilot->Reused() << "\n";
+		delete gAutopilot;
+		gAutopilot = nullptr;
+	}
+
+	// Finish the replay being recorded, writing its index
+	if (gRecorder.IsOpen())
+	{
+		std::cout << "Replay: recorded " << gRecorder.Steps() << " steps\n";
+		gRecorder.Close();
+	}
+	delete gReplay;
+	gReplay = nullptr;
+
+	// Report where dynamic resolution settled
+	if (const DynamicResolution *resolution = Breakout.GetDynamicResolution())
+	{
+		std::cout << "Dynamic resolution: scale " << resolution->GetScale() << " at " << resolution->GetFrameMs()
+				  << " ms of GPU time per frame\n";
+	}
+
+	// Report how many sounds were played, and whether the mixer kept up
+	if (gAudio.IsOpen())
+	{
+		std::cout << "Audio (" << SDL_GetCurrentAudioDriver() << ", " << gAudio.GetRate() << " Hz): played " << gAudio.GetPlayed()
+				  << " sounds, dropped " << gAudio.GetDropped() << ", cut short " << gAudio.GetStolen() << "\n";
+		gAudio.Close();
+	}
+
+	// Write out the timeline of every zone recorded
+	if (!gTraceFile.empty())
+		Trace::Write(gTraceFile);
+
+	// Report what is still held, and how it grew over a soak run
+	std::cout << MemoryStats::Report(MemoryStats::Sample()) << "\n";
+	gSoakLog.Close();
+
 	// Destroy our SDL2 Window
 	ResourceManager::Clear();
+	GLDebug::Report(std::cout);
+	SDL_DestroySemaphore(gInputSignal);
 	SDL_DestroyWindow(gGraphicsApplicationWindow);
 	gGraphicsApplicationWindow = nullptr;
 
@@ -324,10 +884,203 @@ void CleanUp()
  */
 int main(int argc, char *args[])
 {
+	// 0. Read command line options
+	bool offscreen = false;
+	RenderCheckOptions renderCheck = RenderCheck::DefaultOptions();
+	int netPlayer = 0, netLevel = 2, netDelay = 0;
+	unsigned short netLocalPort = 0, netPeerPort = 0;
+	std::string netPeerHost;
+	unsigned int batchBench[4] = {0, 1000, 0, 1};
+	std::string recordFile, replayFile;
+	unsigned int recordInterval = 600, replayStep = 0;
+	bool bakeTextures = false, bakeMipmaps = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string option = args[i];
+
+		// --offscreen [golden directory]: render test scenes without a window and check them against goldens
+		if (option == "--offscreen")
+		{
+			offscreen = true;
+			if (i + 1 < argc && args[i + 1][0] != '-')
+				renderCheck.GoldenDirectory = args[++i];
+		}
+		// --update-goldens: with --offscreen, write the rendered scenes as the new goldens
+		else if (option == "--update-goldens")
+			renderCheck.UpdateGoldens = true;
+		// --tolerance N: with --offscreen, the largest per-channel difference that still matches
+		else if (option == "--tolerance" && i + 1 < argc)
+			renderCheck.Tolerance = std::atoi(args[++i]);
+		// --bench-frames N: with --offscreen, how many frames each scene is rendered (and timed) for
+		else if (option == "--bench-frames" && i + 1 < argc)
+			renderCheck.BenchmarkFrames = std::atoi(args[++i]);
+		// --soak-log FILE [SECONDS]: append a sample of the memory counters to FILE every SECONDS (default 10)
+		else if (option == "--soak-log" && i + 1 < argc)
+		{
+			std::string file = args[++i];
+			double interval = 10.0;
+			if (i + 1 < argc && args[i + 1][0] != '-')
+				interval = std::atof(args[++i]);
+			gSoakLog.Open(file, interval);
+		}
+		// --netplay 1|2 LOCAL_PORT HOST:PORT [LEVEL]: play versus against another instance as player 1 (bottom paddle)
+		// or 2, on Super Breakout level 2, 3 or 4 (default 2)
+		else if (option == "--netplay" && i + 3 < argc)
+		{
+			netPlayer = std::atoi(args[++i]);
+			netLocalPort = static_cast<unsigned short>(std::atoi(args[++i]));
+			std::string peer = args[++i];
+			std::string::size_type colon = peer.find_last_of(':');
+			netPeerHost = peer.substr(0, colon);
+			netPeerPort = colon != std::string::npos ? static_cast<unsigned short>(std::atoi(peer.c_str() + colon + 1)) : 0;
+			if (i + 1 < argc && args[i + 1][0] != '-')
+				netLevel = std::atoi(args[++i]);
+		}
+		// --net-delay FRAMES: with --netplay, how many frames local input is delayed (fewer rollbacks, more lag)
+		else if (option == "--net-delay" && i + 1 < argc)
+		{
+			netDelay = std::atoi(args[++i]);
+			if (netDelay < 0 || netDelay > static_cast<int>(RollbackSession::MAX_INPUT_DELAY))
+			{
+				netDelay = std::max(0, std::min(netDelay, static_cast<int>(RollbackSession::MAX_INPUT_DELAY)));
+				std::cout << "Net delay " << args[i] << " is out of range, using " << netDelay << " frames\n";
+			}
+		}
+		// --net-latency MS, --net-jitter MS, --net-loss PERCENT: with --netplay, simulate a bad connection
+		else if (option == "--net-latency" && i + 1 < argc)
+			gNetConditions.LatencyMs = std::atoi(args[++i]);
+		else if (option == "--net-jitter" && i + 1 < argc)
+			gNetConditions.JitterMs = std::atoi(args[++i]);
+		else if (option == "--net-loss" && i + 1 < argc)
+			gNetConditions.LossPercent = std::atoi(args[++i]);
+		// --batch-bench GAMES [STEPS] [THREADS] [LEVEL]: step many headless games at once and report the rate
+		else if (option == "--batch-bench" && i + 1 < argc)
+		{
+			batchBench[0] = static_cast<unsigned int>(std::atoi(args[++i]));
+			for (unsigned int value = 1; value < 4 && i + 1 < argc && args[i + 1][0] != '-'; ++value)
+				batchBench[value] = static_cast<unsigned int>(std::atoi(args[++i]));
+		}
+		// --record FILE [INTERVAL]: record every step to a replay file, with a keyframe every INTERVAL steps
+		else if (option == "--record" && i + 1 < argc)
+		{
+			recordFile = args[++i];
+			if (i + 1 < argc && args[i + 1][0] != '-')
+				recordInterval = static_cast<unsigned int>(std::atoi(args[++i]));
+		}
+		// --replay FILE [STEP]: play a replay file back from a step, seeking with [ and ]
+		else if (option == "--replay" && i + 1 < argc)
+		{
+			replayFile = args[++i];
+			if (i + 1 < argc && args[i + 1][0] != '-')
+				replayStep = static_cast<unsigned int>(std::atoi(args[++i]));
+		}
+		// --trace FILE: record timed zones on every thread and write them to a Chrome trace JSON file on exit
+		else if (option == "--trace" && i + 1 < argc)
+			gTraceFile = args[++i];
+		// --gl-debug [SEVERITY]: have a debug context report GL messages of at least high, medium (the default), low
+		// or notification severity
+		else if (option == "--gl-debug")
+		{
+			gGLDebug = true;
+			if (i + 1 < argc && args[i + 1][0] != '-' && !GLDebug::ParseSeverity(args[++i], gGLDebugSeverity))
+				std::cout << "Unknown debug severity " << args[i] << ", expected high, medium, low or notification\n";
+		}
+		// --bake-textures [mipmaps]: write a pre-decoded texture container next to every texture file and exit
+		else if (option == "--bake-textures")
+		{
+			bakeTextures = true;
+			if (i + 1 < argc && std::string(args[i + 1]) == "mipmaps")
+			{
+				bakeMipmaps = true;
+				++i;
+			}
+		}
+		// --fullscreen: start fullscreen (F11 toggles)
+		else if (option == "--fullscreen")
+			gFullscreen = true;
+		// --dynamic-resolution [MS]: render at a lower resolution when needed to hold frames to MS of GPU time
+		// (default 12)
+		else if (option == "--dynamic-resolution")
+		{
+			gDynamicResolutionMs = 12.0f;
+			if (i + 1 < argc && args[i + 1][0] != '-')
+				gDynamicResolutionMs = static_cast<float>(std::atof(args[++i]));
+		}
+		// --volume PERCENT: play sounds at PERCENT of full volume (default 100), 0 opens no audio device
+		else if (option == "--volume" && i + 1 < argc)
+			gVolume = static_cast<float>(std::atof(args[++i])) / 100.0f;
+		// --fixed-physics: move and collide in fixed point at a fixed step, bit-identical on every machine
+		else if (option == "--fixed-physics")
+			Breakout.Physics = PHYSICS_FIXED;
+		// --autopilot: let the computer play (in a versus game, in place of the local player)
+		else if (option == "--autopilot")
+			gAutopilot = new Autopilot();
+		// --pacing vsync|adaptive|capped|uncapped
+		else if (option == "--pacing" && i + 1 < argc)
+		{
+			if (!FramePacer::ParseMode(args[++i], gRequestedPacing))
+				std::cout << "Unknown pacing mode " << args[i] << ", expected vsync, adaptive, capped or uncapped\n";
+		}
+	}
+
+	// Time everything from startup on
+	if (!gTraceFile.empty())
+	{
+		Trace::Start();
+		Trace::SetThreadName("Main");
+	}
+
+	// Baking textures is all this run does
+	if (bakeTextures)
+		return RunTextureBake(bakeMipmaps);
+
+	// Headless render checks need no window, input or simulation thread, and nor do batches of games
+	// stepped for benchmarking
+	if (offscreen || batchBench[0] > 0)
+	{
+		renderCheck.DebugOutput = gGLDebug;
+		renderCheck.DebugMinimum = gGLDebugSeverity;
+		int status = offscreen ? RenderCheck::Run(Breakout, gScreenWidth, gScreenHeight, renderCheck)
+							   : RunBatchBenchmark(batchBench[0], batchBench[1], batchBench[2], batchBench[3]);
+		if (!gTraceFile.empty())
+			Trace::Write(gTraceFile);
+		return status;
+	}
 
 	// 1. Setup the graphics program
 	InitializeProgram();
 
+	// Connect to the peer and start the versus game, which both sides begin from the same state
+	if (netPlayer != 0)
+	{
+		if (netPlayer != 1 && netPlayer != 2)
+			std::cout << "Unknown netplay player " << netPlayer << ", expected 1 or 2\n";
+		else if (gNetSocket.Open(netLocalPort, netPeerHost, netPeerPort))
+		{
+			gNetSocket.SetConditions(gNetConditions);
+			Breakout.StartVersus(static_cast<unsigned int>(netLevel - 1));
+			gNetplay = new RollbackSession(Breakout, gNetSocket, netPlayer - 1, static_cast<float>(TICK_INTERVAL), netDelay);
+		}
+	}
+
+	// Start playing back or recording a replay, neither of which can follow a versus game's rollbacks
+	if (!replayFile.empty() && gNetplay == nullptr)
+	{
+		gReplay = new ReplayPlayer();
+		if (!gReplay->Open(replayFile) || !gReplay->Seek(Breakout, replayStep))
+		{
+			delete gReplay;
+			gReplay = nullptr;
+		}
+	}
+	if (!recordFile.empty())
+	{
+		if (gReplay != nullptr || gNetplay != nullptr)
+			std::cout << "Replays can not be recorded while playing one back or in a versus game\n";
+		else
+			gRecorder.Open(recordFile, Breakout, recordInterval);
+	}
+
 	// 2. Call the main application loop
 	MainLoop();
 
@@ -0,0 +1,331 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+#include "memory_stats.hpp"
+
+// the counters, zero initialized before any dynamic initialization (and so before the first operator new)
+static std::atomic<long long> glObjects[GL_OBJECT_TYPE_COUNT];
+static std::atomic<long long> textureBytes(0);
+static std::atomic<long long> bufferBytes(0);
+static std::atomic<long long> hostBytes[MEMORY_SUBSYSTEM_COUNT];
+static std::atomic<long long> hostAllocations[MEMORY_SUBSYSTEM_COUNT];
+
+// the subsystem allocations on this thread are charged to
+static thread_local MemorySubsystem currentSubsystem = MEMORY_OTHER;
+
+// when the counters started, for sample times
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+void MemoryStats::Created(GLObjectType type, int count)
+{
+    glObjects[type].fetch_add(count, std::memory_order_relaxed);
+}
+
+void MemoryStats::Deleted(GLObjectType type, int count)
+{
+    glObjects[type].fetch_sub(count, std::memory_order_relaxed);
+}
+
+void MemoryStats::AddTextureBytes(long long delta)
+{
+    textureBytes.fetch_add(delta, std::memory_order_relaxed);
+}
+
+void MemoryStats::AddBufferBytes(long long delta)
+{
+    bufferBytes.fetch_add(delta, std::memory_order_relaxed);
+}
+
+// read every counter
+MemorySample MemoryStats::Sample()
+{
+    MemorySample sample;
+    sample.Time = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    for (int type = 0; type < GL_OBJECT_TYPE_COUNT; ++type)
+        sample.GLObjects[type] = glObjects[type].load(std::memory_order_relaxed);
+    sample.TextureBytes = textureBytes.load(std::memory_order_relaxed);
+    sample.BufferBytes = bufferBytes.load(std::memory_order_relaxed);
+    for (int subsystem = 0; subsystem < MEMORY_SUBSYSTEM_COUNT; ++subsystem)
+    {
+        sample.HostBytes[subsystem] = hostBytes[subsystem].load(std::memory_order_relaxed);
+        sample.HostAllocations[subsystem] = hostAllocations[subsystem].load(std::memory_order_relaxed);
+    }
+    return sample;
+}
+
+// format a byte count with a readable unit
+static std::string formatBytes(long long bytes)
+{
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(1);
+    if (bytes >= 1024 * 1024 || bytes <= -1024 * 1024)
+        text << bytes / (1024.0 * 1024.0) << " MB";
+    else if (bytes >= 1024 || bytes <= -1024)
+        text << bytes / 1024.0 << " KB";
+    else
+        text << bytes << " B";
+    return text.str();
+}
+
+// summarize a sample
+std::string MemoryStats::Report(const MemorySample &sample)
+{
+    std::ostringstream text;
+    text << "GL objects:";
+    for (int type = 0; type < GL_OBJECT_TYPE_COUNT; ++type)
+        text << (type == 0 ? " " : ", ") << TypeName(static_cast<GLObjectType>(type)) << " " << sample.GLObjects[type];
+    text << "\nGL memory: textures " << formatBytes(sample.TextureBytes) << ", buffers " << formatBytes(sample.BufferBytes);
+    for (int subsystem = 0; subsystem < MEMORY_SUBSYSTEM_COUNT; ++subsystem)
+    {
+        text << "\nHost " << SubsystemName(static_cast<MemorySubsystem>(subsystem)) << ": "
+             << formatBytes(sample.HostBytes[subsystem]) << " in " << sample.HostAllocations[subsystem] << " allocations";
+    }
+    return text.str();
+}
+
+const char *MemoryStats::TypeName(GLObjectType type)
+{
+    static const char *const names[GL_OBJECT_TYPE_COUNT] = {"textures", "buffers", "vertex arrays", "programs", "framebuffers", "renderbuffers", "syncs"};
+    return names[type];
+}
+
+const char *MemoryStats::SubsystemName(MemorySubsystem subsystem)
+{
+    static const char *const names[MEMORY_SUBSYSTEM_COUNT] = {"other", "resources", "levels", "text", "render", "simulation"};
+    return names[subsystem];
+}
+
+MemorySubsystem MemoryStats::CurrentSubsystem()
+{
+    return currentSubsystem;
+}
+
+void MemoryStats::HostAllocated(MemorySubsystem subsystem, std::size_t bytes)
+{
+    hostBytes[subsystem].fetch_add(static_cast<long long>(bytes), std::memory_order_relaxed);
+    hostAllocations[subsystem].fetch_add(1, std::memory_order_relaxed);
+}
+
+void MemoryStats::HostFreed(MemorySubsystem subsystem, std::size_t bytes)
+{
+    hostBytes[subsystem].fetch_sub(static_cast<long long>(bytes), std::memory_order_relaxed);
+    hostAllocations[subsystem].fetch_sub(1, std::memory_order_relaxed);
+}
+
+// charge this thread's allocations to a subsystem
+MemoryScope::MemoryScope(MemorySubsystem subsystem)
+    : previous(currentSubsystem)
+{
+    currentSubsystem = subsystem;
+}
+
+MemoryScope::~MemoryScope()
+{
+    currentSubsystem = this->previous;
+}
+
+// constructor
+SoakLog::SoakLog()
+    : interval(0.0), nextSample(0.0), first()
+{
+}
+
+// start logging
+bool SoakLog::Open(const std::string &file, double interval)
+{
+    this->out.open(file);
+    if (!this->out)
+    {
+        std::cout << "ERROR::SOAK_LOG: Could not open " << file << std::endl;
+        return false;
+    }
+
+    this->out << "time";
+    for (int type = 0; type < GL_OBJECT_TYPE_COUNT; ++type)
+        this->out << ",gl " << MemoryStats::TypeName(static_cast<GLObjectType>(type));
+    this->out << ",texture bytes,buffer bytes";
+    for (int subsystem = 0; subsystem < MEMORY_SUBSYSTEM_COUNT; ++subsystem)
+    {
+        const char *name = MemoryStats::SubsystemName(static_cast<MemorySubsystem>(subsystem));
+        this->out << ",host " << name << " bytes,host " << name << " allocations";
+    }
+    this->out << "\n";
+
+    this->interval = interval;
+    this->first = MemoryStats::Sample();
+    this->write(this->first);
+    this->nextSample = this->first.Time + interval;
+    return true;
+}
+
+// write a sample when one is due
+void SoakLog::Poll()
+{
+    if (!this->out.is_open())
+        return;
+    MemorySample sample = MemoryStats::Sample();
+    if (sample.Time < this->nextSample)
+        return;
+    this->write(sample);
+    this->nextSample = sample.Time + this->interval;
+}
+
+// finish the log and report growth over the run
+void SoakLog::Close()
+{
+    if (!this->out.is_open())
+        return;
+    MemorySample last = MemoryStats::Sample();
+    this->write(last);
+    this->out.close();
+
+    // any counter that ended higher than it started is a candidate leak
+    std::cout << "Soak run of " << last.Time - this->first.Time << " s, growth:";
+    bool grew = false;
+    for (int type = 0; type < GL_OBJECT_TYPE_COUNT; ++type)
+    {
+        long long growth = last.GLObjects[type] - this->first.GLObjects[type];
+        if (growth != 0)
+        {
+            std::cout << " " << MemoryStats::TypeName(static_cast<GLObjectType>(type)) << " " << std::showpos << growth << std::noshowpos;
+            grew = true;
+        }
+    }
+    if (last.TextureBytes != this->first.TextureBytes)
+    {
+        std::cout << " texture bytes " << formatBytes(last.TextureBytes - this->first.TextureBytes);
+        grew = true;
+    }
+    if (last.BufferBytes != this->first.BufferBytes)
+    {
+        std::cout << " buffer bytes " << formatBytes(last.BufferBytes - this->first.BufferBytes);
+        grew = true;
+    }
+    for (int subsystem = 0; subsystem < MEMORY_SUBSYSTEM_COUNT; ++subsystem)
+    {
+        long long growth = last.HostBytes[subsystem] - this->first.HostBytes[subsystem];
+        if (growth != 0)
+        {
+            std::cout << " host " << MemoryStats::SubsystemName(static_cast<MemorySubsystem>(subsystem)) << " " << formatBytes(growth);
+            grew = true;
+        }
+    }
+    std::cout << (grew ? "" : " none") << "\n";
+}
+
+bool SoakLog::IsOpen() const
+{
+    return this->out.is_open();
+}
+
+// write one CSV row
+void SoakLog::write(const MemorySample &sample)
+{
+    this->out << sample.Time;
+    for (int type = 0; type < GL_OBJECT_TYPE_COUNT; ++type)
+        this->out << "," << sample.GLObjects[type];
+    this->out << "," << sample.TextureBytes << "," << sample.BufferBytes;
+    for (int subsystem = 0; subsystem < MEMORY_SUBSYSTEM_COUNT; ++subsystem)
+        this->out << "," << sample.HostBytes[subsystem] << "," << sample.HostAllocations[subsystem];
+    this->out << "\n";
+    this->out.flush();
+}
+
+// ---- Global allocation functions ----
+// Every allocation carries a small header recording its size and the subsystem it was charged to,
+// so freeing it credits the right counter. The header keeps the default new alignment.
+
+struct AllocationHeader
+{
+    std::size_t Size;
+    MemorySubsystem Subsystem;
+};
+
+static const std::size_t HEADER_SIZE = (sizeof(AllocationHeader) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+static void *trackedAllocate(std::size_t size)
+{
+    void *block = std::malloc(HEADER_SIZE + (size ? size : 1));
+    if (!block)
+        return nullptr;
+    AllocationHeader *header = static_cast<AllocationHeader *>(block);
+    header->Size = size;
+    header->Subsystem = currentSubsystem;
+    MemoryStats::HostAllocated(header->Subsystem, size);
+    return static_cast<unsigned char *>(block) + HEADER_SIZE;
+}
+
+static void trackedFree(void *pointer)
+{
+    if (!pointer)
+        return;
+    AllocationHeader *header = reinterpret_cast<AllocationHeader *>(static_cast<unsigned char *>(pointer) - HEADER_SIZE);
+    MemoryStats::HostFreed(header->Subsystem, header->Size);
+    std::free(header);
+}
+
+void *operator new(std::size_t size)
+{
+    void *pointer = trackedAllocate(size);
+    if (!pointer)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return trackedAllocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return trackedAllocate(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    trackedFree(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    trackedFree(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+    trackedFree(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept
+{
+    trackedFree(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept
+{
+    trackedFree(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept
+{
+    trackedFree(pointer);
+}
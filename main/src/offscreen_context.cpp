@@ -0,0 +1,166 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <iostream>
+#include <cstring>
+
+#include <glad/glad.h>
+
+#include "offscreen_context.hpp"
+#include "gl_extensions.hpp"
+#include "memory_stats.hpp"
+
+#ifdef LINUX
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+// constructor
+OffscreenContext::OffscreenContext()
+    : width(0), height(0), display(nullptr), context(nullptr), framebuffer(0), colorBuffer(0)
+{
+}
+
+// destructor
+OffscreenContext::~OffscreenContext()
+{
+#ifdef LINUX
+    if (this->context != nullptr)
+    {
+        if (this->framebuffer != 0)
+        {
+            glDeleteFramebuffers(1, &this->framebuffer);
+            MemoryStats::Deleted(GL_OBJECT_FRAMEBUFFER);
+        }
+        if (this->colorBuffer != 0)
+        {
+            glDeleteRenderbuffers(1, &this->colorBuffer);
+            MemoryStats::Deleted(GL_OBJECT_RENDERBUFFER);
+            MemoryStats::AddTextureBytes(-4ll * this->width * this->height);
+        }
+        eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(this->display, this->context);
+    }
+    if (this->display != nullptr)
+        eglTerminate(this->display);
+#endif
+}
+
+// creates the context, makes it current, loads GL and binds a framebuffer to draw into
+bool OffscreenContext::Create(unsigned int width, unsigned int height, bool debug)
+{
+#ifdef LINUX
+    this->width = width;
+    this->height = height;
+
+    // prefer Mesa's surfaceless platform, which needs neither a GPU nor a display server
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay != nullptr)
+        this->display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (this->display == EGL_NO_DISPLAY)
+        this->display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if (this->display == EGL_NO_DISPLAY || !eglInitialize(this->display, &major, &minor))
+    {
+        std::cout << "ERROR::OFFSCREEN: Could not initialize an EGL display" << std::endl;
+        this->display = nullptr;
+        return false;
+    }
+    const char *extensions = eglQueryString(this->display, EGL_EXTENSIONS);
+    if (extensions == nullptr || std::strstr(extensions, "EGL_KHR_surfaceless_context") == nullptr)
+    {
+        std::cout << "ERROR::OFFSCREEN: EGL display does not support surfaceless contexts" << std::endl;
+        return false;
+    }
+
+    // ask for the same OpenGL 4.1 core context the windowed game uses
+    // (there is no window, and surfaceless displays only offer pbuffer configs)
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_NONE};
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(this->display, configAttributes, &config, 1, &configCount) || configCount == 0)
+    {
+        std::cout << "ERROR::OFFSCREEN: No EGL config supports desktop OpenGL" << std::endl;
+        return false;
+    }
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 1,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_CONTEXT_OPENGL_DEBUG, debug ? EGL_TRUE : EGL_FALSE,
+        EGL_NONE};
+    this->context = eglCreateContext(this->display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (this->context == EGL_NO_CONTEXT || !eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE, this->context))
+    {
+        std::cout << "ERROR::OFFSCREEN: Could not create an OpenGL 4.1 core context" << std::endl;
+        this->context = nullptr;
+        return false;
+    }
+
+    // Initialize GLAD Library
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress)))
+    {
+        std::cout << "glad did not initialize" << std::endl;
+        return false;
+    }
+    GLExtensions::Load(reinterpret_cast<GLADloadproc>(eglGetProcAddress));
+
+    // there is no default framebuffer without a surface, so render into our own
+    glGenRenderbuffers(1, &this->colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, this->colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    MemoryStats::Created(GL_OBJECT_RENDERBUFFER);
+    MemoryStats::AddTextureBytes(4ll * width * height);
+    glGenFramebuffers(1, &this->framebuffer);
+    MemoryStats::Created(GL_OBJECT_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->colorBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::OFFSCREEN: Framebuffer is not complete" << std::endl;
+        return false;
+    }
+    glViewport(0, 0, width, height);
+    return true;
+#else
+    std::cout << "ERROR::OFFSCREEN: Offscreen rendering is only available on Linux" << std::endl;
+    return false;
+#endif
+}
+
+// reads the framebuffer back as tightly packed RGBA rows, top row first
+void OffscreenContext::ReadPixels(std::vector<unsigned char> &pixels)
+{
+    unsigned int stride = this->width * 4;
+    pixels.resize(stride * this->height);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, this->width, this->height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+    // GL reads bottom row first, images are stored top row first
+    std::vector<unsigned char> row(stride);
+    for (unsigned int y = 0; y < this->height / 2; ++y)
+    {
+        unsigned char *top = &pixels[y * stride];
+        unsigned char *bottom = &pixels[(this->height - 1 - y) * stride];
+        std::memcpy(row.data(), top, stride);
+        std::memcpy(top, bottom, stride);
+        std::memcpy(bottom, row.data(), stride);
+    }
+}
+
+// the renderer string of the context
+const char *OffscreenContext::Renderer() const
+{
+    return reinterpret_cast<const char *>(glGetString(GL_RENDERER));
+}
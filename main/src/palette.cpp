@@ -0,0 +1,81 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <iostream>
+#include <cmath>
+#include <string>
+
+#include "palette.hpp"
+#include "memory_stats.hpp"
+#include "embedded_assets.hpp"
+#include "stb_image.h"
+
+// constructor, every color starts out white until a palette is loaded
+Palette::Palette()
+    : UBO(0)
+{
+    for (unsigned int i = 0; i < SIZE; ++i)
+        this->Colors[i] = glm::vec4(1.0f);
+}
+
+// destructor
+Palette::~Palette()
+{
+    if (this->UBO != 0)
+    {
+        glDeleteBuffers(1, &this->UBO);
+        MemoryStats::Deleted(GL_OBJECT_BUFFER);
+        MemoryStats::AddBufferBytes(-static_cast<long long>(sizeof(this->Colors)));
+    }
+}
+
+// read the colors from a palette strip image
+bool Palette::Load(const char *file)
+{
+    int width, height, nrChannels;
+    std::string contents;
+    unsigned char *data = nullptr;
+    if (EmbeddedAssets::Read(file, contents))
+        data = stbi_load_from_memory(reinterpret_cast<const stbi_uc *>(contents.data()), static_cast<int>(contents.size()),
+                                     &width, &height, &nrChannels, 3);
+    if (!data)
+    {
+        std::cout << "ERROR::PALETTE: Failed to read palette file " << file << std::endl;
+        return false;
+    }
+
+    // look each color up at the same spot in the strip that the sprite shader used to sample it
+    // from: u = i / 10 - 0.01 (wrapping around for index 0), halfway down
+    for (unsigned int i = 0; i < SIZE; ++i)
+    {
+        float u = i / 10.0f - 0.01f;
+        u -= std::floor(u);
+        int x = static_cast<int>(u * width);
+        const unsigned char *texel = data + 3 * ((height / 2) * width + x);
+        this->Colors[i] = glm::vec4(texel[0] / 255.0f, texel[1] / 255.0f, texel[2] / 255.0f, 1.0f);
+    }
+
+    stbi_image_free(data);
+    return true;
+}
+
+// upload the colors and bind the buffer to the palette binding point
+void Palette::Upload()
+{
+    if (this->UBO == 0)
+    {
+        glGenBuffers(1, &this->UBO);
+        MemoryStats::Created(GL_OBJECT_BUFFER);
+        MemoryStats::AddBufferBytes(sizeof(this->Colors));
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, this->UBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(this->Colors), this->Colors, GL_STATIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, this->UBO);
+}
@@ -0,0 +1,161 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <chrono>
+#include <iostream>
+
+#include "render_check.hpp"
+#include "offscreen_context.hpp"
+#include "golden_image.hpp"
+#include "resource_manager.hpp"
+#include "memory_stats.hpp"
+
+// A game state to render and check
+struct Scene
+{
+    const char *Name;
+    unsigned int Level;
+    GameState State;
+    bool BreakBricks; // destroy every third breakable brick, to cover partially cleared levels
+};
+
+// the scenes checked, in order
+static const Scene SCENES[] = {
+    {"menu_level1", 0, GAME_MENU, false},
+    {"menu_level2", 1, GAME_MENU, false},
+    {"menu_level3", 2, GAME_MENU, false},
+    {"menu_level4", 3, GAME_MENU, false},
+    {"active_level2", 1, GAME_ACTIVE, true},
+    {"win", 0, GAME_WIN, false}};
+
+// default options: goldens/ directory, small tolerance for rasterizer differences
+RenderCheckOptions RenderCheck::DefaultOptions()
+{
+    return RenderCheckOptions{"goldens", false, 8, 0.001, 100, false, DEBUG_SEVERITY_MEDIUM};
+}
+
+// true if GL objects (other than the fences that come and go every frame) or GL memory differ between two samples
+static bool resourcesGrew(const MemorySample &before, const MemorySample &after)
+{
+    for (int type = 0; type < GL_OBJECT_TYPE_COUNT; ++type)
+    {
+        if (type != GL_OBJECT_SYNC && after.GLObjects[type] != before.GLObjects[type])
+            return true;
+    }
+    return after.TextureBytes != before.TextureBytes || after.BufferBytes != before.BufferBytes;
+}
+
+// creates an offscreen context, initializes the game and checks every scene
+int RenderCheck::Run(Game &game, unsigned int width, unsigned int height, const RenderCheckOptions &options)
+{
+    OffscreenContext offscreen;
+    if (!offscreen.Create(width, height, options.DebugOutput))
+        return 2;
+    std::cout << "Rendering offscreen with " << offscreen.Renderer() << std::endl;
+    if (options.DebugOutput)
+        GLDebug::Enable(options.DebugMinimum);
+
+    // same GL state the windowed game sets up
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    game.Init();
+
+    int failures = 0;
+    RenderSnapshot snapshot;
+    Image actual = {width, height, {}};
+    for (const Scene &scene : SCENES)
+    {
+        // put the game into the scene's state
+        game.Level = scene.Level;
+        game.ReloadLevel(scene.Level);
+        game.ResetPlayer();
+        game.State = scene.State;
+        if (scene.BreakBricks)
+        {
+            GameLevel &level = game.Levels[scene.Level];
+            for (unsigned int i = 0; i < level.Bricks.size(); i += 3)
+                level.DestroyBrick(i);
+        }
+        game.Snapshot(snapshot);
+
+        // render it repeatedly, timing each frame through to completion (and checking that, after
+        // the first frame, rendering the same picture again creates no new GL resources)
+        double totalMs = 0.0, worstMs = 0.0;
+        MemorySample firstFrame = {};
+        for (unsigned int frame = 0; frame < options.BenchmarkFrames || frame == 0; ++frame)
+        {
+            if (frame == 1)
+                firstFrame = MemoryStats::Sample();
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            glViewport(0, 0, width, height);
+            glClearColor(0.5f, 9.f, 1.f, 1.f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            game.Render(snapshot);
+            glFinish();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            totalMs += ms;
+            if (ms > worstMs)
+                worstMs = ms;
+        }
+        unsigned int frames = options.BenchmarkFrames > 0 ? options.BenchmarkFrames : 1;
+        offscreen.ReadPixels(actual.Pixels);
+        GLDebug::Report(std::cout);
+        if (frames > 1 && resourcesGrew(firstFrame, MemoryStats::Sample()))
+            std::cout << scene.Name << ": WARNING: GL resources grew while rendering the same frame" << std::endl;
+
+        std::string golden = options.GoldenDirectory + "/" + scene.Name + ".png";
+        std::cout << scene.Name << ": " << totalMs / frames << " ms/frame (worst " << worstMs << " ms)";
+
+        if (options.UpdateGoldens)
+        {
+            bool saved = GoldenImage::Save(golden, actual);
+            std::cout << (saved ? ", golden updated" : ", ERROR: could not write golden") << std::endl;
+            failures += saved ? 0 : 1;
+            continue;
+        }
+
+        Image expected;
+        if (!GoldenImage::Load(golden, expected))
+        {
+            std::cout << ", FAILED: no golden at " << golden << " (run with --update-goldens to create it)" << std::endl;
+            ++failures;
+            continue;
+        }
+
+        Image diff;
+        ImageDiff result = GoldenImage::Compare(expected, actual, options.Tolerance, &diff);
+        if (result.SameSize && result.DifferingFraction <= options.MaxDifferingFraction)
+        {
+            std::cout << ", matches golden (max channel error " << result.MaxChannelError << ")" << std::endl;
+            continue;
+        }
+
+        // keep what was rendered and where it differs, for whoever has to look at the failure
+        ++failures;
+        if (!result.SameSize)
+            std::cout << ", FAILED: golden is " << expected.Width << "x" << expected.Height << std::endl;
+        else
+            std::cout << ", FAILED: " << result.DifferingPixels << " pixels differ (max channel error "
+                      << result.MaxChannelError << ")" << std::endl;
+        GoldenImage::Save(options.GoldenDirectory + "/" + scene.Name + ".actual.png", actual);
+        if (result.SameSize)
+            GoldenImage::Save(options.GoldenDirectory + "/" + scene.Name + ".diff.png", diff);
+    }
+
+    // put the game back the way Init left it
+    game.Level = 0;
+    game.State = GAME_MENU;
+    game.ResetLevel();
+    game.ResetPlayer();
+    std::cout << MemoryStats::Report(MemoryStats::Sample()) << std::endl;
+    ResourceManager::Clear();
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,369 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <iterator>
+
+#include <SDL2/SDL.h>
+
+#include "replay.hpp"
+#include "game_snapshot.hpp"
+
+// Marks a replay file (and its layout version) and its footer
+const unsigned char REPLAY_MAGIC[4] = {'B', 'R', 'P', 'L'};
+const unsigned char REPLAY_FOOTER_MAGIC[4] = {'B', 'R', 'P', 'X'};
+const unsigned int REPLAY_VERSION = 2;
+// the last version without the physics in its header (always PHYSICS_FLOAT), still played
+const unsigned int REPLAY_VERSION_FLOAT = 1;
+
+// Sizes of the fixed parts of a replay file
+const unsigned int REPLAY_HEADER_SIZE = 4 + 4 + 4 + 4;
+const unsigned int REPLAY_KEYFRAME_SIZE = 4 + 1 + 1 + 2;
+const unsigned int REPLAY_STEP_SIZE = 5 + 4;
+const unsigned int REPLAY_INDEX_ENTRY_SIZE = 4 + 4;
+const unsigned int REPLAY_FOOTER_SIZE = 4 * 3 + 4;
+
+// the keys recorded: W and S pick the level, A and D move, SPACE launches and ENTER starts
+const int Replay::KEYS[6] = {SDLK_a, SDLK_d, SDLK_w, SDLK_s, SDLK_SPACE, SDLK_RETURN};
+
+// writes a little endian integer
+static unsigned char *writeInt(unsigned char *out, unsigned int value, unsigned int bytes)
+{
+    for (unsigned int i = 0; i < bytes; ++i)
+        *out++ = static_cast<unsigned char>(value >> (8 * i));
+    return out;
+}
+
+// reads a little endian integer
+static unsigned int readInt(const unsigned char *in, unsigned int bytes)
+{
+    unsigned int value = 0;
+    for (unsigned int i = 0; i < bytes; ++i)
+        value |= static_cast<unsigned int>(in[i]) << (8 * i);
+    return value;
+}
+
+// the bit of a key in ReplayFrame::Keys
+unsigned char Replay::KeyBit(int key)
+{
+    for (unsigned int i = 0; i < KEY_COUNT; ++i)
+    {
+        if (KEYS[i] == key)
+            return static_cast<unsigned char>(1 << i);
+    }
+    return 0;
+}
+
+// the bits of the recorded keys currently held in a game
+unsigned char Replay::HeldKeys(const Game &game)
+{
+    unsigned char keys = 0;
+    for (unsigned int i = 0; i < KEY_COUNT; ++i)
+        keys |= static_cast<unsigned char>(game.Keys[KEYS[i]]) << i;
+    return keys;
+}
+
+// the bits of the recorded keys already processed in a game
+unsigned char Replay::ProcessedKeys(const Game &game)
+{
+    unsigned char keys = 0;
+    for (unsigned int i = 0; i < KEY_COUNT; ++i)
+        keys |= static_cast<unsigned char>(game.KeysProcessed[KEYS[i]]) << i;
+    return keys;
+}
+
+// runs one step on a game
+void Replay::Apply(Game &game, const ReplayFrame &frame)
+{
+    if (frame.Kind == REPLAY_START_NEXT)
+    {
+        game.StartLevel(game.Level + 1);
+        return;
+    }
+    if (frame.Kind == REPLAY_VERSUS)
+    {
+        game.ProcessVersusInput(frame.Dt, frame.Inputs);
+        game.Update(frame.Dt);
+        return;
+    }
+
+    // bring the keys up to date (when playing live, SetKey has done this already as the key events arrived)
+    for (unsigned int i = 0; i < KEY_COUNT; ++i)
+    {
+        bool held = (frame.Keys >> i & 1) != 0;
+        if (frame.Released >> i & 1)
+            game.SetKey(KEYS[i], false);
+        if (game.Keys[KEYS[i]] != held)
+            game.SetKey(KEYS[i], held);
+    }
+
+    game.ProcessInput(frame.Dt);
+    if (frame.Kind == REPLAY_KEYS)
+        game.Update(frame.Dt);
+}
+
+// constructor
+ReplayRecorder::ReplayRecorder()
+    : file(), interval(600), steps(0), offsets(), offset(0), snapshot()
+{
+}
+
+// destructor
+ReplayRecorder::~ReplayRecorder()
+{
+    this->Close();
+}
+
+// starts recording to a file
+bool ReplayRecorder::Open(const std::string &path, const Game &game, unsigned int interval)
+{
+    this->Close();
+    this->file.open(path, std::ios::binary | std::ios::trunc);
+    if (!this->file.is_open())
+    {
+        std::cout << "ERROR::REPLAY: Could not open " << path << " for recording" << std::endl;
+        return false;
+    }
+    this->interval = interval > 0 ? interval : 1;
+    this->steps = 0;
+    this->offsets.clear();
+    this->offset = 0;
+
+    unsigned char header[REPLAY_HEADER_SIZE];
+    std::memcpy(header, REPLAY_MAGIC, 4);
+    writeInt(header + 4, REPLAY_VERSION, 4);
+    writeInt(header + 8, this->interval, 4);
+    writeInt(header + 12, game.Physics, 4);
+    this->Write(header, sizeof(header));
+
+    // the first chunk starts now, so even a recording closed before its first step can be played
+    this->Keyframe(game);
+    return true;
+}
+
+// records a step, before it is applied to the game
+void ReplayRecorder::Record(const Game &game, const ReplayFrame &frame)
+{
+    if (!this->file.is_open())
+        return;
+
+    // every other chunk starts with the state before its first step
+    if (this->steps % this->interval == 0 && this->steps > 0)
+        this->Keyframe(game);
+
+    unsigned char step[REPLAY_STEP_SIZE];
+    step[0] = static_cast<unsigned char>(frame.Kind);
+    step[1] = frame.Keys;
+    step[2] = frame.Released;
+    step[3] = frame.Inputs[0];
+    step[4] = frame.Inputs[1];
+    unsigned int dt;
+    std::memcpy(&dt, &frame.Dt, sizeof(dt));
+    writeInt(step + 5, dt, 4);
+    this->Write(step, sizeof(step));
+    ++this->steps;
+}
+
+// writes the index and closes the file
+void ReplayRecorder::Close()
+{
+    if (!this->file.is_open())
+        return;
+
+    unsigned int index = this->offset;
+    for (unsigned int chunk = 0; chunk < this->offsets.size(); ++chunk)
+    {
+        unsigned char entry[REPLAY_INDEX_ENTRY_SIZE];
+        writeInt(entry, chunk * this->interval, 4);
+        writeInt(entry + 4, this->offsets[chunk], 4);
+        this->Write(entry, sizeof(entry));
+    }
+
+    unsigned char footer[REPLAY_FOOTER_SIZE];
+    writeInt(footer, this->steps, 4);
+    writeInt(footer + 4, static_cast<unsigned int>(this->offsets.size()), 4);
+    writeInt(footer + 8, index, 4);
+    std::memcpy(footer + 12, REPLAY_FOOTER_MAGIC, 4);
+    this->Write(footer, sizeof(footer));
+    this->file.close();
+}
+
+// starts a chunk with the game's state
+void ReplayRecorder::Keyframe(const Game &game)
+{
+    unsigned int bricks = static_cast<unsigned int>(game.Levels[game.Level].Bricks.size());
+    if (this->snapshot.size() < GameSnapshot::MaxSize(bricks))
+        this->snapshot.resize(GameSnapshot::MaxSize(bricks));
+    unsigned int size = GameSnapshot::Save(game, this->snapshot.data(), static_cast<unsigned int>(this->snapshot.size()), true);
+
+    unsigned char keyframe[REPLAY_KEYFRAME_SIZE];
+    writeInt(keyframe, this->steps, 4);
+    keyframe[4] = Replay::HeldKeys(game);
+    keyframe[5] = Replay::ProcessedKeys(game);
+    writeInt(keyframe + 6, size, 2);
+    this->offsets.push_back(this->offset);
+    this->Write(keyframe, sizeof(keyframe));
+    this->Write(this->snapshot.data(), size);
+}
+
+// writes bytes, keeping track of the offset
+void ReplayRecorder::Write(const unsigned char *data, unsigned int size)
+{
+    this->file.write(reinterpret_cast<const char *>(data), size);
+    this->offset += size;
+}
+
+// constructor
+ReplayPlayer::ReplayPlayer()
+    : data(), interval(1), physics(PHYSICS_FLOAT), steps(0), offsets(), stepOffsets(), step(0), positioned(false)
+{
+}
+
+// reads a replay file
+bool ReplayPlayer::Open(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cout << "ERROR::REPLAY: Could not open " << path << std::endl;
+        return false;
+    }
+    this->data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    const unsigned char *bytes = this->data.data();
+    unsigned int size = static_cast<unsigned int>(this->data.size());
+
+    unsigned int version = size >= REPLAY_HEADER_SIZE ? readInt(bytes + 4, 4) : 0;
+    if (size < REPLAY_HEADER_SIZE + REPLAY_FOOTER_SIZE || std::memcmp(bytes, REPLAY_MAGIC, 4) != 0 ||
+        (version != REPLAY_VERSION && version != REPLAY_VERSION_FLOAT) || (version == REPLAY_VERSION && readInt(bytes + 12, 4) > PHYSICS_FIXED))
+    {
+        std::cout << "ERROR::REPLAY: " << path << " is not a replay this version can play" << std::endl;
+        return false;
+    }
+    const unsigned char *footer = bytes + size - REPLAY_FOOTER_SIZE;
+    if (std::memcmp(footer + 12, REPLAY_FOOTER_MAGIC, 4) != 0)
+    {
+        std::cout << "ERROR::REPLAY: " << path << " is incomplete (the recording was not closed)" << std::endl;
+        return false;
+    }
+
+    this->interval = readInt(bytes + 8, 4);
+    this->physics = version == REPLAY_VERSION ? static_cast<GamePhysics>(readInt(bytes + 12, 4)) : PHYSICS_FLOAT;
+    this->steps = readInt(footer, 4);
+    unsigned int chunks = readInt(footer + 4, 4), index = readInt(footer + 8, 4);
+    // (a recording with no steps still has its first chunk's keyframe)
+    if (this->interval == 0 || chunks != std::max((this->steps + this->interval - 1) / this->interval, 1u) ||
+        index > size - REPLAY_FOOTER_SIZE || (size - REPLAY_FOOTER_SIZE - index) / REPLAY_INDEX_ENTRY_SIZE != chunks)
+    {
+        std::cout << "ERROR::REPLAY: " << path << " has a broken index" << std::endl;
+        return false;
+    }
+
+    // find where every chunk and its steps start
+    this->offsets.resize(chunks);
+    this->stepOffsets.resize(chunks);
+    for (unsigned int chunk = 0; chunk < chunks; ++chunk)
+    {
+        unsigned int offset = readInt(bytes + index + chunk * REPLAY_INDEX_ENTRY_SIZE + 4, 4);
+        unsigned int count = chunk + 1 < chunks ? this->interval : this->steps - chunk * this->interval;
+        unsigned int stepOffset = offset + REPLAY_KEYFRAME_SIZE;
+        if (offset + REPLAY_KEYFRAME_SIZE <= index)
+            stepOffset += readInt(bytes + offset + 6, 2);
+        if (offset + REPLAY_KEYFRAME_SIZE > index || stepOffset + count * REPLAY_STEP_SIZE > index)
+        {
+            std::cout << "ERROR::REPLAY: " << path << " has a broken index" << std::endl;
+            return false;
+        }
+        this->offsets[chunk] = offset;
+        this->stepOffsets[chunk] = stepOffset;
+    }
+    this->step = 0;
+    this->positioned = false;
+    return true;
+}
+
+// puts a game into its state before a step
+bool ReplayPlayer::Seek(Game &game, unsigned int step)
+{
+    if (this->offsets.empty())
+        return false;
+    if (step > this->steps)
+        step = this->steps;
+
+    // carry on from the current step when no keyframe is closer
+    unsigned int chunk = step / this->interval;
+    if (chunk >= this->offsets.size())
+        chunk = static_cast<unsigned int>(this->offsets.size()) - 1;
+    if (!this->positioned || this->step > step || this->step < chunk * this->interval)
+    {
+        this->positioned = false;
+        if (!this->Restore(game, chunk))
+            return false;
+        this->step = chunk * this->interval;
+        this->positioned = true;
+    }
+
+    while (this->step < step)
+        this->Advance(game);
+
+    // a seek jumps to the step, the steps skipped over make no sound
+    game.Sounds = 0;
+    return true;
+}
+
+// applies the next step to a game
+bool ReplayPlayer::Advance(Game &game)
+{
+    if (!this->positioned || this->step >= this->steps)
+        return false;
+    Replay::Apply(game, this->Frame(this->step));
+    ++this->step;
+    return true;
+}
+
+// reads a recorded step
+ReplayFrame ReplayPlayer::Frame(unsigned int step) const
+{
+    const unsigned char *in = this->data.data() + this->stepOffsets[step / this->interval] + (step % this->interval) * REPLAY_STEP_SIZE;
+    ReplayFrame frame;
+    frame.Kind = static_cast<ReplayKind>(in[0]);
+    frame.Keys = in[1];
+    frame.Released = in[2];
+    frame.Inputs[0] = in[3];
+    frame.Inputs[1] = in[4];
+    unsigned int dt = readInt(in + 5, 4);
+    std::memcpy(&frame.Dt, &dt, sizeof(dt));
+    return frame;
+}
+
+// restores a chunk's keyframe
+bool ReplayPlayer::Restore(Game &game, unsigned int chunk)
+{
+    const unsigned char *keyframe = this->data.data() + this->offsets[chunk];
+    game.Physics = this->physics;
+    if (!GameSnapshot::Load(game, keyframe + REPLAY_KEYFRAME_SIZE, readInt(keyframe + 6, 2)))
+        return false;
+
+    // the other levels are untouched while one is played (it is reset before another can be picked)
+    for (unsigned int level = 0; level < game.Levels.size(); ++level)
+    {
+        if (level == game.Level)
+            continue;
+        for (unsigned int brick = 0; brick < game.Levels[level].Bricks.size(); ++brick)
+            game.Levels[level].SetBrickAlive(brick, true);
+        game.Levels[level].Events.clear();
+    }
+
+    for (unsigned int i = 0; i < Replay::KEY_COUNT; ++i)
+    {
+        game.Keys[Replay::KEYS[i]] = (keyframe[4] >> i & 1) != 0;
+        game.KeysProcessed[Replay::KEYS[i]] = (keyframe[5] >> i & 1) != 0;
+    }
+    return true;
+}
@@ -7,107 +7,222 @@
 ** option) any later version.
 ******************************************************************/
 #include <iostream>
-#include <sstream>
-#include <fstream>
 
 #include "resource_manager.hpp"
+#include "memory_stats.hpp"
+#include "trace.hpp"
+#include "gl_debug.hpp"
+#include "embedded_assets.hpp"
+#include "texture_container.hpp"
 #include "stb_image.h"
 
 // Instantiate static variables
-std::map<std::string, Texture2D> ResourceManager::Textures;
-std::map<std::string, Shader> ResourceManager::Shaders;
+std::vector<Texture2D> ResourceManager::Textures;
+std::vector<Shader> ResourceManager::Shaders;
+std::vector<ResourceManager::ShaderSource> ResourceManager::ShaderSources;
+std::vector<ResourceManager::TextureSource> ResourceManager::TextureSources;
+std::unordered_map<std::string, ResourceId> ResourceManager::shaderNames;
+std::unordered_map<std::string, ResourceId> ResourceManager::textureNames;
+std::unordered_map<std::string, ResourceId> ResourceManager::shaderPaths;
+std::unordered_map<std::string, ResourceId> ResourceManager::texturePaths;
+std::unordered_map<unsigned long long, ResourceId> ResourceManager::shaderHashes;
+std::unordered_map<unsigned long long, ResourceId> ResourceManager::textureHashes;
+
+// 64 bit FNV-1a hash of some bytes, continuing from a previous hash
+static unsigned long long hashBytes(const std::string &bytes, unsigned long long hash = 14695981039346656037ull)
+{
+    for (unsigned char byte : bytes)
+    {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
 
 // loads (and generates) a shader program from file loading vertex, fragment (and geometry) shader's source code. If gShaderFile is not nullptr, it also loads a geometry shader
-Shader ResourceManager::LoadShader(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, std::string name)
+ResourceId ResourceManager::LoadShader(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile, std::string name)
 {
-    Shaders[name] = loadShaderFromFile(vShaderFile, fShaderFile, gShaderFile);
-    return Shaders[name];
+    TRACE_ZONE("ResourceManager::LoadShader");
+    GL_DEBUG_SCOPE("ResourceManager::LoadShader");
+    MemoryScope scope(MEMORY_RESOURCES);
+
+    // the same files are already loaded
+    std::string path = std::string(vShaderFile) + "\n" + fShaderFile + "\n" + (gShaderFile != nullptr ? gShaderFile : "");
+    std::unordered_map<std::string, ResourceId>::const_iterator loaded = shaderPaths.find(path);
+    if (loaded != shaderPaths.end())
+        return shaderNames[name] = loaded->second;
+
+    // or the same source is, from other files
+    std::string vertexCode, fragmentCode, geometryCode;
+    readShaderFiles(vShaderFile, fShaderFile, gShaderFile, vertexCode, fragmentCode, geometryCode);
+    unsigned long long hash = hashBytes(geometryCode, hashBytes(fragmentCode + '\0', hashBytes(vertexCode + '\0')));
+    std::unordered_map<unsigned long long, ResourceId>::const_iterator same = shaderHashes.find(hash);
+    if (same != shaderHashes.end())
+        return shaderNames[name] = shaderPaths[path] = same->second;
+
+    // compile it into a new slot
+    Shader shader;
+    shader.Compile(vertexCode.c_str(), fragmentCode.c_str(), gShaderFile != nullptr ? geometryCode.c_str() : nullptr);
+    ResourceId id = static_cast<ResourceId>(Shaders.size());
+    Shaders.push_back(shader);
+    GLDebug::Label(GL_PROGRAM, shader.ID, name);
+    ShaderSources.push_back(ShaderSource{vShaderFile, fShaderFile, gShaderFile != nullptr ? gShaderFile : "", name, hash});
+    shaderNames[name] = shaderPaths[path] = shaderHashes[hash] = id;
+    return id;
 }
 
 // retrieves a stored shader
-Shader ResourceManager::GetShader(std::string name)
+Shader ResourceManager::GetShader(ResourceId id)
+{
+    return id < Shaders.size() ? Shaders[id] : Shader();
+}
+
+Shader ResourceManager::GetShader(const std::string &name)
+{
+    return GetShader(ShaderId(name));
+}
+
+// the ID of a loaded shader
+ResourceId ResourceManager::ShaderId(const std::string &name)
 {
-    return Shaders[name];
+    std::unordered_map<std::string, ResourceId>::const_iterator found = shaderNames.find(name);
+    return found != shaderNames.end() ? found->second : INVALID_ID;
 }
 
 // loads (and generates) a texture from file
-Texture2D ResourceManager::LoadTexture(const char *file, bool alpha, std::string name)
+ResourceId ResourceManager::LoadTexture(const char *file, bool alpha, std::string name)
 {
-    Textures[name] = loadTextureFromFile(file, alpha);
-    return Textures[name];
+    TRACE_ZONE("ResourceManager::LoadTexture");
+    GL_DEBUG_SCOPE("ResourceManager::LoadTexture");
+    MemoryScope scope(MEMORY_RESOURCES);
+
+    // the same file is already loaded
+    std::string path = std::string(file) + (alpha ? "\nalpha" : "");
+    std::unordered_map<std::string, ResourceId>::const_iterator loaded = texturePaths.find(path);
+    if (loaded != texturePaths.end())
+        return textureNames[name] = loaded->second;
+
+    // or the same image is, from another file
+    std::string contents;
+    bool read = EmbeddedAssets::Read(file, contents);
+    if (!read)
+        std::cout << "ERROR::TEXTURE: Failed to read " << file << std::endl;
+    unsigned long long hash = hashBytes(contents, alpha ? 1 : 0);
+    std::unordered_map<unsigned long long, ResourceId>::const_iterator same = textureHashes.find(hash);
+    if (read && same != textureHashes.end())
+        return textureNames[name] = texturePaths[path] = same->second;
+
+    // upload it pre-decoded, or else decode and upload it, into a new slot (a file that could not be read still gets
+    // one, so it can be reloaded once it is fixed)
+    ResourceId id = static_cast<ResourceId>(Textures.size());
+    Texture2D texture;
+    if (!read || !loadBakedTexture(file, contents, alpha, texture))
+        texture = loadTextureFromMemory(contents, alpha);
+    Textures.push_back(std::move(texture));
+    GLDebug::Label(GL_TEXTURE, Textures.back().ID, name);
+    TextureSources.push_back(TextureSource{file, alpha, name, hash});
+    textureNames[name] = texturePaths[path] = id;
+    if (read)
+        textureHashes[hash] = id;
+    return id;
 }
 
 // retrieves a stored texture
-Texture2D ResourceManager::GetTexture(std::string name)
+TextureHandle ResourceManager::GetTexture(ResourceId id)
 {
-    return Textures[name];
+    return id < Textures.size() ? Textures[id].Handle() : TextureHandle{0};
 }
 
-// properly de-allocates all loaded resources
-void ResourceManager::Clear()
+TextureHandle ResourceManager::GetTexture(const std::string &name)
 {
-    // (properly) delete all shaders
-    for (auto iter : Shaders)
-        glDeleteProgram(iter.second.ID);
-    // (properly) delete all textures
-    for (auto iter : Textures)
-        glDeleteTextures(1, &iter.second.ID);
+    return GetTexture(TextureId(name));
+}
+
+// the ID of a loaded texture
+ResourceId ResourceManager::TextureId(const std::string &name)
+{
+    std::unordered_map<std::string, ResourceId>::const_iterator found = textureNames.find(name);
+    return found != textureNames.end() ? found->second : INVALID_ID;
+}
+
+// reloads a stored shader from its files into a new program, replacing the stored one
+bool ResourceManager::ReloadShader(ResourceId id)
+{
+    MemoryScope scope(MEMORY_RESOURCES);
+    if (id >= Shaders.size())
+        return false;
+
+    const ShaderSource &source = ShaderSources[id];
+    const char *gShaderFile = source.Geometry.empty() ? nullptr : source.Geometry.c_str();
+    std::string vertexCode, fragmentCode, geometryCode;
+    readShaderFiles(source.Vertex.c_str(), source.Fragment.c_str(), gShaderFile, vertexCode, fragmentCode, geometryCode);
+    return Shaders[id].Relink(vertexCode.c_str(), fragmentCode.c_str(), gShaderFile != nullptr ? geometryCode.c_str() : nullptr);
 }
 
-// loads and generates a shader from file
-Shader ResourceManager::loadShaderFromFile(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile)
+// reloads a stored texture from its file into the same texture ID
+bool ResourceManager::ReloadTexture(ResourceId id)
 {
+    MemoryScope scope(MEMORY_RESOURCES);
+    if (id >= Textures.size())
+        return false;
 
-    // 1. retrieve the vertex/fragment source code from filePath
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::string geometryCode;
-    try
+    // load image
+    const TextureSource &source = TextureSources[id];
+    int width, height, nrChannels;
+    unsigned char *data = stbi_load(source.File.c_str(), &width, &height, &nrChannels, source.Alpha ? 4 : 3);
+    if (data == nullptr)
     {
-        // open files
-        std::ifstream vertexShaderFile(vShaderFile);
-        std::ifstream fragmentShaderFile(fShaderFile);
-        std::stringstream vShaderStream, fShaderStream;
-
-        // read file's buffer contents into streams
-        vShaderStream << vertexShaderFile.rdbuf();
-        fShaderStream << fragmentShaderFile.rdbuf();
-
-        // close file handlers
-        vertexShaderFile.close();
-        fragmentShaderFile.close();
-
-        // convert stream into string
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
-
-        // if geometry shader path is present, also load a geometry shader
-        if (gShaderFile != nullptr)
-        {
-            std::ifstream geometryShaderFile(gShaderFile);
-            std::stringstream gShaderStream;
-            gShaderStream << geometryShaderFile.rdbuf();
-            geometryShaderFile.close();
-            geometryCode = gShaderStream.str();
-        }
+        std::cout << "ERROR::TEXTURE: Failed to reload " << source.File << std::endl;
+        return false;
     }
-    catch (std::exception e)
+
+    // re-specify the existing texture object, every handle to it sees the new image
+    Textures[id].Generate(width, height, data);
+    stbi_image_free(data);
+    return true;
+}
+
+// properly de-allocates all loaded resources
+void ResourceManager::Clear()
+{
+    // (properly) delete all shaders
+    for (const Shader &shader : Shaders)
     {
-        std::cout << "ERROR::SHADER: Failed to read shader files" << std::endl;
+        glDeleteProgram(shader.ID);
+        MemoryStats::Deleted(GL_OBJECT_PROGRAM);
     }
-    const char *vShaderCode = vertexCode.c_str();
-    const char *fShaderCode = fragmentCode.c_str();
-    const char *gShaderCode = geometryCode.c_str();
+    // (properly) delete all textures, each one deletes itself
+    Textures.clear();
 
-    // 2. now create shader object from source code
-    Shader shader;
-    shader.Compile(vShaderCode, fShaderCode, gShaderFile != nullptr ? gShaderCode : nullptr);
+    // and forget every name, so clearing twice does not delete anything twice
+    Shaders.clear();
+    ShaderSources.clear();
+    TextureSources.clear();
+    shaderNames.clear();
+    textureNames.clear();
+    shaderPaths.clear();
+    texturePaths.clear();
+    shaderHashes.clear();
+    textureHashes.clear();
+}
+
+// reads the source code of a shader's stages, from their embedded copies if there are any
+void ResourceManager::readShaderFiles(const char *vShaderFile, const char *fShaderFile, const char *gShaderFile,
+                                      std::string &vertexCode, std::string &fragmentCode, std::string &geometryCode)
+{
+    bool read = EmbeddedAssets::Read(vShaderFile, vertexCode);
+    read = EmbeddedAssets::Read(fShaderFile, fragmentCode) && read;
+
+    // if geometry shader path is present, also load a geometry shader
+    if (gShaderFile != nullptr)
+        read = EmbeddedAssets::Read(gShaderFile, geometryCode) && read;
 
-    return shader;
+    if (!read)
+        std::cout << "ERROR::SHADER: Failed to read shader files" << std::endl;
 }
 
-// loads a single texture from file
-Texture2D ResourceManager::loadTextureFromFile(const char *file, bool alpha)
+// decodes an image held in memory into a texture
+Texture2D ResourceManager::loadTextureFromMemory(const std::string &contents, bool alpha)
 {
     // create texture object
     Texture2D texture;
@@ -117,9 +232,10 @@ Texture2D ResourceManager::loadTextureFromFile(const char *file, bool alpha)
         texture.Image_Format = GL_RGBA;
     }
 
-    // load image
-    int width, height, nrChannels;
-    unsigned char *data = stbi_load(file, &width, &height, &nrChannels, 0);
+    // load image, converted to the channels the format expects whatever the file has
+    int width = 0, height = 0, nrChannels = 0;
+    unsigned char *data = stbi_load_from_memory(reinterpret_cast<const stbi_uc *>(contents.data()), static_cast<int>(contents.size()),
+                                                &width, &height, &nrChannels, alpha ? 4 : 3);
 
     // now generate texture
     texture.Generate(width, height, data);
@@ -127,4 +243,20 @@ Texture2D ResourceManager::loadTextureFromFile(const char *file, bool alpha)
     // and finally free image data
     stbi_image_free(data);
     return texture;
-}
\ No newline at end of file
+}
+
+// uploads the container baked from a texture's file
+bool ResourceManager::loadBakedTexture(const std::string &file, const std::string &contents, bool alpha, Texture2D &texture)
+{
+    TextureContainer container;
+    if (!container.Map(TextureContainer::PathFor(file), TextureContainer::HashSource(contents)) || container.GetChannels() != (alpha ? 4u : 3u))
+        return false;
+    if (alpha)
+    {
+        texture.Internal_Format = GL_RGBA;
+        texture.Image_Format = GL_RGBA;
+    }
+    const std::vector<TextureLevel> &levels = container.GetLevels();
+    texture.Generate(levels.data(), static_cast<unsigned int>(levels.size()));
+    return true;
+}
@@ -0,0 +1,315 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <iostream>
+#include <chrono>
+#include <cstring>
+
+#include "rollback.hpp"
+
+// Marks a netplay packet (and its layout version)
+const unsigned char PACKET_MAGIC = 0xB7;
+const unsigned char PACKET_VERSION = 2;
+
+// Packet layout, little endian: magic, version, the sender's GamePhysics (u8), sender frame (i32), sender frame
+// advantage (i32), newest frame of ours the sender has (i32), checksum frame (i32, -1 for none), checksum (u64),
+// first input frame (i32), input count (u8), then one byte per input
+const unsigned int PACKET_HEADER_SIZE = 3 + 4 * 5 + 8 + 1;
+
+// writes a little endian integer into a packet
+static unsigned char *writeInt(unsigned char *out, unsigned long long value, unsigned int bytes)
+{
+    for (unsigned int i = 0; i < bytes; ++i)
+        *out++ = static_cast<unsigned char>(value >> (8 * i));
+    return out;
+}
+
+// reads a little endian integer from a packet
+static const unsigned char *readInt(const unsigned char *in, unsigned long long &value, unsigned int bytes)
+{
+    value = 0;
+    for (unsigned int i = 0; i < bytes; ++i)
+        value |= static_cast<unsigned long long>(*in++) << (8 * i);
+    return in;
+}
+
+static const unsigned char *readFrame(const unsigned char *in, int &frame)
+{
+    unsigned long long value;
+    in = readInt(in, value, 4);
+    frame = static_cast<int>(static_cast<unsigned int>(value));
+    return in;
+}
+
+// 64 bit FNV-1a hash of some bytes, continuing from a previous hash
+static unsigned long long hashBytes(const void *bytes, unsigned int size, unsigned long long hash)
+{
+    const unsigned char *data = static_cast<const unsigned char *>(bytes);
+    for (unsigned int i = 0; i < size; ++i)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// a checksum of everything in a saved game state
+static unsigned long long checksum(const GameSave &save)
+{
+    unsigned long long hash = 14695981039346656037ull;
+    unsigned int values[4] = {static_cast<unsigned int>(save.State), save.Level, save.Lives, static_cast<unsigned int>(save.Score)};
+    hash = hashBytes(values, sizeof(values), hash);
+    hash = hashBytes(save.PlayerPositions, sizeof(save.PlayerPositions), hash);
+    hash = hashBytes(save.PlayerSizes, sizeof(save.PlayerSizes), hash);
+    hash = hashBytes(save.BallPositions, sizeof(save.BallPositions), hash);
+    hash = hashBytes(save.BallVelocities, sizeof(save.BallVelocities), hash);
+    hash = hashBytes(save.BallStuck, sizeof(save.BallStuck), hash);
+    hash = hashBytes(save.BallDead, sizeof(save.BallDead), hash);
+    for (bool alive : save.BrickAlive)
+        hash = hashBytes(&alive, 1, hash);
+    return hash;
+}
+
+// constructor
+RollbackSession::RollbackSession(Game &game, UdpSocket &socket, unsigned int player, float frameMs, unsigned int inputDelay)
+    : game(game), socket(socket), player(player > 0 ? 1 : 0), frameMs(frameMs), inputDelay(inputDelay),
+      frame(0), remoteConfirmed(-1), localAcked(-1), peerFrame(-1), peerAdvantage(0), rollbackTo(-1),
+      localInputs(), remoteInputs(), usedRemote(), nextChecksum(0), peerChecksumFrame(-1), peerChecksum(0), stats()
+{
+    for (int &slot : this->remoteFrames)
+        slot = -1;
+    for (int &slot : this->checksumFrames)
+        slot = -1;
+}
+
+// receives the peer's inputs, then simulates the next frame
+bool RollbackSession::Tick(unsigned char localInput)
+{
+    this->receive();
+
+    // nothing is simulated until the peer has been heard from, and never with a peer running other physics
+    if (!this->Connected())
+    {
+        this->send();
+        return false;
+    }
+
+    if (this->rollbackTo >= 0)
+        this->rollback();
+    this->checkSync();
+
+    // never predict more frames than a rollback can resimulate
+    bool advance = this->frame - this->remoteConfirmed - 1 < static_cast<int>(MAX_ROLLBACK);
+
+    // and every so often, let a peer that is behind catch up (each side halves the difference between
+    // how far it thinks it is ahead and how far the peer thinks it is)
+    int advantage = this->Connected() ? this->frame - this->peerFrame : 0;
+    if (advance && this->frame % SYNC_INTERVAL == 0 && (advantage - this->peerAdvantage) / 2 >= 1)
+        advance = false;
+
+    if (advance)
+    {
+        // the input sampled now is used inputDelay frames later (the frames before the first one get none)
+        this->localInputs[(this->frame + this->inputDelay) % INPUT_WINDOW] = localInput;
+        this->simulate(this->frame);
+        ++this->frame;
+        ++this->stats.Frames;
+    }
+    else
+        ++this->stats.Stalls;
+
+    // always send, so lost packets are made up for even while stalled
+    this->send();
+    return advance;
+}
+
+// handles every packet waiting from the peer
+void RollbackSession::receive()
+{
+    unsigned char packet[PACKET_HEADER_SIZE + MAX_PACKET_INPUTS];
+    unsigned int size;
+    while ((size = this->socket.Receive(packet, sizeof(packet))) > 0)
+    {
+        if (size < PACKET_HEADER_SIZE || packet[0] != PACKET_MAGIC || packet[1] != PACKET_VERSION)
+            continue;
+
+        // the same inputs only give the same game with the same physics, so a peer with other physics is ignored
+        if (packet[2] != this->game.Physics)
+        {
+            if (!this->stats.PhysicsMismatch)
+            {
+                this->stats.PhysicsMismatch = true;
+                std::cout << "ERROR::ROLLBACK: The peer plays with " << (packet[2] == PHYSICS_FIXED ? "fixed-point" : "float")
+                          << " physics, refusing to play (both sides must pass --fixed-physics, or neither)" << std::endl;
+            }
+            continue;
+        }
+
+        int senderFrame, senderAdvantage, acked, checksumFrame, firstFrame;
+        unsigned long long sum, count;
+        const unsigned char *in = packet + 3;
+        in = readFrame(in, senderFrame);
+        in = readFrame(in, senderAdvantage);
+        in = readFrame(in, acked);
+        in = readFrame(in, checksumFrame);
+        in = readInt(in, sum, 8);
+        in = readFrame(in, firstFrame);
+        in = readInt(in, count, 1);
+        if (size < PACKET_HEADER_SIZE + count)
+            continue;
+
+        // packets can arrive out of order, so only ever move forward
+        if (senderFrame > this->peerFrame)
+        {
+            this->peerFrame = senderFrame;
+            this->peerAdvantage = senderAdvantage;
+        }
+        if (acked > this->localAcked)
+            this->localAcked = acked;
+        if (checksumFrame > this->peerChecksumFrame)
+        {
+            this->peerChecksumFrame = checksumFrame;
+            this->peerChecksum = sum;
+        }
+
+        // store the inputs that are new, noting the oldest one that contradicts what was predicted
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            int inputFrame = firstFrame + static_cast<int>(i);
+            if (inputFrame <= this->remoteConfirmed || inputFrame >= this->remoteConfirmed + static_cast<int>(INPUT_WINDOW))
+                continue;
+            unsigned int slot = inputFrame % INPUT_WINDOW;
+            if (this->remoteFrames[slot] == inputFrame)
+                continue;
+
+            this->remoteFrames[slot] = inputFrame;
+            this->remoteInputs[slot] = in[i];
+            if (inputFrame < this->frame && this->usedRemote[slot] != in[i] &&
+                (this->rollbackTo < 0 || inputFrame < this->rollbackTo))
+                this->rollbackTo = inputFrame;
+        }
+
+        // every input up to the first gap is now confirmed
+        while (this->remoteFrames[(this->remoteConfirmed + 1) % INPUT_WINDOW] == this->remoteConfirmed + 1)
+            ++this->remoteConfirmed;
+    }
+}
+
+// sends the local inputs the peer has not confirmed yet
+void RollbackSession::send()
+{
+    // every input sampled so far that the peer does not have (the newest ones, if that many do not fit)
+    int newest = this->frame - 1 + static_cast<int>(this->inputDelay);
+    int first = this->localAcked + 1;
+    if (newest - first + 1 > static_cast<int>(MAX_PACKET_INPUTS))
+        first = newest - static_cast<int>(MAX_PACKET_INPUTS) + 1;
+    unsigned int count = newest >= first ? static_cast<unsigned int>(newest - first + 1) : 0;
+
+    // our latest checksum of a confirmed frame
+    int latest = -1;
+    unsigned long long sum = 0;
+    for (unsigned int i = 0; i < CHECKSUM_COUNT; ++i)
+    {
+        if (this->checksumFrames[i] > latest)
+        {
+            latest = this->checksumFrames[i];
+            sum = this->checksums[i];
+        }
+    }
+
+    unsigned char packet[PACKET_HEADER_SIZE + MAX_PACKET_INPUTS];
+    unsigned char *out = packet;
+    *out++ = PACKET_MAGIC;
+    *out++ = PACKET_VERSION;
+    *out++ = static_cast<unsigned char>(this->game.Physics);
+    out = writeInt(out, static_cast<unsigned int>(this->frame), 4);
+    out = writeInt(out, static_cast<unsigned int>(this->Connected() ? this->frame - this->peerFrame : 0), 4);
+    out = writeInt(out, static_cast<unsigned int>(this->remoteConfirmed), 4);
+    out = writeInt(out, static_cast<unsigned int>(latest), 4);
+    out = writeInt(out, sum, 8);
+    out = writeInt(out, static_cast<unsigned int>(first), 4);
+    out = writeInt(out, count, 1);
+    for (unsigned int i = 0; i < count; ++i)
+        *out++ = this->localInputs[(first + static_cast<int>(i)) % INPUT_WINDOW];
+    this->socket.Send(packet, static_cast<unsigned int>(out - packet));
+}
+
+// restores the oldest mispredicted frame and simulates every frame since again
+void RollbackSession::rollback()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    int from = this->rollbackTo;
+    this->rollbackTo = -1;
+    this->game.LoadState(this->saves[from % SAVE_COUNT]);
+
+    // the frames simulated again already made their sounds (mispredicted ones or not, they have been heard)
+    unsigned int sounds = this->game.Sounds;
+    for (int resimulate = from; resimulate < this->frame; ++resimulate)
+        this->simulate(resimulate);
+    this->game.Sounds = sounds;
+
+    unsigned int frames = static_cast<unsigned int>(this->frame - from);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ++this->stats.Rollbacks;
+    this->stats.Resimulated += frames;
+    if (frames > this->stats.MaxRollback)
+        this->stats.MaxRollback = frames;
+    if (ms > this->stats.MaxRollbackMs)
+        this->stats.MaxRollbackMs = ms;
+}
+
+// saves the state and simulates one frame
+void RollbackSession::simulate(int frame)
+{
+    unsigned int slot = frame % INPUT_WINDOW;
+    this->game.SaveState(this->saves[frame % SAVE_COUNT]);
+
+    unsigned char inputs[2];
+    inputs[this->player] = this->localInputs[slot];
+    inputs[1 - this->player] = this->usedRemote[slot] = this->remoteInput(frame);
+
+    this->game.ProcessVersusInput(this->frameMs, inputs);
+    this->game.Update(this->frameMs);
+}
+
+// the peer's input for a frame
+unsigned char RollbackSession::remoteInput(int frame) const
+{
+    unsigned int slot = frame % INPUT_WINDOW;
+    if (this->remoteFrames[slot] == frame)
+        return this->remoteInputs[slot];
+    return this->remoteConfirmed >= 0 ? this->remoteInputs[this->remoteConfirmed % INPUT_WINDOW] : 0;
+}
+
+// checksums newly confirmed frames and compares them to the peer's
+void RollbackSession::checkSync()
+{
+    // the state at the start of a frame is final once every input before it is confirmed, and it is
+    // still saved if that frame has been simulated recently enough
+    while (this->nextChecksum <= this->remoteConfirmed + 1 && this->nextChecksum < this->frame)
+    {
+        if (this->nextChecksum > this->frame - static_cast<int>(SAVE_COUNT))
+        {
+            unsigned int slot = (this->nextChecksum / CHECKSUM_INTERVAL) % CHECKSUM_COUNT;
+            this->checksumFrames[slot] = this->nextChecksum;
+            this->checksums[slot] = checksum(this->saves[this->nextChecksum % SAVE_COUNT]);
+        }
+        this->nextChecksum += CHECKSUM_INTERVAL;
+    }
+
+    // then compare the peer's latest checksum against ours for the same frame
+    if (this->stats.Desynced || this->peerChecksumFrame < 0)
+        return;
+    unsigned int slot = (this->peerChecksumFrame / CHECKSUM_INTERVAL) % CHECKSUM_COUNT;
+    if (this->checksumFrames[slot] == this->peerChecksumFrame && this->checksums[slot] != this->peerChecksum)
+    {
+        this->stats.Desynced = true;
+        std::cout << "ERROR::ROLLBACK: Desynced from the peer at frame " << this->peerChecksumFrame << std::endl;
+    }
+}
@@ -9,6 +9,7 @@
 #include <iostream>
 
 #include "shader.hpp"
+#include "memory_stats.hpp"
 
 // sets the current shader as active
 Shader &Shader::Use()
@@ -45,6 +46,7 @@ void Shader::Compile(const char *vertexSource, const char *fragmentSource, const
 
     // shader program
     this->ID = glCreateProgram();
+    MemoryStats::Created(GL_OBJECT_PROGRAM);
     glAttachShader(this->ID, sVertex);
     glAttachShader(this->ID, sFragment);
     if (geometrySource != nullptr)
@@ -59,6 +61,44 @@ void Shader::Compile(const char *vertexSource, const char *fragmentSource, const
         glDeleteShader(gShader);
 }
 
+// recompiles the shader from new source code into a new program, replacing the old one if it links
+bool Shader::Relink(const char *vertexSource, const char *fragmentSource, const char *geometrySource)
+{
+    // compile every stage first, so a typo leaves the old (working) program untouched
+    unsigned int sVertex = this->compileStage(GL_VERTEX_SHADER, vertexSource, "VERTEX");
+    unsigned int sFragment = this->compileStage(GL_FRAGMENT_SHADER, fragmentSource, "FRAGMENT");
+    unsigned int gShader = geometrySource != nullptr ? this->compileStage(GL_GEOMETRY_SHADER, geometrySource, "GEOMETRY") : 0;
+    if (sVertex == 0 || sFragment == 0 || (geometrySource != nullptr && gShader == 0))
+    {
+        glDeleteShader(sVertex);
+        glDeleteShader(sFragment);
+        glDeleteShader(gShader);
+        return false;
+    }
+
+    // link into a new program, so a bad edit leaves the old (working) program untouched
+    unsigned int program = glCreateProgram();
+    MemoryStats::Created(GL_OBJECT_PROGRAM);
+    glAttachShader(program, sVertex);
+    glAttachShader(program, sFragment);
+    if (gShader != 0)
+        glAttachShader(program, gShader);
+    glLinkProgram(program);
+    bool linked = checkCompileErrors(program, "PROGRAM");
+
+    // delete the shaders as they're linked into the program now and no longer necessary
+    glDeleteShader(sVertex);
+    glDeleteShader(sFragment);
+    glDeleteShader(gShader);
+
+    // only replace the old program once the new one works
+    glDeleteProgram(linked ? this->ID : program);
+    MemoryStats::Deleted(GL_OBJECT_PROGRAM);
+    if (linked)
+        this->ID = program;
+    return linked;
+}
+
 // utility functions:
 void Shader::SetFloat(const char *name, float value, bool useShader)
 {
@@ -114,9 +154,29 @@ void Shader::SetMatrix4(const char *name, const glm::mat4 &matrix, bool useShade
         this->Use();
     glUniformMatrix4fv(glGetUniformLocation(this->ID, name), 1, false, glm::value_ptr(matrix));
 }
+void Shader::SetUniformBlock(const char *name, unsigned int binding)
+{
+    unsigned int index = glGetUniformBlockIndex(this->ID, name);
+    if (index != GL_INVALID_INDEX)
+        glUniformBlockBinding(this->ID, index, binding);
+}
+
+// compiles a single shader stage, returns 0 if it failed to compile
+unsigned int Shader::compileStage(GLenum stage, const char *source, std::string type)
+{
+    unsigned int shader = glCreateShader(stage);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    if (!checkCompileErrors(shader, type))
+    {
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
 
 // checks if compilation or linking failed and if so, print the error logs
-void Shader::checkCompileErrors(unsigned int object, std::string type)
+bool Shader::checkCompileErrors(unsigned int object, std::string type)
 {
     int success;
     char infoLog[1024];
@@ -142,4 +202,5 @@ void Shader::checkCompileErrors(unsigned int object, std::string type)
                       << std::endl;
         }
     }
+    return success != 0;
 }
\ No newline at end of file
@@ -7,13 +7,21 @@
 ** option) any later version.
 ******************************************************************/
 #include <iostream>
+#include <cstring>
+#include <cstddef>
 
 #include "sprite_renderer.hpp"
+#include "memory_stats.hpp"
+#include "trace.hpp"
+#include "gl_debug.hpp"
+
+// Size of the unit quad's vertex data: 6 vertices of position and texCoords
+const long long QUAD_BYTES = 6 * 4 * sizeof(GLfloat);
 
 // Constructor
-SpriteRenderer::SpriteRenderer(Shader &shader)
+SpriteRenderer::SpriteRenderer(ResourceId shader, StreamBuffer &stream)
+    : shader(shader), stream(stream)
 {
-    this->shader = shader;
     this->initRenderData();
 }
 
@@ -21,39 +29,76 @@ SpriteRenderer::SpriteRenderer(Shader &shader)
 SpriteRenderer::~SpriteRenderer()
 {
     glDeleteVertexArrays(1, &this->quadVAO);
+    glDeleteBuffers(1, &this->quadVBO);
+    MemoryStats::Deleted(GL_OBJECT_VERTEX_ARRAY);
+    MemoryStats::Deleted(GL_OBJECT_BUFFER);
+    MemoryStats::AddBufferBytes(-QUAD_BYTES);
 }
 
 // Render the sprite
-void SpriteRenderer::DrawSprite(const Texture2D &texture, glm::vec2 position, glm::vec2 size, GLfloat rotate, int colorIndex)
+void SpriteRenderer::DrawSprite(TextureHandle texture, glm::vec2 position, glm::vec2 size, GLfloat rotate, int colorIndex)
 {
-    // Prepare transformations
-    this->shader.Use();
-
-    // First translate (transformations are: scale happens first, then rotation and then finall translation happens; reversed order)
-    glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(position, 0.0f));
+    TRACE_ZONE("SpriteRenderer::DrawSprite");
+    // sprites without a texture of their own are just a palette color
+    if (!texture.Valid())
+    {
+        this->DrawSprite(position, size, rotate, colorIndex);
+        return;
+    }
 
-    // Move origin of rotation to center of quad
-    model = glm::translate(model, glm::vec3(0.5f * size.x, 0.5f * size.y, 0.0f));
+    // keep the draw order: anything queued goes first
+    this->Flush();
 
-    // Then rotate
-    model = glm::rotate(model, rotate, glm::vec3(0.0f, 0.0f, 1.0f));
+    ResourceManager::GetShader(this->shader).Use().SetInteger("useTexture", 1);
 
-    // Move origin back
-    model = glm::translate(model, glm::vec3(-0.5f * size.x, -0.5f * size.y, 0.0f));
-
-    // Last scale
-    model = glm::scale(model, glm::vec3(size, 1.0f));
+    glActiveTexture(GL_TEXTURE0);
+    texture.Bind();
 
-    this->shader.SetMatrix4("model", model);
+    SpriteInstance instance{glm::vec4(position, size), rotate, colorIndex};
+    this->drawInstances(&instance, 1);
+}
 
-    // Render textured quad
-    this->shader.SetInteger("textureSamplerIndex", colorIndex);
+// Queue a flat colored sprite
+void SpriteRenderer::DrawSprite(glm::vec2 position, glm::vec2 size, GLfloat rotate, int colorIndex)
+{
+    TRACE_ZONE("SpriteRenderer::DrawSprite");
+    MemoryScope scope(MEMORY_RENDER);
+    this->batch.push_back(SpriteInstance{glm::vec4(position, size), rotate, colorIndex});
+}
 
-    glActiveTexture(GL_TEXTURE0);
-    texture.Bind();
+// Draw the queued sprites
+void SpriteRenderer::Flush()
+{
+    TRACE_ZONE("SpriteRenderer::Flush");
+    GL_DEBUG_SCOPE("SpriteRenderer::Flush");
+    if (this->batch.empty())
+        return;
+
+    ResourceManager::GetShader(this->shader).Use().SetInteger("useTexture", 0);
+    this->drawInstances(this->batch.data(), static_cast<unsigned int>(this->batch.size()));
+    this->batch.clear();
+}
 
+// Stream the instances and draw one quad for each
+void SpriteRenderer::drawInstances(const SpriteInstance *instances, unsigned int count)
+{
+    GLintptr offset;
+    GLsizeiptr bytes = count * sizeof(SpriteInstance);
+    void *data = this->stream.Map(bytes, sizeof(glm::vec4), offset);
+    if (!data)
+        return;
+    std::memcpy(data, instances, bytes);
+    this->stream.Unmap();
+
+    // point the per-instance attributes at this write (the vertex shader scales the unit quad to each rect and rotates it around the rect's center)
     glBindVertexArray(this->quadVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glBindBuffer(GL_ARRAY_BUFFER, this->stream.ID);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (GLvoid *)(offset + offsetof(SpriteInstance, Rect)));
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (GLvoid *)(offset + offsetof(SpriteInstance, Rotation)));
+    glVertexAttribIPointer(3, 1, GL_INT, sizeof(SpriteInstance), (GLvoid *)(offset + offsetof(SpriteInstance, ColorIndex)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, count);
     glBindVertexArray(0);
 }
 
@@ -61,7 +106,6 @@ void SpriteRenderer::DrawSprite(const Texture2D &texture, glm::vec2 position, gl
 void SpriteRenderer::initRenderData()
 {
     // Configure VAO/VBO
-    GLuint VBO;
     GLfloat vertices[] = {
         // Pos      // Tex
         0.0f, 1.0f, 0.0f, 1.0f,
@@ -73,14 +117,24 @@ void SpriteRenderer::initRenderData()
         1.0f, 0.0f, 1.0f, 0.0f};
 
     glGenVertexArrays(1, &this->quadVAO);
-    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &this->quadVBO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->quadVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    MemoryStats::Created(GL_OBJECT_VERTEX_ARRAY);
+    MemoryStats::Created(GL_OBJECT_BUFFER);
+    MemoryStats::AddBufferBytes(QUAD_BYTES);
 
     glBindVertexArray(this->quadVAO);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (GLvoid *)0);
+
+    // per-instance rect, rotation and color index, pointed at the stream buffer for each draw
+    for (unsigned int attribute = 1; attribute <= 3; ++attribute)
+    {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 }
@@ -0,0 +1,152 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <iostream>
+
+#include "stream_buffer.hpp"
+#include "gl_extensions.hpp"
+#include "memory_stats.hpp"
+#include "gl_debug.hpp"
+
+// how long to wait on a fence before checking again, in nanoseconds
+const GLuint64 FENCE_TIMEOUT = 1000000000;
+
+// constructor, allocates the ring and maps it if persistent mapping is available
+StreamBuffer::StreamBuffer(GLsizeiptr size)
+    : ID(0), size(size), head(0), unfenced(0), mapping(nullptr), mapped(false)
+{
+    glGenBuffers(1, &this->ID);
+    MemoryStats::Created(GL_OBJECT_BUFFER);
+    MemoryStats::AddBufferBytes(size);
+    glBindBuffer(GL_ARRAY_BUFFER, this->ID);
+    GLDebug::Label(GL_BUFFER, this->ID, "StreamBuffer");
+    if (GLExtensions::HasBufferStorage())
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GLExtensions::BufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+        this->mapping = static_cast<unsigned char *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+        if (!this->mapping)
+            std::cout << "ERROR::STREAM_BUFFER: Persistent mapping failed, mapping each write instead" << std::endl;
+    }
+    else
+    {
+        glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// destructor
+StreamBuffer::~StreamBuffer()
+{
+    for (const Region &region : this->regions)
+        glDeleteSync(region.Sync);
+    MemoryStats::Deleted(GL_OBJECT_SYNC, static_cast<int>(this->regions.size()));
+    if (this->mapping)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, this->ID);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &this->ID);
+    MemoryStats::Deleted(GL_OBJECT_BUFFER);
+    MemoryStats::AddBufferBytes(-this->size);
+}
+
+// reserve the next region of the ring
+void *StreamBuffer::Map(GLsizeiptr size, GLsizeiptr alignment, GLintptr &offset)
+{
+    if (size > this->size)
+    {
+        std::cout << "ERROR::STREAM_BUFFER: Write of " << size << " bytes does not fit in the ring" << std::endl;
+        return nullptr;
+    }
+
+    offset = (this->head + alignment - 1) / alignment * alignment;
+    if (offset + size > this->size)
+    {
+        // wrap around; the draws reading the data at the end have been issued, so fence it first
+        this->Fence();
+        offset = 0;
+        this->unfenced = 0;
+    }
+    this->waitFor(offset, offset + size);
+    this->head = offset + size;
+
+    if (this->mapping)
+        return this->mapping + offset;
+
+    // the region is fenced off from pending draws, so GL does not need to synchronize the mapping
+    glBindBuffer(GL_ARRAY_BUFFER, this->ID);
+    void *data = glMapBufferRange(GL_ARRAY_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    this->mapped = data != nullptr;
+    return data;
+}
+
+// finish the current write
+void StreamBuffer::Unmap()
+{
+    // the persistent mapping is coherent, so the data is visible to draws issued from now on
+    if (!this->mapped)
+        return;
+    glBindBuffer(GL_ARRAY_BUFFER, this->ID);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    this->mapped = false;
+}
+
+// fence off everything written since the last fence
+void StreamBuffer::Fence()
+{
+    if (this->head == this->unfenced)
+        return;
+    GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    MemoryStats::Created(GL_OBJECT_SYNC);
+    this->regions.push_back(Region{sync, this->unfenced, this->head});
+    this->unfenced = this->head;
+
+    // let go of the fences the GPU has already passed, so they do not pile up while the ring is far from full
+    while (this->regions.size() > 1)
+    {
+        GLenum result = glClientWaitSync(this->regions.front().Sync, 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+            break;
+        glDeleteSync(this->regions.front().Sync);
+        MemoryStats::Deleted(GL_OBJECT_SYNC);
+        this->regions.pop_front();
+    }
+}
+
+bool StreamBuffer::IsPersistent() const
+{
+    return this->mapping != nullptr;
+}
+
+// wait for the GPU to finish with the regions about to be overwritten
+void StreamBuffer::waitFor(GLintptr begin, GLintptr end)
+{
+    // regions are fenced in order, so once the newest overlapping region is done every older one is as well
+    size_t count = 0;
+    for (size_t i = 0; i < this->regions.size(); ++i)
+    {
+        if (this->regions[i].Begin < end && begin < this->regions[i].End)
+            count = i + 1;
+    }
+    if (count == 0)
+        return;
+
+    GLsync sync = this->regions[count - 1].Sync;
+    GLenum result = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+    while (result == GL_TIMEOUT_EXPIRED)
+        result = glClientWaitSync(sync, 0, FENCE_TIMEOUT);
+    if (result == GL_WAIT_FAILED)
+        std::cout << "ERROR::STREAM_BUFFER: Waiting on a fence failed" << std::endl;
+
+    for (size_t i = 0; i < count; ++i)
+        glDeleteSync(this->regions[i].Sync);
+    MemoryStats::Deleted(GL_OBJECT_SYNC, static_cast<int>(count));
+    this->regions.erase(this->regions.begin(), this->regions.begin() + count);
+}
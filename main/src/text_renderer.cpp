@@ -7,6 +7,7 @@
 ** option) any later version.
 ******************************************************************/
 #include <iostream>
+#include <cstring>
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <ft2build.h>
@@ -14,40 +15,67 @@
 
 #include "text_renderer.hpp"
 #include "resource_manager.hpp"
+#include "camera.hpp"
+#include "memory_stats.hpp"
+#include "trace.hpp"
+#include "gl_debug.hpp"
+#include "embedded_assets.hpp"
 
-// constructor
-TextRenderer::TextRenderer(unsigned int width, unsigned int height)
-{
-    // load and configure shader
-    this->TextShader = ResourceManager::LoadShader("shaders/text_2d.vs", "shaders/text_2d.frag", nullptr, "text");
-    this->TextShader.SetMatrix4("projection", glm::ortho(0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f), true);
-    this->TextShader.SetInteger("text", 0);
+// the widest row of glyphs packed into a font atlas
+const unsigned int ATLAS_WIDTH = 1024;
 
-    // configure VAO/VBO for texture quads
-    glGenVertexArrays(1, &this->VAO);
-    glGenBuffers(1, &this->VBO);
-    glBindVertexArray(this->VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
+// configures a VAO for glyph quads (vec2 position, vec2 texCoords per vertex) read from the given buffer
+static void initGlyphArray(unsigned int &VAO, unsigned int VBO)
+{
+    glGenVertexArrays(1, &VAO);
+    MemoryStats::Created(GL_OBJECT_VERTEX_ARRAY);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
 }
 
-void TextRenderer::Load(std::string font, unsigned int fontSize)
+// constructor
+TextRenderer::TextRenderer(StreamBuffer &stream)
+    : Atlas(0), atlasBytes(0), stream(stream)
+{
+    // load and configure shader (shared by every text renderer: loading the same files again reuses the loaded program)
+    this->TextShader = ResourceManager::LoadShader("shaders/text_2d.vs", "shaders/text_2d.frag", nullptr, "text");
+    ResourceManager::GetShader(this->TextShader).Use().SetInteger("text", 0);
+    ResourceManager::GetShader(this->TextShader).SetUniformBlock("Frame", Camera::BINDING);
+
+    // configure the VAO for texture quads streamed through the shared ring
+    initGlyphArray(this->VAO, this->stream.ID);
+}
+
+// destructor
+TextRenderer::~TextRenderer()
+{
+    glDeleteVertexArrays(1, &this->VAO);
+    MemoryStats::Deleted(GL_OBJECT_VERTEX_ARRAY);
+    this->deleteAtlas();
+}
+
+void TextRenderer::Load(const std::string &font, unsigned int fontSize)
 {
     // first clear the previously loaded Characters
     this->Characters.clear();
+    this->deleteAtlas();
+    MemoryScope scope(MEMORY_TEXT);
 
     // then initialize and load the FreeType library
     FT_Library ft;
     if (FT_Init_FreeType(&ft)) // all functions return a value different than 0 whenever an error occurred
         std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
 
-    // load font as face
+    // load font as face, straight from the executable if the font is embedded in it
     FT_Face face;
-    if (FT_New_Face(ft, font.c_str(), 0, &face))
+    const EmbeddedFile *embedded = EmbeddedAssets::Find(font);
+    FT_Error error = embedded != nullptr ? FT_New_Memory_Face(ft, embedded->Data, embedded->Size, 0, &face)
+                                         : FT_New_Face(ft, font.c_str(), 0, &face);
+    if (error)
         std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
 
     // set size to load glyphs as
@@ -56,7 +84,12 @@ void TextRenderer::Load(std::string font, unsigned int fontSize)
     // disable byte-alignment restriction
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-    // then for the first 128 ASCII characters, pre-load/compile their characters and store them
+    // then for the first 128 ASCII characters, pre-load/compile their characters and keep their bitmaps
+    // until they can be packed into the atlas
+    std::vector<std::vector<unsigned char>> bitmaps(128);
+    std::vector<glm::ivec2> offsets(128);
+    glm::ivec2 pen(0, 0);
+    unsigned int rowHeight = 0;
     for (GLubyte c = 0; c < 128; c++) // lol see what I did there
     {
         // load character glyph
@@ -66,36 +99,58 @@ void TextRenderer::Load(std::string font, unsigned int fontSize)
             continue;
         }
 
-        // generate texture
-        unsigned int texture;
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glTexImage2D(
-            GL_TEXTURE_2D,
-            0,
-            GL_RED,
-            face->glyph->bitmap.width,
-            face->glyph->bitmap.rows,
-            0,
-            GL_RED,
-            GL_UNSIGNED_BYTE,
-            face->glyph->bitmap.buffer);
+        FT_Bitmap &bitmap = face->glyph->bitmap;
+        bitmaps[c].assign(bitmap.buffer, bitmap.buffer + bitmap.width * bitmap.rows);
 
-        // set texture options
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // shelf pack: start a new row when this glyph would overflow the current one (1 texel gap avoids bleeding)
+        if (pen.x + bitmap.width + 1 > ATLAS_WIDTH)
+        {
+            pen = glm::ivec2(0, pen.y + rowHeight + 1);
+            rowHeight = 0;
+        }
+        offsets[c] = pen;
+        pen.x += bitmap.width + 1;
+        if (bitmap.rows > rowHeight)
+            rowHeight = bitmap.rows;
 
-        // now store character for later use
+        // now store character for later use (the atlas coordinates are filled in once its size is known)
         Character character = {
-            texture,
-            glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
+            0,
+            glm::ivec2(bitmap.width, bitmap.rows),
             glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-            static_cast<unsigned int>(face->glyph->advance.x)};
+            static_cast<unsigned int>(face->glyph->advance.x),
+            glm::vec2(0.0f),
+            glm::vec2(0.0f)};
 
         Characters.insert(std::pair<char, Character>(c, character));
     }
+    unsigned int atlasHeight = pen.y + rowHeight;
+
+    // generate the atlas texture and copy every glyph into its place
+    glGenTextures(1, &this->Atlas);
+    glBindTexture(GL_TEXTURE_2D, this->Atlas);
+    GLDebug::Label(GL_TEXTURE, this->Atlas, "TextRenderer::Atlas");
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, ATLAS_WIDTH, atlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+    this->atlasBytes = static_cast<long long>(ATLAS_WIDTH) * atlasHeight;
+    MemoryStats::Created(GL_OBJECT_TEXTURE);
+    MemoryStats::AddTextureBytes(this->atlasBytes);
+    for (std::pair<const char, Character> &entry : this->Characters)
+    {
+        Character &ch = entry.second;
+        glm::ivec2 offset = offsets[static_cast<unsigned char>(entry.first)];
+        if (ch.Size.x > 0 && ch.Size.y > 0)
+            glTexSubImage2D(GL_TEXTURE_2D, 0, offset.x, offset.y, ch.Size.x, ch.Size.y, GL_RED, GL_UNSIGNED_BYTE,
+                            bitmaps[static_cast<unsigned char>(entry.first)].data());
+        ch.TextureID = this->Atlas;
+        ch.UVMin = glm::vec2(offset) / glm::vec2(ATLAS_WIDTH, atlasHeight);
+        ch.UVMax = glm::vec2(offset + ch.Size) / glm::vec2(ATLAS_WIDTH, atlasHeight);
+    }
+
+    // set texture options
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
     glBindTexture(GL_TEXTURE_2D, 0);
 
@@ -104,52 +159,148 @@ void TextRenderer::Load(std::string font, unsigned int fontSize)
     FT_Done_FreeType(ft);
 }
 
+// deletes the font's atlas texture, if there is one
+void TextRenderer::deleteAtlas()
+{
+    if (this->Atlas == 0)
+        return;
+    glDeleteTextures(1, &this->Atlas);
+    MemoryStats::Deleted(GL_OBJECT_TEXTURE);
+    MemoryStats::AddTextureBytes(-this->atlasBytes);
+    this->Atlas = 0;
+    this->atlasBytes = 0;
+}
+
 // renders a string of text using the precompiled list of characters
-void TextRenderer::RenderText(std::string text, float x, float y, float scale, glm::vec3 color)
+void TextRenderer::RenderText(const std::string &text, float x, float y, float scale, glm::vec3 color)
 {
+    TRACE_ZONE("TextRenderer::RenderText");
+    GL_DEBUG_SCOPE("TextRenderer::RenderText");
+    // lay out every glyph of the string into one buffer
+    this->scratch.clear();
+    this->Layout(text, x, y, scale, this->scratch);
+    if (this->scratch.empty())
+        return;
+
+    // write the glyphs into the stream buffer, starting on a whole vertex so the draw can address them by index
+    const GLsizeiptr vertexSize = 4 * sizeof(float);
+    GLintptr offset;
+    void *data = this->stream.Map(this->scratch.size() * sizeof(float), vertexSize, offset);
+    if (!data)
+        return;
+    std::memcpy(data, this->scratch.data(), this->scratch.size() * sizeof(float));
+    this->stream.Unmap();
+
     // activate corresponding render state
-    this->TextShader.Use();
-    this->TextShader.SetVector3f("textColor", color);
-    glActiveTexture(GL_TEXTURE0);
+    this->Prepare(color);
     glBindVertexArray(this->VAO);
 
+    // render all glyph quads at once
+    glDrawArrays(GL_TRIANGLES, static_cast<GLint>(offset / vertexSize), static_cast<GLsizei>(this->scratch.size() / 4));
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// lays out a string as two triangles per glyph, appending to vertices
+void TextRenderer::Layout(const std::string &text, float x, float y, float scale, std::vector<float> &vertices)
+{
+    std::map<char, Character>::const_iterator capital = this->Characters.find('H');
+    int capitalBearing = capital != this->Characters.end() ? capital->second.Bearing.y : 0;
+
     // iterate through all characters
-    std::string::const_iterator c;
-    for (c = text.begin(); c != text.end(); c++)
+    for (char c : text)
     {
-        Character ch = Characters[*c];
+        std::map<char, Character>::const_iterator found = this->Characters.find(c);
+        if (found == this->Characters.end())
+            continue;
+        const Character &ch = found->second;
 
         float xpos = x + ch.Bearing.x * scale;
-        float ypos = y + (this->Characters['H'].Bearing.y - ch.Bearing.y) * scale;
+        float ypos = y + (capitalBearing - ch.Bearing.y) * scale;
 
         float w = ch.Size.x * scale;
         float h = ch.Size.y * scale;
 
-        // update VBO for each character
-        float vertices[6][4] = {
-            {xpos, ypos + h, 0.0f, 1.0f},
-            {xpos + w, ypos, 1.0f, 0.0f},
-            {xpos, ypos, 0.0f, 0.0f},
-
-            {xpos, ypos + h, 0.0f, 1.0f},
-            {xpos + w, ypos + h, 1.0f, 1.0f},
-            {xpos + w, ypos, 1.0f, 0.0f}};
+        // glyph quad, sampling the glyph's rectangle of the atlas
+        const float quad[6][4] = {
+            {xpos, ypos + h, ch.UVMin.x, ch.UVMax.y},
+            {xpos + w, ypos, ch.UVMax.x, ch.UVMin.y},
+            {xpos, ypos, ch.UVMin.x, ch.UVMin.y},
 
-        // render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-
-        // update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // be sure to use glBufferSubData and not glBufferData
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-        // render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+            {xpos, ypos + h, ch.UVMin.x, ch.UVMax.y},
+            {xpos + w, ypos + h, ch.UVMax.x, ch.UVMax.y},
+            {xpos + w, ypos, ch.UVMax.x, ch.UVMin.y}};
+        vertices.insert(vertices.end(), &quad[0][0], &quad[0][0] + 24);
 
         // now advance cursors for next glyph
         x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (1/64th times 2^6 = 64)
     }
+}
+
+// binds the text shader, the given color and the font's atlas ready to draw glyph quads
+void TextRenderer::Prepare(glm::vec3 color)
+{
+    ResourceManager::GetShader(this->TextShader).Use().SetVector3f("textColor", color);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, this->Atlas);
+}
 
+// constructor for text that is filled in later
+TextObject::TextObject(TextRenderer &renderer, float x, float y, float scale, glm::vec3 color)
+    : renderer(renderer), x(x), y(y), scale(scale), color(color), vertexCount(0), bufferBytes(0)
+{
+    glGenBuffers(1, &this->VBO);
+    MemoryStats::Created(GL_OBJECT_BUFFER);
+    initGlyphArray(this->VAO, this->VBO);
+}
+
+// constructor
+TextObject::TextObject(TextRenderer &renderer, const std::string &text, float x, float y, float scale, glm::vec3 color)
+    : TextObject(renderer, x, y, scale, color)
+{
+    this->SetText(text);
+}
+
+// destructor
+TextObject::~TextObject()
+{
+    glDeleteVertexArrays(1, &this->VAO);
+    glDeleteBuffers(1, &this->VBO);
+    MemoryStats::Deleted(GL_OBJECT_VERTEX_ARRAY);
+    MemoryStats::Deleted(GL_OBJECT_BUFFER);
+    MemoryStats::AddBufferBytes(-this->bufferBytes);
+}
+
+// changes the text, re-uploading the glyphs only if it actually differs
+void TextObject::SetText(const std::string &text)
+{
+    if (text == this->text && this->vertexCount > 0)
+        return;
+    this->text = text;
+    MemoryScope scope(MEMORY_TEXT);
+
+    // lay out the new text and upload it, it stays on the GPU until the text changes again
+    this->vertices.clear();
+    this->renderer.Layout(text, this->x, this->y, this->scale, this->vertices);
+    this->vertexCount = static_cast<unsigned int>(this->vertices.size() / 4);
+
+    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+    glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(float), this->vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    long long bytes = static_cast<long long>(this->vertices.size() * sizeof(float));
+    MemoryStats::AddBufferBytes(bytes - this->bufferBytes);
+    this->bufferBytes = bytes;
+}
+
+// draws the text
+void TextObject::Draw()
+{
+    if (this->vertexCount == 0)
+        return;
+
+    this->renderer.Prepare(this->color);
+    glBindVertexArray(this->VAO);
+    glDrawArrays(GL_TRIANGLES, 0, this->vertexCount);
     glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-}
\ No newline at end of file
+}
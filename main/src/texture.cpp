@@ -9,28 +9,88 @@
 #include <iostream>
 
 #include "texture.hpp"
+#include "memory_stats.hpp"
 
 // constructor (sets default texture modes)
 Texture2D::Texture2D()
-    : Width(0), Height(0), Internal_Format(GL_RGB), Image_Format(GL_RGB), Wrap_S(GL_REPEAT), Wrap_T(GL_REPEAT), Filter_Min(GL_LINEAR), Filter_Max(GL_LINEAR)
+    : ID(0), Width(0), Height(0), Levels(0), Internal_Format(GL_RGB), Image_Format(GL_RGB), Wrap_S(GL_REPEAT), Wrap_T(GL_REPEAT), Filter_Min(GL_LINEAR), Filter_Max(GL_LINEAR), countedBytes(0)
 {
-    glGenTextures(1, &this->ID);
+}
+
+// destructor
+Texture2D::~Texture2D()
+{
+    this->release();
+}
+
+// take over another texture
+Texture2D::Texture2D(Texture2D &&other) noexcept
+    : ID(other.ID), Width(other.Width), Height(other.Height), Levels(other.Levels), Internal_Format(other.Internal_Format), Image_Format(other.Image_Format),
+      Wrap_S(other.Wrap_S), Wrap_T(other.Wrap_T), Filter_Min(other.Filter_Min), Filter_Max(other.Filter_Max), countedBytes(other.countedBytes)
+{
+    other.ID = 0;
+    other.countedBytes = 0;
+}
+
+// delete this texture and take over another
+Texture2D &Texture2D::operator=(Texture2D &&other) noexcept
+{
+    if (this != &other)
+    {
+        this->release();
+        this->ID = other.ID;
+        this->Width = other.Width;
+        this->Height = other.Height;
+        this->Levels = other.Levels;
+        this->Internal_Format = other.Internal_Format;
+        this->Image_Format = other.Image_Format;
+        this->Wrap_S = other.Wrap_S;
+        this->Wrap_T = other.Wrap_T;
+        this->Filter_Min = other.Filter_Min;
+        this->Filter_Max = other.Filter_Max;
+        this->countedBytes = other.countedBytes;
+        other.ID = 0;
+        other.countedBytes = 0;
+    }
+    return *this;
 }
 
 // generates texture from image data
 void Texture2D::Generate(unsigned int width, unsigned int height, unsigned char *data)
 {
-    this->Width = width;
-    this->Height = height;
+    TextureLevel level = {width, height, data};
+    this->Generate(&level, 1);
+}
+
+// generates texture from an image and its mipmaps
+void Texture2D::Generate(const TextureLevel *levels, unsigned int count)
+{
+    this->Width = levels[0].Width;
+    this->Height = levels[0].Height;
+    this->Levels = count;
 
-    // create Texture
+    // create Texture (the first time it is generated)
+    if (this->ID == 0)
+    {
+        glGenTextures(1, &this->ID);
+        MemoryStats::Created(GL_OBJECT_TEXTURE);
+    }
+    MemoryStats::AddTextureBytes(this->Bytes() - this->countedBytes);
+    this->countedBytes = this->Bytes();
     glBindTexture(GL_TEXTURE_2D, this->ID);
-    glTexImage2D(GL_TEXTURE_2D, 0, this->Internal_Format, width, height, 0, this->Image_Format, GL_UNSIGNED_BYTE, data);
+    // the levels' rows are tightly packed, whatever their width
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (unsigned int i = 0; i < count; ++i)
+        glTexImage2D(GL_TEXTURE_2D, i, this->Internal_Format, levels[i].Width, levels[i].Height, 0, this->Image_Format, GL_UNSIGNED_BYTE, levels[i].Data);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, count - 1);
 
-    // set Texture wrap and filter modes
+    // set Texture wrap and filter modes (blending between mipmaps, when there are any, for minified textures)
+    GLint filterMin = this->Filter_Min;
+    if (count > 1)
+        filterMin = this->Filter_Min == GL_NEAREST ? GL_NEAREST_MIPMAP_NEAREST : GL_LINEAR_MIPMAP_LINEAR;
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, this->Wrap_S);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, this->Wrap_T);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, this->Filter_Min);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filterMin);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, this->Filter_Max);
 
     // unbind texture
@@ -41,4 +101,43 @@ void Texture2D::Generate(unsigned int width, unsigned int height, unsigned char
 void Texture2D::Bind() const
 {
     glBindTexture(GL_TEXTURE_2D, this->ID);
-}
\ No newline at end of file
+}
+
+// a handle to this texture
+TextureHandle Texture2D::Handle() const
+{
+    return TextureHandle{this->ID};
+}
+
+// estimated size of the texture's storage in bytes
+long long Texture2D::Bytes() const
+{
+    long long channels = this->Internal_Format == GL_RGBA ? 4 : this->Internal_Format == GL_RED ? 1 : 3;
+    long long bytes = 0;
+    unsigned int width = this->Width, height = this->Height;
+    for (unsigned int i = 0; i < this->Levels; ++i)
+    {
+        bytes += static_cast<long long>(width) * height * channels;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return bytes;
+}
+
+// delete the texture
+void Texture2D::release()
+{
+    if (this->ID == 0)
+        return;
+    glDeleteTextures(1, &this->ID);
+    MemoryStats::Deleted(GL_OBJECT_TEXTURE);
+    MemoryStats::AddTextureBytes(-this->countedBytes);
+    this->ID = 0;
+    this->countedBytes = 0;
+}
+
+// binds the referenced texture as the current active GL_TEXTURE_2D texture object
+void TextureHandle::Bind() const
+{
+    glBindTexture(GL_TEXTURE_2D, this->ID);
+}
@@ -0,0 +1,246 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <iostream>
+#include <fstream>
+#include <iterator>
+
+#include "texture_container.hpp"
+#include "stb_image.h"
+
+// map files where there is mmap, read them elsewhere
+#if defined(LINUX) || defined(MAC)
+#define TEXTURE_CONTAINER_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Marks a container (and its layout version)
+const unsigned char CONTAINER_MAGIC[4] = {'B', 'T', 'E', 'X'};
+const unsigned int CONTAINER_VERSION = 1;
+
+// more levels than a 2^31 pixel wide image has
+const unsigned int MAX_LEVELS = 32;
+
+// writes a little endian integer into a container
+static void writeInt(std::vector<unsigned char> &out, unsigned long long value, unsigned int bytes)
+{
+    for (unsigned int i = 0; i < bytes; ++i)
+        out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+}
+
+// reads a little endian integer from a container
+static unsigned long long readInt(const unsigned char *in, unsigned int bytes)
+{
+    unsigned long long value = 0;
+    for (unsigned int i = 0; i < bytes; ++i)
+        value |= static_cast<unsigned long long>(in[i]) << (8 * i);
+    return value;
+}
+
+// halves an image (a side of 1 stays 1), averaging each 2x2 block of pixels
+static std::vector<unsigned char> halve(const std::vector<unsigned char> &pixels, unsigned int width, unsigned int height, unsigned int channels)
+{
+    unsigned int halfWidth = width > 1 ? width / 2 : 1, halfHeight = height > 1 ? height / 2 : 1;
+    std::vector<unsigned char> half(static_cast<size_t>(halfWidth) * halfHeight * channels);
+    for (unsigned int y = 0; y < halfHeight; ++y)
+    {
+        unsigned int y0 = 2 * y < height ? 2 * y : height - 1, y1 = 2 * y + 1 < height ? 2 * y + 1 : y0;
+        for (unsigned int x = 0; x < halfWidth; ++x)
+        {
+            unsigned int x0 = 2 * x < width ? 2 * x : width - 1, x1 = 2 * x + 1 < width ? 2 * x + 1 : x0;
+            for (unsigned int c = 0; c < channels; ++c)
+            {
+                unsigned int sum = pixels[(static_cast<size_t>(y0) * width + x0) * channels + c] + pixels[(static_cast<size_t>(y0) * width + x1) * channels + c] +
+                                   pixels[(static_cast<size_t>(y1) * width + x0) * channels + c] + pixels[(static_cast<size_t>(y1) * width + x1) * channels + c];
+                half[(static_cast<size_t>(y) * halfWidth + x) * channels + c] = static_cast<unsigned char>((sum + 2) / 4);
+            }
+        }
+    }
+    return half;
+}
+
+// constructor
+TextureContainer::TextureContainer()
+    : data(nullptr), size(0), channels(0)
+{
+}
+
+// destructor
+TextureContainer::~TextureContainer()
+{
+    this->Unmap();
+}
+
+// map a container file and check it
+bool TextureContainer::Map(const std::string &path, unsigned long long sourceHash)
+{
+    this->Unmap();
+#ifdef TEXTURE_CONTAINER_MMAP
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+    struct stat info;
+    if (fstat(file, &info) == 0 && info.st_size > 0)
+    {
+        void *mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        if (mapping != MAP_FAILED)
+        {
+            this->data = static_cast<const unsigned char *>(mapping);
+            this->size = static_cast<size_t>(info.st_size);
+        }
+    }
+    close(file);
+    if (this->data == nullptr)
+        return false;
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    this->buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    this->data = this->buffer.data();
+    this->size = this->buffer.size();
+#endif
+
+    // check the header, then that every level lies within the file
+    const unsigned char *in = this->data;
+    if (this->size < HEADER_SIZE || in[0] != CONTAINER_MAGIC[0] || in[1] != CONTAINER_MAGIC[1] || in[2] != CONTAINER_MAGIC[2] ||
+        in[3] != CONTAINER_MAGIC[3] || readInt(in + 4, 4) != CONTAINER_VERSION)
+    {
+        std::cout << "ERROR::TEXTURE_CONTAINER: " << path << " is not a texture container this version can load" << std::endl;
+        this->Unmap();
+        return false;
+    }
+    if (readInt(in + 8, 8) != sourceHash)
+    {
+        std::cout << "ERROR::TEXTURE_CONTAINER: " << path << " is stale, decoding its source instead (run --bake-textures)" << std::endl;
+        this->Unmap();
+        return false;
+    }
+    unsigned int channels = static_cast<unsigned int>(readInt(in + 16, 4));
+    unsigned int count = static_cast<unsigned int>(readInt(in + 28, 4));
+    bool valid = (channels == 3 || channels == 4) && count >= 1 && count <= MAX_LEVELS && this->size >= HEADER_SIZE + count * LEVEL_SIZE;
+    for (unsigned int i = 0; valid && i < count; ++i)
+    {
+        const unsigned char *entry = in + HEADER_SIZE + i * LEVEL_SIZE;
+        unsigned long long width = readInt(entry, 4), height = readInt(entry + 4, 4);
+        unsigned long long offset = readInt(entry + 8, 4), bytes = readInt(entry + 12, 4);
+        valid = width > 0 && height > 0 && bytes == width * height * channels && offset + bytes <= this->size;
+        if (valid)
+            this->levels.push_back(TextureLevel{static_cast<unsigned int>(width), static_cast<unsigned int>(height), in + offset});
+    }
+    if (!valid)
+    {
+        std::cout << "ERROR::TEXTURE_CONTAINER: " << path << " is malformed" << std::endl;
+        this->Unmap();
+        return false;
+    }
+    this->channels = channels;
+    return true;
+}
+
+// release the mapped file
+void TextureContainer::Unmap()
+{
+#ifdef TEXTURE_CONTAINER_MMAP
+    if (this->data != nullptr)
+        munmap(const_cast<unsigned char *>(this->data), this->size);
+#endif
+    this->buffer.clear();
+    this->data = nullptr;
+    this->size = 0;
+    this->channels = 0;
+    this->levels.clear();
+}
+
+// the container baked from a source file
+std::string TextureContainer::PathFor(const std::string &source)
+{
+    std::string::size_type dot = source.find_last_of('.');
+    std::string::size_type slash = source.find_last_of('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return source + ".btex";
+    return source.substr(0, dot) + ".btex";
+}
+
+// 64 bit FNV-1a hash of a source file
+unsigned long long TextureContainer::HashSource(const std::string &bytes)
+{
+    unsigned long long hash = 14695981039346656037ull;
+    for (unsigned char byte : bytes)
+    {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// decode an image and write it as a container
+bool TextureContainer::Bake(const std::string &bytes, const std::string &path, bool mipmaps)
+{
+    // keep alpha only if the image has some (a palette with transparency counts)
+    const stbi_uc *source = reinterpret_cast<const stbi_uc *>(bytes.data());
+    int width = 0, height = 0, components = 0;
+    if (!stbi_info_from_memory(source, static_cast<int>(bytes.size()), &width, &height, &components))
+    {
+        std::cout << "ERROR::TEXTURE_CONTAINER: Could not decode the source of " << path << ": " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+    unsigned int channels = components == 2 || components == 4 ? 4 : 3;
+    stbi_uc *pixels = stbi_load_from_memory(source, static_cast<int>(bytes.size()), &width, &height, &components, static_cast<int>(channels));
+    if (pixels == nullptr)
+    {
+        std::cout << "ERROR::TEXTURE_CONTAINER: Could not decode the source of " << path << ": " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+
+    // the image, and each half sized level down to 1x1
+    std::vector<std::vector<unsigned char>> images(1, std::vector<unsigned char>(pixels, pixels + static_cast<size_t>(width) * height * channels));
+    std::vector<TextureLevel> levels(1, TextureLevel{static_cast<unsigned int>(width), static_cast<unsigned int>(height), nullptr});
+    stbi_image_free(pixels);
+    while (mipmaps && (levels.back().Width > 1 || levels.back().Height > 1))
+    {
+        const TextureLevel &last = levels.back();
+        images.push_back(halve(images.back(), last.Width, last.Height, channels));
+        levels.push_back(TextureLevel{last.Width > 1 ? last.Width / 2 : 1, last.Height > 1 ? last.Height / 2 : 1, nullptr});
+    }
+
+    std::vector<unsigned char> out(CONTAINER_MAGIC, CONTAINER_MAGIC + 4);
+    writeInt(out, CONTAINER_VERSION, 4);
+    writeInt(out, HashSource(bytes), 8);
+    writeInt(out, channels, 4);
+    writeInt(out, static_cast<unsigned int>(width), 4);
+    writeInt(out, static_cast<unsigned int>(height), 4);
+    writeInt(out, static_cast<unsigned int>(levels.size()), 4);
+    size_t offset = HEADER_SIZE + levels.size() * LEVEL_SIZE;
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        offset = (offset + 3) & ~static_cast<size_t>(3);
+        writeInt(out, levels[i].Width, 4);
+        writeInt(out, levels[i].Height, 4);
+        writeInt(out, offset, 4);
+        writeInt(out, images[i].size(), 4);
+        offset += images[i].size();
+    }
+    for (const std::vector<unsigned char> &image : images)
+    {
+        out.resize((out.size() + 3) & ~static_cast<size_t>(3), 0);
+        out.insert(out.end(), image.begin(), image.end());
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(out.data()), static_cast<std::streamsize>(out.size()));
+    if (!file)
+    {
+        std::cout << "ERROR::TEXTURE_CONTAINER: Could not write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,185 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "trace.hpp"
+
+// One zone on a thread's timeline
+struct TraceEvent
+{
+    const char *Name;
+    long long Start;
+    long long End;
+};
+
+// Zones recorded by one thread, in fixed blocks chained together. Only the
+// owning thread writes; a block's count is published after its events, so
+// blocks can be read while the thread keeps recording
+struct TraceBlock
+{
+    static const unsigned int CAPACITY = 8192;
+    TraceEvent Events[CAPACITY];
+    std::atomic<unsigned int> Count;
+    std::atomic<TraceBlock *> Next;
+
+    TraceBlock() : Count(0), Next(nullptr) {}
+};
+
+// A thread's zones and name (set under threadsMutex, which Write holds while reading it)
+struct TraceThread
+{
+    unsigned int Id;
+    std::string Name;
+    TraceBlock First;
+    TraceBlock *Last;
+
+    TraceThread() : Id(0), Name(), First(), Last(&First) {}
+
+    // frees the blocks chained after the first
+    ~TraceThread()
+    {
+        TraceBlock *block = this->First.Next.load(std::memory_order_relaxed);
+        while (block != nullptr)
+        {
+            TraceBlock *next = block->Next.load(std::memory_order_relaxed);
+            delete block;
+            block = next;
+        }
+    }
+
+    TraceThread(const TraceThread &) = delete;
+    TraceThread &operator=(const TraceThread &) = delete;
+};
+
+std::atomic<bool> Trace::enabled(false);
+
+// when recording started
+static std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+// every thread that has recorded, kept (with its blocks) until exit, as threads may finish before the trace is
+// written and others may still be recording after it
+static std::mutex threadsMutex;
+static std::vector<std::unique_ptr<TraceThread>> threads;
+
+// the calling thread's buffer, registered the first time it records or is named
+static thread_local TraceThread *current = nullptr;
+
+// the calling thread's buffer
+static TraceThread *currentThread()
+{
+    if (current == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        threads.emplace_back(new TraceThread());
+        current = threads.back().get();
+        current->Id = static_cast<unsigned int>(threads.size());
+    }
+    return current;
+}
+
+// writes a zone name as a JSON string
+static void writeName(std::ofstream &out, const char *name)
+{
+    out << '"';
+    for (const char *c = name; *c != '\0'; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+            out << '\\';
+        out << *c;
+    }
+    out << '"';
+}
+
+// starts recording
+void Trace::Start()
+{
+    origin = std::chrono::steady_clock::now();
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+// stops recording and writes every zone recorded so far
+bool Trace::Write(const std::string &path)
+{
+    enabled.store(false, std::memory_order_relaxed);
+    std::ofstream out(path);
+    if (!out.is_open())
+    {
+        std::cout << "ERROR::TRACE: Could not open " << path << std::endl;
+        return false;
+    }
+
+    // complete ("X") events with microsecond times, and a name for every thread
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    unsigned long long zones = 0;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Breakout\"}}";
+    out.setf(std::ios::fixed);
+    out.precision(3);
+    for (const std::unique_ptr<TraceThread> &thread : threads)
+    {
+        if (!thread->Name.empty())
+        {
+            out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->Id << ",\"args\":{\"name\":";
+            writeName(out, thread->Name.c_str());
+            out << "}}";
+        }
+        for (const TraceBlock *block = &thread->First; block != nullptr; block = block->Next.load(std::memory_order_acquire))
+        {
+            unsigned int count = block->Count.load(std::memory_order_acquire);
+            for (unsigned int i = 0; i < count; ++i)
+            {
+                const TraceEvent &event = block->Events[i];
+                out << ",\n{\"name\":";
+                writeName(out, event.Name);
+                out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->Id << ",\"ts\":" << event.Start / 1000.0
+                    << ",\"dur\":" << (event.End - event.Start) / 1000.0 << "}";
+            }
+            zones += count;
+        }
+    }
+    out << "\n]}\n";
+    std::cout << "Trace: wrote " << zones << " zones on " << threads.size() << " threads to " << path << "\n";
+    return true;
+}
+
+// names the calling thread on the timeline
+void Trace::SetThreadName(const char *name)
+{
+    TraceThread *thread = currentThread();
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    thread->Name = name;
+}
+
+// nanoseconds since recording started
+long long Trace::Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+// records a zone on the calling thread
+void Trace::Record(const char *name, long long start, long long end)
+{
+    TraceThread *thread = currentThread();
+    TraceBlock *block = thread->Last;
+    unsigned int count = block->Count.load(std::memory_order_relaxed);
+    if (count == TraceBlock::CAPACITY)
+    {
+        TraceBlock *next = new TraceBlock();
+        block->Next.store(next, std::memory_order_release);
+        thread->Last = block = next;
+        count = 0;
+    }
+    block->Events[count] = TraceEvent{name, start, end};
+    block->Count.store(count + 1, std::memory_order_release);
+}
@@ -0,0 +1,162 @@
+/*******************************************************************
+** This code is part of Breakout.
+**
+** Breakout is free software: you can redistribute it and/or modify
+** it under the terms of the CC BY 4.0 license as published by
+** Creative Commons, either version 4 of the License, or (at your
+** option) any later version.
+******************************************************************/
+#include <iostream>
+#include <cstring>
+
+#include "udp_socket.hpp"
+
+#ifndef MINGW
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// constructor
+UdpSocket::UdpSocket()
+    : fd(-1), peer(), conditions(), random(std::random_device()())
+{
+}
+
+// destructor
+UdpSocket::~UdpSocket()
+{
+    this->Close();
+}
+
+// binds to a local port and resolves the peer
+bool UdpSocket::Open(unsigned short localPort, const std::string &peerHost, unsigned short peerPort)
+{
+    this->Close();
+
+#ifndef MINGW
+    // look up the peer's IPv4 address
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo *found = nullptr;
+    if (getaddrinfo(peerHost.c_str(), nullptr, &hints, &found) != 0 || found == nullptr)
+    {
+        std::cout << "ERROR::UDP_SOCKET: Could not resolve " << peerHost << std::endl;
+        return false;
+    }
+    sockaddr_in address = *reinterpret_cast<const sockaddr_in *>(found->ai_addr);
+    address.sin_port = htons(peerPort);
+    std::memcpy(this->peer, &address, sizeof(address));
+    freeaddrinfo(found);
+
+    // then bind a non-blocking socket to the local port
+    this->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (this->fd < 0)
+    {
+        std::cout << "ERROR::UDP_SOCKET: Could not create a socket" << std::endl;
+        return false;
+    }
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(localPort);
+    if (bind(this->fd, reinterpret_cast<const sockaddr *>(&local), sizeof(local)) != 0 ||
+        fcntl(this->fd, F_SETFL, fcntl(this->fd, F_GETFL, 0) | O_NONBLOCK) != 0)
+    {
+        std::cout << "ERROR::UDP_SOCKET: Could not bind to port " << localPort << std::endl;
+        this->Close();
+        return false;
+    }
+    return true;
+#else
+    std::cout << "ERROR::UDP_SOCKET: Networking is unavailable on this platform" << std::endl;
+    return false;
+#endif
+}
+
+void UdpSocket::Close()
+{
+#ifndef MINGW
+    if (this->fd >= 0)
+        close(this->fd);
+#endif
+    this->fd = -1;
+    this->pending.clear();
+}
+
+// conditions applied to every packet sent from now on
+void UdpSocket::SetConditions(const NetworkConditions &conditions)
+{
+    this->conditions = conditions;
+}
+
+// sends a packet to the peer (or queues it)
+void UdpSocket::Send(const unsigned char *data, unsigned int size)
+{
+    // drop it, as a lossy network would
+    if (this->conditions.LossPercent > 0 && this->random() % 100 < this->conditions.LossPercent)
+        return;
+
+    if (this->conditions.LatencyMs == 0 && this->conditions.JitterMs == 0)
+        this->sendNow(data, size);
+    else
+    {
+        unsigned int delay = this->conditions.LatencyMs;
+        if (this->conditions.JitterMs > 0)
+            delay += this->random() % (this->conditions.JitterMs + 1);
+        this->pending.push_back(Pending{std::chrono::steady_clock::now() + std::chrono::milliseconds(delay),
+                                        std::vector<unsigned char>(data, data + size)});
+    }
+    this->Flush();
+}
+
+// sends the queued packets that are due
+void UdpSocket::Flush()
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < this->pending.size();)
+    {
+        if (this->pending[i].Due <= now)
+        {
+            this->sendNow(this->pending[i].Data.data(), static_cast<unsigned int>(this->pending[i].Data.size()));
+            this->pending.erase(this->pending.begin() + i);
+        }
+        else
+            ++i;
+    }
+}
+
+// receives one packet from the peer without blocking
+unsigned int UdpSocket::Receive(unsigned char *data, unsigned int capacity)
+{
+#ifndef MINGW
+    if (this->fd < 0)
+        return 0;
+
+    // skip anything that did not come from the peer
+    sockaddr_in from;
+    socklen_t fromSize = sizeof(from);
+    ssize_t size;
+    while ((size = recvfrom(this->fd, data, capacity, 0, reinterpret_cast<sockaddr *>(&from), &fromSize)) >= 0)
+    {
+        const sockaddr_in *peer = reinterpret_cast<const sockaddr_in *>(this->peer);
+        if (from.sin_port == peer->sin_port && from.sin_addr.s_addr == peer->sin_addr.s_addr)
+            return static_cast<unsigned int>(size);
+        fromSize = sizeof(from);
+    }
+#endif
+    return 0;
+}
+
+// sends a packet straight away
+void UdpSocket::sendNow(const unsigned char *data, unsigned int size)
+{
+#ifndef MINGW
+    if (this->fd >= 0)
+        sendto(this->fd, data, size, 0, reinterpret_cast<const sockaddr *>(this->peer), sizeof(sockaddr_in));
+#endif
+}